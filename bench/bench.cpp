@@ -0,0 +1,332 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+std::atomic<std::uint64_t> allocations{0};
+
+void* allocate(const std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+/**
+ * 超过 malloc 对齐的分配: 多分配一些, 把 malloc 返回的指针存在对齐的块之前
+ */
+void* allocateAligned(const std::size_t size, const std::size_t alignment) {
+  char* raw = static_cast<char*>(allocate(size + alignment + sizeof(void*)));
+  const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw + sizeof(void*));
+  char* aligned = raw + sizeof(void*) + (alignment - start % alignment) % alignment;
+  reinterpret_cast<void**>(aligned)[-1] = raw;
+  return aligned;
+}
+
+void freeAligned(void* p) {
+  if (p != nullptr) {
+    std::free(static_cast<void**>(p)[-1]);
+  }
+}
+
+}
+
+// 替换全局的 operator new/delete 以统计每次操作的内存分配次数.
+// 其余形式 (数组, nothrow) 的默认实现都转发到这几个.
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { freeAligned(p); }
+
+namespace badgerdb {
+namespace bench {
+
+namespace {
+
+struct Benchmark {
+  std::string name;
+  std::vector<Param> params;
+  BenchmarkFn fn;
+};
+
+std::vector<Benchmark>& registry() {
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+/**
+ * 一个基准在一组参数下的结果
+ */
+struct Result {
+  std::string name;
+  std::vector<std::pair<std::string, std::int64_t>> params;
+  std::uint64_t iterations;
+  double ns_per_op;
+  double ns_per_op_min;
+  double allocs_per_op;
+  std::uint64_t bytes_per_op;
+};
+
+struct Options {
+  std::string filter;
+  double min_time_ms = 200;
+  unsigned repetitions = 5;
+  bool json = true;
+  bool list = false;
+};
+
+std::string caseName(const Benchmark& benchmark,
+                     const std::vector<std::pair<std::string, std::int64_t>>& params) {
+  std::string name = benchmark.name;
+  for (const auto& [key, value] : params) {
+    name += "/" + key + ":" + std::to_string(value);
+  }
+  return name;
+}
+
+/**
+ * 各参数取值的笛卡儿积, 按声明顺序, 最后一个参数变化最快
+ */
+std::vector<std::vector<std::pair<std::string, std::int64_t>>> expand(
+    const std::vector<Param>& params) {
+  std::vector<std::vector<std::pair<std::string, std::int64_t>>> cases(1);
+  for (const Param& param : params) {
+    std::vector<std::vector<std::pair<std::string, std::int64_t>>> next;
+    for (const auto& prefix : cases) {
+      for (const std::int64_t value : param.values) {
+        next.push_back(prefix);
+        next.back().emplace_back(param.name, value);
+      }
+    }
+    cases = std::move(next);
+  }
+  return cases;
+}
+
+bool parseOptions(const int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    const auto value_of = [&](std::string_view prefix, std::string_view& value) {
+      if (arg.substr(0, prefix.size()) != prefix) {
+        return false;
+      }
+      value = arg.substr(prefix.size());
+      return true;
+    };
+    std::string_view value;
+    if (value_of("--filter=", value)) {
+      options.filter = value;
+    } else if (value_of("--min-time=", value)) {
+      options.min_time_ms = std::atof(std::string(value).c_str());
+    } else if (value_of("--repetitions=", value)) {
+      options.repetitions = std::max(1, std::atoi(std::string(value).c_str()));
+    } else if (value_of("--format=", value) && (value == "json" || value == "text")) {
+      options.json = value == "json";
+    } else if (arg == "--list") {
+      options.list = true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+void printJson(const Options& options, const std::vector<Result>& results) {
+  std::printf("{\n  \"schema\": \"badgerdb-bench/1\",\n");
+  std::printf("  \"min_time_ms\": %.0f,\n  \"repetitions\": %u,\n", options.min_time_ms,
+              options.repetitions);
+  std::printf("  \"benchmarks\": [");
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    std::printf("%s\n    {\"name\": \"%s\", \"params\": {", i == 0 ? "" : ",", r.name.c_str());
+    for (std::size_t p = 0; p < r.params.size(); ++p) {
+      std::printf("%s\"%s\": %lld", p == 0 ? "" : ", ", r.params[p].first.c_str(),
+                  static_cast<long long>(r.params[p].second));
+    }
+    std::printf("}, \"iterations\": %llu, \"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f, "
+                "\"allocs_per_op\": %.3f, \"ops_per_sec\": %.0f, \"bytes_per_sec\": ",
+                static_cast<unsigned long long>(r.iterations), r.ns_per_op, r.ns_per_op_min,
+                r.allocs_per_op, 1e9 / r.ns_per_op);
+    if (r.bytes_per_op != 0) {
+      std::printf("%.0f}", 1e9 / r.ns_per_op * static_cast<double>(r.bytes_per_op));
+    } else {
+      std::printf("null}");
+    }
+  }
+  std::printf("\n  ]\n}\n");
+}
+
+void printText(const std::vector<Result>& results) {
+  std::printf("%-52s %14s %12s %14s %12s\n", "benchmark", "ns/op", "allocs/op", "ops/s", "MB/s");
+  for (const Result& r : results) {
+    Benchmark b{r.name, {}, {}};
+    std::printf("%-52s %14.2f %12.3f %14.0f", caseName(b, r.params).c_str(), r.ns_per_op,
+                r.allocs_per_op, 1e9 / r.ns_per_op);
+    if (r.bytes_per_op != 0) {
+      std::printf(" %12.1f\n", 1e3 / r.ns_per_op * static_cast<double>(r.bytes_per_op));
+    } else {
+      std::printf(" %12s\n", "-");
+    }
+  }
+}
+
+}
+
+std::uint64_t allocationCount() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+State::State(const std::uint64_t iterations,
+             std::vector<std::pair<std::string, std::int64_t>> params)
+    : iterations_(iterations), params_(std::move(params)) {}
+
+std::int64_t State::param(const std::string& name) const {
+  for (const auto& [key, value] : params_) {
+    if (key == name) {
+      return value;
+    }
+  }
+  throw std::out_of_range("no benchmark parameter named " + name);
+}
+
+void State::pauseTiming() {
+  if (running_) {
+    elapsed_ += Clock::now() - started_;
+    allocs_ += allocationCount() - allocs_at_start_;
+    running_ = false;
+  }
+}
+
+void State::resumeTiming() {
+  if (!running_) {
+    running_ = true;
+    allocs_at_start_ = allocationCount();
+    started_ = Clock::now();
+  }
+}
+
+/**
+ * @brief 运行基准: 先把操作数加大到一次运行至少持续 min_time, 再以该操作数
+ * 重复 repetitions 次, 取每次操作耗时的中位数.
+ */
+class Runner {
+ public:
+  explicit Runner(const Options& options) : options_(options) {}
+
+  Result run(const Benchmark& benchmark,
+             const std::vector<std::pair<std::string, std::int64_t>>& params) {
+    const double min_time_ns = options_.min_time_ms * 1e6;
+    std::uint64_t n = 1;
+    for (;;) {
+      const State state = runOnce(benchmark, params, n);
+      const double elapsed = static_cast<double>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(state.elapsed_).count());
+      if (elapsed >= min_time_ns || n >= MAX_ITERATIONS) {
+        break;
+      }
+      const double predicted = static_cast<double>(n) * min_time_ns * 1.4 / std::max(elapsed, 1.0);
+      n = std::min<std::uint64_t>(
+          MAX_ITERATIONS, std::clamp<double>(predicted, 2.0 * n, 100.0 * n));
+    }
+
+    std::vector<double> ns_per_op;
+    std::uint64_t allocs = 0;
+    std::uint64_t bytes_per_op = 0;
+    for (unsigned r = 0; r < options_.repetitions; ++r) {
+      const State state = runOnce(benchmark, params, n);
+      ns_per_op.push_back(static_cast<double>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(state.elapsed_).count()) /
+          static_cast<double>(n));
+      allocs += state.allocs_;
+      bytes_per_op = state.bytes_per_op_;
+    }
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+    return {benchmark.name, params, n, ns_per_op[ns_per_op.size() / 2], ns_per_op.front(),
+            static_cast<double>(allocs) / static_cast<double>(n * options_.repetitions),
+            bytes_per_op};
+  }
+
+ private:
+  static constexpr std::uint64_t MAX_ITERATIONS = 1'000'000'000;
+
+  static State runOnce(const Benchmark& benchmark,
+                       const std::vector<std::pair<std::string, std::int64_t>>& params,
+                       const std::uint64_t n) {
+    State state(n, params);
+    state.resumeTiming();
+    benchmark.fn(state);
+    state.pauseTiming();
+    return state;
+  }
+
+  const Options& options_;
+};
+
+Registrar::Registrar(std::string name, std::vector<Param> params, BenchmarkFn fn) {
+  registry().push_back({std::move(name), std::move(params), std::move(fn)});
+}
+
+}
+}
+
+int main(int argc, char** argv) {
+  using namespace badgerdb::bench;
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--filter=<substring>] [--min-time=<ms>] [--repetitions=<n>]\n"
+                 "          [--format=json|text] [--list]\n",
+                 argv[0]);
+    return 2;
+  }
+
+  // 各个源文件中登记的先后取决于链接顺序, 按名字排序使输出稳定.
+  std::stable_sort(registry().begin(), registry().end(),
+                   [](const Benchmark& a, const Benchmark& b) { return a.name < b.name; });
+  Runner runner(options);
+  std::vector<Result> results;
+  for (const Benchmark& benchmark : registry()) {
+    for (const auto& params : expand(benchmark.params)) {
+      const std::string name = caseName(benchmark, params);
+      if (name.find(options.filter) == std::string::npos) {
+        continue;
+      }
+      if (options.list) {
+        std::printf("%s\n", name.c_str());
+        continue;
+      }
+      std::fprintf(stderr, "running %s\n", name.c_str());
+      results.push_back(runner.run(benchmark, params));
+    }
+  }
+  if (options.list) {
+    return 0;
+  }
+  if (options.json) {
+    printJson(options, results);
+  } else {
+    printText(results);
+  }
+  return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace badgerdb {
+namespace bench {
+
+/**
+ * @brief 一次运行中基准函数看到的状态: 要执行的操作数和参数,
+ * 以及暂停计时 (准备数据等不计入结果的工作) 的开关.
+ *
+ * 基准函数必须恰好执行 iterations() 次被测的操作.
+ */
+class State {
+ public:
+  State(const std::uint64_t iterations, std::vector<std::pair<std::string, std::int64_t>> params);
+
+  std::uint64_t iterations() const { return iterations_; }
+
+  /**
+   * 名为 name 的参数的值
+   *
+   * @throws std::out_of_range 没有这个参数时
+   */
+  std::int64_t param(const std::string& name) const;
+
+  /**
+   * 暂停计时, 期间的时间和内存分配都不计入结果
+   */
+  void pauseTiming();
+
+  /**
+   * 恢复计时
+   */
+  void resumeTiming();
+
+  /**
+   * 每次操作处理的字节数, 设置后报告中有 bytes_per_sec
+   */
+  void setBytesPerOp(const std::uint64_t bytes) { bytes_per_op_ = bytes; }
+
+ private:
+  friend class Runner;
+
+  using Clock = std::chrono::steady_clock;
+
+  std::uint64_t iterations_;
+  std::vector<std::pair<std::string, std::int64_t>> params_;
+  std::uint64_t bytes_per_op_ = 0;
+  bool running_ = false;
+  Clock::time_point started_;
+  Clock::duration elapsed_ = Clock::duration::zero();
+  std::uint64_t allocs_at_start_ = 0;
+  std::uint64_t allocs_ = 0;
+};
+
+/**
+ * @brief 一个参数的名字和它要取的各个值.  各参数的取值做笛卡儿积.
+ */
+struct Param {
+  std::string name;
+  std::vector<std::int64_t> values;
+};
+
+using BenchmarkFn = std::function<void(State&)>;
+
+/**
+ * @brief 在静态初始化时登记一个基准, 见 BADGERDB_BENCHMARK.
+ */
+struct Registrar {
+  Registrar(std::string name, std::vector<Param> params, BenchmarkFn fn);
+};
+
+/**
+ * 到目前为止分配过的内存块数 (operator new 的调用次数)
+ */
+std::uint64_t allocationCount();
+
+/**
+ * 让编译器认为 value 被使用了, 不把算出它的代码当作死代码删掉
+ */
+template<typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static const T* volatile sink;
+  sink = &value;
+#endif
+}
+
+}
+}
+
+/**
+ * 定义并登记一个基准:
+ * @code
+ * BADGERDB_BENCHMARK(insertRecord, "page/insert_record", {{"record_size", {16, 64}}}) {
+ *   for (std::uint64_t i = 0; i < state.iterations(); ++i) { ... }
+ * }
+ * @endcode
+ */
+#define BADGERDB_BENCHMARK(function, name, ...)                                  \
+  static void function(::badgerdb::bench::State& state);                         \
+  static const ::badgerdb::bench::Registrar function##_registrar(name, __VA_ARGS__, \
+                                                                 function);      \
+  static void function(::badgerdb::bench::State& state)
@@ -0,0 +1,80 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "buffer.h"
+#include "temp_file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+/**
+ * 基准用的数据文件, 在当前目录下, 结束时删除
+ */
+const std::string FILE_PREFIX = "badgerdb_bench";
+
+/**
+ * 在 file 中通过 mgr 分配 count 个空页, 写回磁盘
+ */
+void fill(BufMgr& mgr, File& file, const PageId count) {
+  for (PageId i = 0; i < count; ++i) {
+    PageId page_number;
+    mgr.allocPage(file, page_number);
+  }
+  mgr.flushFile(file);
+}
+
+}
+
+/**
+ * 缓冲池命中: 文件的页数等于帧数, 全部预先读入, 之后随机引用并放开
+ */
+BADGERDB_BENCHMARK(bufReadPageHit, "buf_mgr/read_page_hit", {{"frames", {64, 4096}}}) {
+  const PageId frames = static_cast<PageId>(state.param("frames"));
+  state.pauseTiming();
+  TempFile temp(FILE_PREFIX, "db", IoMode::Buffered);
+  BufMgr mgr(frames);
+  fill(mgr, temp.file(), frames);
+  for (PageId p = 1; p <= frames; ++p) {
+    mgr.readPage(temp.file(), p);
+  }
+  std::mt19937 rng(42);
+  std::vector<PageId> keys(4096);
+  for (PageId& key : keys) {
+    key = 1 + rng() % frames;
+  }
+  state.resumeTiming();
+  for (std::uint64_t i = 0; i < state.iterations(); ++i) {
+    PageView view = mgr.readPage(temp.file(), keys[i % keys.size()]);
+    bench::doNotOptimize(view->page_number());
+  }
+  state.pauseTiming();
+}
+
+/**
+ * 缓冲池未命中: 循环顺序读一个页数为帧数 4 倍的文件, 每次引用都要换出一页并读盘
+ * (数据在内核的页缓存中, 测的是缓冲池自身加一次 read 的开销)
+ */
+BADGERDB_BENCHMARK(bufReadPageMiss, "buf_mgr/read_page_miss", {{"frames", {64, 1024}}}) {
+  const PageId frames = static_cast<PageId>(state.param("frames"));
+  const PageId pages = 4 * frames;
+  state.setBytesPerOp(Page::SIZE);
+  state.pauseTiming();
+  TempFile temp(FILE_PREFIX, "db", IoMode::Buffered);
+  BufMgr mgr(frames);
+  fill(mgr, temp.file(), pages);
+  state.resumeTiming();
+  for (std::uint64_t i = 0; i < state.iterations(); ++i) {
+    PageView view = mgr.readPage(temp.file(), static_cast<PageId>(1 + i % pages));
+    bench::doNotOptimize(view->page_number());
+  }
+  state.pauseTiming();
+}
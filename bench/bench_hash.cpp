@@ -0,0 +1,75 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "bufHashTbl.h"
+
+using namespace badgerdb;
+
+namespace {
+
+/**
+ * 与 BufMgr 相同的桶数: 约为帧数的 1.2 倍
+ */
+int tableSize(const std::int64_t entries) {
+  return ((static_cast<int>(entries * 1.2) * 2) / 2) + 1;
+}
+
+/**
+ * 查找用的键, 循环使用
+ */
+constexpr std::size_t NUM_KEYS = 4096;
+
+}
+
+/**
+ * 在装了 entries 项的表中查找, hit 为 0 时查找的页都不在表中
+ */
+BADGERDB_BENCHMARK(hashLookup, "buf_hash_table/lookup",
+                   {{"entries", {1024, 65536}}, {"hit", {1, 0}}}) {
+  const std::int64_t entries = state.param("entries");
+  const bool hit = state.param("hit") != 0;
+  state.pauseTiming();
+  BufHashTbl table(tableSize(entries));
+  for (std::int64_t i = 0; i < entries; ++i) {
+    table.insert(0, static_cast<PageId>(i + 1), static_cast<FrameId>(i));
+  }
+  std::mt19937 rng(42);
+  std::vector<PageId> keys(NUM_KEYS);
+  for (PageId& key : keys) {
+    key = static_cast<PageId>(1 + rng() % entries + (hit ? 0 : entries));
+  }
+  state.resumeTiming();
+  for (std::uint64_t i = 0; i < state.iterations(); ++i) {
+    FrameId frame;
+    bench::doNotOptimize(table.find(0, keys[i % NUM_KEYS], frame));
+  }
+  state.pauseTiming();
+}
+
+/**
+ * 在装了 entries 项的表中插入一项再删除它 (一次操作是一对插入和删除)
+ */
+BADGERDB_BENCHMARK(hashInsertRemove, "buf_hash_table/insert_remove",
+                   {{"entries", {1024, 65536}}}) {
+  const std::int64_t entries = state.param("entries");
+  state.pauseTiming();
+  BufHashTbl table(tableSize(entries));
+  for (std::int64_t i = 0; i < entries; ++i) {
+    table.insert(0, static_cast<PageId>(i + 1), static_cast<FrameId>(i));
+  }
+  state.resumeTiming();
+  for (std::uint64_t i = 0; i < state.iterations(); ++i) {
+    const PageId page = static_cast<PageId>(entries + 1 + i % entries);
+    table.insert(0, page, 0);
+    table.remove(0, page);
+  }
+  state.pauseTiming();
+}
@@ -0,0 +1,90 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "page.h"
+#include "page_iterator.h"
+
+using namespace badgerdb;
+
+/**
+ * 向页中插入记录, 页满时 (不计时) 换一个空页
+ */
+BADGERDB_BENCHMARK(pageInsertRecord, "page/insert_record", {{"record_size", {16, 64, 256}}}) {
+  const std::string record(state.param("record_size"), 'x');
+  state.setBytesPerOp(record.size());
+  Page page;
+  for (std::uint64_t i = 0; i < state.iterations(); ++i) {
+    if (!page.hasSpaceForRecord(record)) {
+      state.pauseTiming();
+      page = Page();
+      state.resumeTiming();
+    }
+    bench::doNotOptimize(page.insertRecord(record));
+  }
+}
+
+/**
+ * 从满页中逐条删除记录.  删除会把数据区压紧: 先删最早插入的记录 (位于数据区的最末端)
+ * 时, 其后所有记录的数据都要移动, 是最坏情况; 先删最新的记录时不需要移动数据.
+ */
+BADGERDB_BENCHMARK(pageDeleteRecord, "page/delete_record",
+                   {{"record_size", {16, 64, 256}}, {"oldest_first", {1, 0}}}) {
+  const std::string record(state.param("record_size"), 'x');
+  const bool oldest_first = state.param("oldest_first") != 0;
+  Page page;
+  std::vector<RecordId> ids;
+  std::size_t next = 0;
+  for (std::uint64_t i = 0; i < state.iterations(); ++i) {
+    if (next == ids.size()) {
+      state.pauseTiming();
+      page = Page();
+      ids.clear();
+      while (page.hasSpaceForRecord(record)) {
+        ids.push_back(page.insertRecord(record));
+      }
+      if (!oldest_first) {
+        std::reverse(ids.begin(), ids.end());
+      }
+      next = 0;
+      state.resumeTiming();
+    }
+    page.deleteRecord(ids[next++]);
+  }
+}
+
+/**
+ * 遍历页中的记录: 复制每条记录 (PageIterator::operator*) 与只取页内视图
+ * (Page::getRecordView()) 对比.  每次操作是一条记录.
+ */
+BADGERDB_BENCHMARK(pageReadRecords, "page/read_records",
+                   {{"record_size", {16, 64, 256}}, {"copy", {1, 0}}}) {
+  const std::string record(state.param("record_size"), 'x');
+  const bool copy = state.param("copy") != 0;
+  state.setBytesPerOp(record.size());
+  state.pauseTiming();
+  Page page;
+  while (page.hasSpaceForRecord(record)) {
+    page.insertRecord(record);
+  }
+  state.resumeTiming();
+  std::uint64_t done = 0;
+  while (done < state.iterations()) {
+    for (PageIterator iter = page.begin(); iter != page.end() && done < state.iterations();
+         ++iter, ++done) {
+      if (copy) {
+        bench::doNotOptimize(*iter);
+      } else {
+        bench::doNotOptimize(page.getRecordView(iter.record_id()));
+      }
+    }
+  }
+}
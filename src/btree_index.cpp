@@ -0,0 +1,526 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "btree_index.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+#include "bulk_loader.h"
+
+namespace badgerdb {
+
+namespace {
+
+using Key = BTreeIndex::Key;
+
+/**
+ * 元数据页的内容
+ */
+struct IndexMeta {
+  std::uint32_t magic;
+  PageId root;
+  std::uint32_t height;
+};
+
+constexpr std::uint32_t INDEX_MAGIC = 0x42545245;  // "BTRE"
+
+/**
+ * 节点页的页头, 叶节点和内部节点共用
+ */
+struct NodeHeader {
+  std::uint16_t is_leaf;
+  std::uint16_t num_keys;
+  /**
+   * 右兄弟叶节点的页号, 只对叶节点有意义
+   */
+  PageId next_leaf;
+};
+
+constexpr int LEAF_CAPACITY = static_cast<int>(
+    (Page::DATA_SIZE - sizeof(NodeHeader)) / (sizeof(Key) + sizeof(RecordId)));
+constexpr int INNER_CAPACITY = static_cast<int>(
+    (Page::DATA_SIZE - sizeof(NodeHeader) - sizeof(PageId)) / (sizeof(Key) + sizeof(PageId)));
+
+/**
+ * 叶节点: 有序的键和对应的记录
+ */
+struct LeafNode {
+  NodeHeader header;
+  Key keys[LEAF_CAPACITY];
+  RecordId rids[LEAF_CAPACITY];
+};
+
+/**
+ * 内部节点: children[i] 中的键都在 [keys[i-1], keys[i]) 之间
+ */
+struct InnerNode {
+  NodeHeader header;
+  Key keys[INNER_CAPACITY];
+  PageId children[INNER_CAPACITY + 1];
+};
+
+static_assert(sizeof(IndexMeta) <= Page::DATA_SIZE);
+static_assert(sizeof(LeafNode) <= Page::DATA_SIZE);
+static_assert(sizeof(InnerNode) <= Page::DATA_SIZE);
+
+IndexMeta* asMeta(Page& page) { return reinterpret_cast<IndexMeta*>(page.rawData()); }
+const IndexMeta* asMeta(const Page& page) { return reinterpret_cast<const IndexMeta*>(page.rawData()); }
+LeafNode* asLeaf(Page& page) { return reinterpret_cast<LeafNode*>(page.rawData()); }
+const LeafNode* asLeaf(const Page& page) { return reinterpret_cast<const LeafNode*>(page.rawData()); }
+InnerNode* asInner(Page& page) { return reinterpret_cast<InnerNode*>(page.rawData()); }
+const InnerNode* asInner(const Page& page) { return reinterpret_cast<const InnerNode*>(page.rawData()); }
+
+/**
+ * 叶节点中第一个不小于 key 的位置
+ */
+int lowerBound(const LeafNode* node, const Key key) {
+  return static_cast<int>(
+      std::lower_bound(node->keys, node->keys + node->header.num_keys, key) - node->keys);
+}
+
+/**
+ * 内部节点中包含 key 的子节点的下标
+ */
+int childIndex(const InnerNode* node, const Key key) {
+  return static_cast<int>(
+      std::upper_bound(node->keys, node->keys + node->header.num_keys, key) - node->keys);
+}
+
+/**
+ * 在未满的叶节点的 pos 处插入
+ */
+void leafInsertAt(LeafNode* node, const int pos, const Key key, const RecordId& rid) {
+  const int n = node->header.num_keys;
+  std::copy_backward(node->keys + pos, node->keys + n, node->keys + n + 1);
+  std::copy_backward(node->rids + pos, node->rids + n, node->rids + n + 1);
+  node->keys[pos] = key;
+  node->rids[pos] = rid;
+  node->header.num_keys++;
+}
+
+/**
+ * 在未满的内部节点中插入分隔键 key (位于 pos) 和它右边的子节点 child
+ */
+void innerInsertAt(InnerNode* node, const int pos, const Key key, const PageId child) {
+  const int n = node->header.num_keys;
+  std::copy_backward(node->keys + pos, node->keys + n, node->keys + n + 1);
+  std::copy_backward(node->children + pos + 1, node->children + n + 1, node->children + n + 2);
+  node->keys[pos] = key;
+  node->children[pos + 1] = child;
+  node->header.num_keys++;
+}
+
+/**
+ * 把已满的叶节点 left 连同新键一分为二, 后一半移到新的叶节点 right.
+ *
+ * @return 推到父节点的分隔键 (right 的第一个键)
+ */
+Key splitLeaf(LeafNode* left, LeafNode* right, const PageId right_page,
+              const int pos, const Key key, const RecordId& rid) {
+  constexpr int total = LEAF_CAPACITY + 1;
+  Key keys[total];
+  RecordId rids[total];
+  std::copy(left->keys, left->keys + pos, keys);
+  std::copy(left->rids, left->rids + pos, rids);
+  keys[pos] = key;
+  rids[pos] = rid;
+  std::copy(left->keys + pos, left->keys + LEAF_CAPACITY, keys + pos + 1);
+  std::copy(left->rids + pos, left->rids + LEAF_CAPACITY, rids + pos + 1);
+
+  const int left_count = total / 2;
+  std::copy(keys, keys + left_count, left->keys);
+  std::copy(rids, rids + left_count, left->rids);
+  std::copy(keys + left_count, keys + total, right->keys);
+  std::copy(rids + left_count, rids + total, right->rids);
+  right->header = {1, static_cast<std::uint16_t>(total - left_count), left->header.next_leaf};
+  left->header.num_keys = static_cast<std::uint16_t>(left_count);
+  left->header.next_leaf = right_page;
+  return right->keys[0];
+}
+
+/**
+ * 把已满的内部节点 left 连同新的分隔键和子节点一分为二, 后一半移到 right.
+ *
+ * @return 推到父节点的分隔键 (中间的键, 它不留在任何一边)
+ */
+Key splitInner(InnerNode* left, InnerNode* right, const int pos,
+               const Key key, const PageId child) {
+  constexpr int total = INNER_CAPACITY + 1;
+  Key keys[total];
+  PageId children[total + 1];
+  std::copy(left->keys, left->keys + pos, keys);
+  keys[pos] = key;
+  std::copy(left->keys + pos, left->keys + INNER_CAPACITY, keys + pos + 1);
+  std::copy(left->children, left->children + pos + 1, children);
+  children[pos + 1] = child;
+  std::copy(left->children + pos + 1, left->children + INNER_CAPACITY + 1, children + pos + 2);
+
+  const int mid = total / 2;
+  std::copy(keys, keys + mid, left->keys);
+  std::copy(children, children + mid + 1, left->children);
+  std::copy(keys + mid + 1, keys + total, right->keys);
+  std::copy(children + mid + 1, children + total + 1, right->children);
+  right->header = {0, static_cast<std::uint16_t>(total - mid - 1), Page::INVALID_NUMBER};
+  left->header.num_keys = static_cast<std::uint16_t>(mid);
+  return keys[mid];
+}
+
+}
+
+BTreeIndex::BTreeIndex(File& file, BufMgr& mgr)
+    : file_(file), mgr_(mgr) {
+  if (file_.numPages() <= META_PAGE) {
+    PageId meta_page;
+    PageId root_page;
+    MutablePageView meta = mgr_.allocPage(file_, meta_page);
+    MutablePageView root = mgr_.allocPage(file_, root_page);
+    assert(meta_page == META_PAGE);
+    asLeaf(*root)->header = {1, 0, Page::INVALID_NUMBER};
+    root_ = root_page;
+    height_ = 1;
+    *asMeta(*meta) = {INDEX_MAGIC, root_, height_};
+    return;
+  }
+  PageView meta = mgr_.readPage(file_, META_PAGE);
+  const IndexMeta* content = asMeta(*meta);
+  if (content->magic != INDEX_MAGIC) {
+    throw std::invalid_argument("not a B+tree index file: " + file_.filename());
+  }
+  root_ = content->root;
+  height_ = content->height;
+}
+
+void BTreeIndex::bulkLoad(File& file, std::span<const Entry> entries, const double fill) {
+  if (file.numPages() > META_PAGE) {
+    throw std::invalid_argument("bulk load needs an empty index file: " + file.filename());
+  }
+  for (std::size_t i = 1; i < entries.size(); ++i) {
+    if (entries[i - 1].first >= entries[i].first) {
+      throw std::invalid_argument("bulk load input is not strictly increasing");
+    }
+  }
+  const double ratio = std::clamp(fill, 0.0, 1.0);
+  const std::size_t per_leaf = std::max(1, static_cast<int>(LEAF_CAPACITY * ratio));
+  const std::size_t per_inner = std::max(2, static_cast<int>((INNER_CAPACITY + 1) * ratio));
+
+  // 每层的节点数, 从叶节点往上.  节点在各层内依次存放, 根是最后一页.
+  std::vector<std::size_t> level_sizes{
+      std::max<std::size_t>(1, (entries.size() + per_leaf - 1) / per_leaf)};
+  while (level_sizes.back() > 1) {
+    level_sizes.push_back((level_sizes.back() + per_inner - 1) / per_inner);
+  }
+  std::size_t num_nodes = 0;
+  for (const std::size_t size : level_sizes) {
+    num_nodes += size;
+  }
+
+  BulkLoader loader(file);
+  Page& meta = loader.newPage();
+  if (meta.page_number() != META_PAGE) {
+    throw std::invalid_argument("bulk load needs an empty index file: " + file.filename());
+  }
+  *asMeta(meta) = {INDEX_MAGIC, static_cast<PageId>(META_PAGE + num_nodes),
+                   static_cast<std::uint32_t>(level_sizes.size())};
+
+  // 叶节点: 把输入平均分给各个叶节点, 避免最后一个节点过空.
+  // mins 记录本层每个节点子树中的最小键, 作为上一层的分隔键.
+  PageId level_first = META_PAGE + 1;
+  const std::size_t num_leaves = level_sizes[0];
+  std::vector<Key> mins;
+  mins.reserve(num_leaves);
+  for (std::size_t i = 0; i < num_leaves; ++i) {
+    const std::size_t begin = entries.size() * i / num_leaves;
+    const std::size_t end = entries.size() * (i + 1) / num_leaves;
+    Page& page = loader.newPage();
+    LeafNode* node = asLeaf(page);
+    node->header = {1, static_cast<std::uint16_t>(end - begin),
+                    i + 1 < num_leaves ? page.page_number() + 1 : Page::INVALID_NUMBER};
+    for (std::size_t j = begin; j < end; ++j) {
+      node->keys[j - begin] = entries[j].first;
+      node->rids[j - begin] = entries[j].second;
+    }
+    mins.push_back(begin < end ? entries[begin].first : Key{});
+  }
+
+  // 内部节点: 同样把下一层的节点平均分给本层的各个节点.
+  for (std::size_t level = 1; level < level_sizes.size(); ++level) {
+    const std::size_t num_children = level_sizes[level - 1];
+    const std::size_t num_parents = level_sizes[level];
+    std::vector<Key> parent_mins;
+    parent_mins.reserve(num_parents);
+    for (std::size_t i = 0; i < num_parents; ++i) {
+      const std::size_t begin = num_children * i / num_parents;
+      const std::size_t end = num_children * (i + 1) / num_parents;
+      InnerNode* node = asInner(loader.newPage());
+      node->header = {0, static_cast<std::uint16_t>(end - begin - 1), Page::INVALID_NUMBER};
+      for (std::size_t j = begin; j < end; ++j) {
+        node->children[j - begin] = level_first + static_cast<PageId>(j);
+        if (j > begin) {
+          node->keys[j - begin - 1] = mins[j];
+        }
+      }
+      parent_mins.push_back(mins[begin]);
+    }
+    level_first += static_cast<PageId>(num_children);
+    mins = std::move(parent_mins);
+  }
+  loader.finish();
+}
+
+std::uint32_t BTreeIndex::height() const {
+  std::shared_lock<std::shared_mutex> lock(root_latch_);
+  return height_;
+}
+
+PageId BTreeIndex::descendToLeafParent(const Key key,
+                                       std::shared_lock<std::shared_mutex>& root_lock,
+                                       std::optional<PageView>& view,
+                                       std::shared_lock<std::shared_mutex>& lock) {
+  root_lock = std::shared_lock<std::shared_mutex>(root_latch_);
+  const std::uint32_t height = height_;
+  PageId page_number = root_;
+  for (std::uint32_t level = height; level > 1; --level) {
+    PageView child = mgr_.readPage(file_, page_number);
+    std::shared_lock<std::shared_mutex> child_lock(child.latch());
+    // 拿到子节点的锁之后才放开父节点 (先解锁, 再解除引用).
+    lock = std::shared_lock<std::shared_mutex>();
+    view.reset();
+    if (root_lock.owns_lock()) {
+      root_lock.unlock();
+    }
+    page_number = asInner(*child)->children[childIndex(asInner(*child), key)];
+    view.emplace(std::move(child));
+    lock = std::move(child_lock);
+  }
+  return page_number;
+}
+
+std::optional<RecordId> BTreeIndex::lookup(const Key key) {
+  std::shared_lock<std::shared_mutex> root_lock;
+  std::optional<PageView> parent;
+  std::shared_lock<std::shared_mutex> parent_lock;
+  const PageId leaf_page = descendToLeafParent(key, root_lock, parent, parent_lock);
+
+  PageView view = mgr_.readPage(file_, leaf_page);
+  std::shared_lock<std::shared_mutex> lock(view.latch());
+  parent_lock = std::shared_lock<std::shared_mutex>();
+  parent.reset();
+  root_lock = std::shared_lock<std::shared_mutex>();
+
+  const LeafNode* node = asLeaf(*view);
+  const int pos = lowerBound(node, key);
+  if (pos < node->header.num_keys && node->keys[pos] == key) {
+    return node->rids[pos];
+  }
+  return std::nullopt;
+}
+
+bool BTreeIndex::insert(const Key key, const RecordId& rid) {
+  if (const std::optional<bool> inserted = insertOptimistic(key, rid)) {
+    return *inserted;
+  }
+  return insertPessimistic(key, rid);
+}
+
+std::optional<bool> BTreeIndex::insertOptimistic(const Key key, const RecordId& rid) {
+  std::shared_lock<std::shared_mutex> root_lock;
+  std::optional<PageView> parent;
+  std::shared_lock<std::shared_mutex> parent_lock;
+  const PageId leaf_page = descendToLeafParent(key, root_lock, parent, parent_lock);
+
+  // 先以只读视图引用叶子, 确实要修改时才换成可变视图: 可变视图使页变脏,
+  // 并使叶子上的乐观读失败, 键已存在或叶子已满时都不需要.
+  PageView view = mgr_.readPage(file_, leaf_page);
+  std::unique_lock<std::shared_mutex> lock(view.latch());
+  parent_lock = std::shared_lock<std::shared_mutex>();
+  parent.reset();
+  root_lock = std::shared_lock<std::shared_mutex>();
+
+  const LeafNode* node = asLeaf(*view);
+  const int pos = lowerBound(node, key);
+  if (pos < node->header.num_keys && node->keys[pos] == key) {
+    return false;
+  }
+  if (node->header.num_keys == LEAF_CAPACITY) {
+    return std::nullopt;
+  }
+  // view 仍引用着这一页, 重新引用一定成功
+  MutablePageView writable = *mgr_.repin<MutablePageView>(view.handle());
+  leafInsertAt(asLeaf(*writable), pos, key, rid);
+  return true;
+}
+
+bool BTreeIndex::insertPessimistic(const Key key, const RecordId& rid) {
+  struct Latched {
+    PageId page_number;
+    PageView view;
+    std::unique_lock<std::shared_mutex> lock;
+  };
+
+  // 沿途的节点以只读视图引用并加排他锁, 只把分裂实际改动的节点换成可变视图:
+  // 否则每次悲观插入都会把放开的祖先 (包括根) 写回, 并使根上的乐观读失败.
+  std::unique_lock<std::shared_mutex> root_lock(root_latch_);
+  std::vector<Latched> path;
+  PageId page_number = root_;
+  for (std::uint32_t level = height_;; --level) {
+    PageView view = mgr_.readPage(file_, page_number);
+    std::unique_lock<std::shared_mutex> lock(view.latch());
+    const bool is_leaf = level == 1;
+    const bool safe = is_leaf ? asLeaf(*view)->header.num_keys < LEAF_CAPACITY
+                              : asInner(*view)->header.num_keys < INNER_CAPACITY;
+    if (safe) {
+      // 这个节点不会分裂, 分裂不会传到它的祖先, 可以放开它们.
+      path.clear();
+      if (root_lock.owns_lock()) {
+        root_lock.unlock();
+      }
+    }
+    const PageId current = page_number;
+    if (!is_leaf) {
+      page_number = asInner(*view)->children[childIndex(asInner(*view), key)];
+    }
+    path.push_back({current, std::move(view), std::move(lock)});
+    if (is_leaf) {
+      break;
+    }
+  }
+
+  const LeafNode* leaf = asLeaf(*path.back().view);
+  const int pos = lowerBound(leaf, key);
+  if (pos < leaf->header.num_keys && leaf->keys[pos] == key) {
+    return false;
+  }
+  PageId new_page;
+  Key separator;
+  {
+    // path 中的视图仍引用着这些页, 重新引用一定成功
+    MutablePageView writable = *mgr_.repin<MutablePageView>(path.back().view.handle());
+    if (leaf->header.num_keys < LEAF_CAPACITY) {
+      leafInsertAt(asLeaf(*writable), pos, key, rid);
+      return true;
+    }
+    MutablePageView right = mgr_.allocPage(file_, new_page);
+    separator = splitLeaf(asLeaf(*writable), asLeaf(*right), new_page, pos, key, rid);
+  }
+  for (int i = static_cast<int>(path.size()) - 2; i >= 0; --i) {
+    MutablePageView writable = *mgr_.repin<MutablePageView>(path[i].view.handle());
+    InnerNode* node = asInner(*writable);
+    const int child_pos = childIndex(node, separator);
+    if (node->header.num_keys < INNER_CAPACITY) {
+      innerInsertAt(node, child_pos, separator, new_page);
+      return true;
+    }
+    PageId right_page;
+    MutablePageView right = mgr_.allocPage(file_, right_page);
+    separator = splitInner(node, asInner(*right), child_pos, separator, new_page);
+    new_page = right_page;
+  }
+
+  // 根节点分裂了: 路径上的节点都不安全, 所以 root_latch_ 和旧的根都还锁着.
+  assert(root_lock.owns_lock() && path.front().page_number == root_);
+  PageId root_page;
+  MutablePageView root = mgr_.allocPage(file_, root_page);
+  InnerNode* node = asInner(*root);
+  node->header = {0, 1, Page::INVALID_NUMBER};
+  node->keys[0] = separator;
+  node->children[0] = root_;
+  node->children[1] = new_page;
+  root_ = root_page;
+  height_++;
+  writeMeta();
+  return true;
+}
+
+bool BTreeIndex::remove(const Key key) {
+  std::shared_lock<std::shared_mutex> root_lock;
+  std::optional<PageView> parent;
+  std::shared_lock<std::shared_mutex> parent_lock;
+  const PageId leaf_page = descendToLeafParent(key, root_lock, parent, parent_lock);
+
+  // 与 insertOptimistic() 一样, 找到键之后才换成可变视图
+  PageView view = mgr_.readPage(file_, leaf_page);
+  std::unique_lock<std::shared_mutex> lock(view.latch());
+  parent_lock = std::shared_lock<std::shared_mutex>();
+  parent.reset();
+  root_lock = std::shared_lock<std::shared_mutex>();
+
+  const int pos = lowerBound(asLeaf(*view), key);
+  const int n = asLeaf(*view)->header.num_keys;
+  if (pos == n || asLeaf(*view)->keys[pos] != key) {
+    return false;
+  }
+  MutablePageView writable = *mgr_.repin<MutablePageView>(view.handle());
+  LeafNode* node = asLeaf(*writable);
+  std::copy(node->keys + pos + 1, node->keys + n, node->keys + pos);
+  std::copy(node->rids + pos + 1, node->rids + n, node->rids + pos);
+  node->header.num_keys--;
+  return true;
+}
+
+BTreeScan BTreeIndex::scan(const Key low, const Key high) {
+  std::shared_lock<std::shared_mutex> root_lock;
+  std::optional<PageView> parent;
+  std::shared_lock<std::shared_mutex> parent_lock;
+  const PageId leaf_page = descendToLeafParent(low, root_lock, parent, parent_lock);
+
+  PageView view = mgr_.readPage(file_, leaf_page);
+  std::shared_lock<std::shared_mutex> lock(view.latch());
+  parent_lock = std::shared_lock<std::shared_mutex>();
+  parent.reset();
+  root_lock = std::shared_lock<std::shared_mutex>();
+
+  const int pos = lowerBound(asLeaf(*view), low);
+  return BTreeScan(*this, high, std::move(view), std::move(lock), pos);
+}
+
+void BTreeIndex::writeMeta() {
+  MutablePageView meta = mgr_.readPage<MutablePageView>(file_, META_PAGE);
+  *asMeta(*meta) = {INDEX_MAGIC, root_, height_};
+}
+
+BTreeScan::BTreeScan(BTreeIndex& index, const BTreeIndex::Key high, PageView leaf,
+                     std::shared_lock<std::shared_mutex> lock, const int position)
+    : index_(&index), high_(high), leaf_(std::move(leaf)), lock_(std::move(lock)),
+      position_(position) {}
+
+bool BTreeScan::next(BTreeIndex::Key& key, RecordId& rid) {
+  while (leaf_) {
+    const LeafNode* node = asLeaf(**leaf_);
+    if (position_ < node->header.num_keys) {
+      if (node->keys[position_] > high_) {
+        break;
+      }
+      key = node->keys[position_];
+      rid = node->rids[position_];
+      position_++;
+      return true;
+    }
+    const PageId next_page = node->header.next_leaf;
+    if (next_page == Page::INVALID_NUMBER) {
+      break;
+    }
+    // 先锁住右兄弟, 再放开当前叶节点.
+    PageView next = index_->mgr_.readPage(index_->file_, next_page);
+    std::shared_lock<std::shared_mutex> next_lock(next.latch());
+    lock_ = std::move(next_lock);
+    leaf_.reset();
+    leaf_.emplace(std::move(next));
+    position_ = 0;
+  }
+  close();
+  return false;
+}
+
+void BTreeScan::close() {
+  lock_ = std::shared_lock<std::shared_mutex>();
+  leaf_.reset();
+}
+
+}
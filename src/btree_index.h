@@ -0,0 +1,209 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <utility>
+
+#include "buffer.h"
+#include "file.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class BTreeScan;
+
+/**
+ * @brief 存放在磁盘上的 B+ 树索引, 把 64 位整数键映射到 RecordId.
+ *
+ * 索引的每个节点是索引文件中的一页, 通过 BufMgr 引用 (PageView/MutablePageView).
+ * 文件的第一页是元数据页, 记录根节点的页号和树高.  叶节点按键的顺序用右兄弟
+ * 指针串起来, 供范围扫描使用.  键是唯一的.
+ *
+ * 并发控制使用锁耦合 (latch crabbing), 锁是缓冲池帧上的读写锁:
+ * - 查找和范围扫描自上而下持有共享锁, 拿到子节点的锁后立即释放父节点的锁;
+ * - 插入先乐观地以共享锁下降, 只对叶节点加排他锁; 叶节点会分裂时,
+ *   改为悲观地以排他锁下降, 遇到不会分裂的节点就释放它所有祖先的锁;
+ * - 删除不合并节点 (节点可以变空), 所以总是走乐观路径.
+ * 因此一次查找只触及 O(log n) 个页, 不同子树上的操作可以在多个线程上并行.
+ */
+class BTreeIndex {
+ public:
+  /**
+   * 键的类型
+   */
+  using Key = std::int64_t;
+
+  /**
+   * 批量建树的输入项
+   */
+  using Entry = std::pair<Key, RecordId>;
+
+  /**
+   * 打开一个索引.  如果文件中还没有页, 就在其中建立一棵空树.
+   *
+   * @param file  索引文件, 在索引的整个生命期内必须保持打开
+   * @param mgr   通过它引用索引页的缓冲池
+   */
+  BTreeIndex(File& file, BufMgr& mgr);
+
+  /**
+   * 从按键严格递增的输入自底向上地建立一棵树, 写入空的索引文件.
+   * 先把叶节点依次装满 (到 fill 的比例), 再逐层建立内部节点, 所有节点页
+   * 用 BulkLoader 成批顺序写出, 不经过缓冲池, 也不做任何节点分裂.
+   * 之后照常用构造函数打开索引.
+   *
+   * @param file     索引文件, 其中必须还没有页
+   * @param entries  按键严格递增的 (键, 记录)
+   * @param fill     节点的填充比例, (0, 1]; 留出空位可以推迟之后插入引起的分裂
+   * @throws std::invalid_argument 文件不为空或输入不是严格递增时
+   */
+  static void bulkLoad(File& file, std::span<const Entry> entries,
+                       const double fill = 1.0);
+
+  /**
+   * 点查询
+   *
+   * @param key 键
+   * @return 键对应的记录, 键不存在时为空
+   */
+  std::optional<RecordId> lookup(const Key key);
+
+  /**
+   * 插入一个键
+   *
+   * @param key 键
+   * @param rid 键对应的记录
+   * @return 是否插入了; 键已经存在时返回 false, 索引不变
+   */
+  bool insert(const Key key, const RecordId& rid);
+
+  /**
+   * 删除一个键
+   *
+   * @param key 键
+   * @return 是否删除了; 键不存在时返回 false
+   */
+  bool remove(const Key key);
+
+  /**
+   * 开始一次范围扫描, 按键的顺序返回 [low, high] 中的所有键.
+   *
+   * @param low   下界 (含)
+   * @param high  上界 (含)
+   * @return 扫描游标
+   */
+  BTreeScan scan(const Key low, const Key high);
+
+  /**
+   * 树高, 只有一个叶节点 (根) 时为 1.
+   */
+  std::uint32_t height() const;
+
+ private:
+  friend class BTreeScan;
+
+  /**
+   * 元数据页的页号
+   */
+  static constexpr PageId META_PAGE = 1;
+
+  /**
+   * 乐观插入: 以共享锁下降, 只对叶节点加排他锁.
+   *
+   * @return 插入结果; 叶节点已满 (需要分裂) 时为空, 调用者改走悲观路径
+   */
+  std::optional<bool> insertOptimistic(const Key key, const RecordId& rid);
+
+  /**
+   * 悲观插入: 以排他锁下降, 必要时分裂节点, 一直到根.
+   */
+  bool insertPessimistic(const Key key, const RecordId& rid);
+
+  /**
+   * 以共享锁下降到包含 key 的叶节点的父节点, 返回叶节点的页号.
+   * 返回时 view/lock 持有父节点的引用和共享锁; 树高为 1 时没有父节点,
+   * 由 root_lock 持有 root_latch_.  调用者锁住叶节点之后再释放它们.
+   */
+  PageId descendToLeafParent(const Key key,
+                             std::shared_lock<std::shared_mutex>& root_lock,
+                             std::optional<PageView>& view,
+                             std::shared_lock<std::shared_mutex>& lock);
+
+  /**
+   * 把新的根写入元数据页.  调用者须以排他方式持有 root_latch_.
+   */
+  void writeMeta();
+
+  File& file_;
+  BufMgr& mgr_;
+
+  /**
+   * 保护 root_ 和 height_.  根节点分裂时需要以排他方式持有它.
+   */
+  mutable std::shared_mutex root_latch_;
+
+  /**
+   * 根节点的页号
+   */
+  PageId root_;
+
+  /**
+   * 树高
+   */
+  std::uint32_t height_;
+};
+
+/**
+ * @brief B+ 树的范围扫描游标.
+ *
+ * 游标在任何时刻持有当前叶节点的引用和共享锁, 沿着叶节点的右兄弟指针前进,
+ * 先锁住右兄弟再释放当前叶节点.  用完后请尽快销毁游标, 以免阻塞对该叶节点的写入.
+ */
+class BTreeScan {
+ public:
+  /**
+   * 取下一个键
+   *
+   * @param key 输出: 键
+   * @param rid 输出: 键对应的记录
+   * @return 是否还有键; 返回 false 后游标不再持有任何页
+   */
+  bool next(BTreeIndex::Key& key, RecordId& rid);
+
+ private:
+  friend class BTreeIndex;
+
+  BTreeScan(BTreeIndex& index, const BTreeIndex::Key high, PageView leaf,
+            std::shared_lock<std::shared_mutex> lock, const int position);
+
+  /**
+   * 释放当前叶节点
+   */
+  void close();
+
+  BTreeIndex* index_;
+  BTreeIndex::Key high_;
+
+  /**
+   * 当前叶节点 (锁必须在视图之前释放, 所以它声明在锁之前)
+   */
+  std::optional<PageView> leaf_;
+  std::shared_lock<std::shared_mutex> lock_;
+
+  /**
+   * 下一个键在当前叶节点中的位置
+   */
+  int position_;
+};
+
+}
@@ -16,14 +16,41 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File::sptr file, const PageId pageNo)
+namespace {
+
+/**
+ * 异常信息里用到的文件名; 文件已经关闭时给出占位名字.
+ */
+const std::string& nameOf(const FileId file)
+{
+  static const std::string closed = "<closed file>";
+  const File* f = FileRegistry::get(file);
+  return f ? f->filename() : closed;
+}
+
+}
+
+int BufHashTbl::hash(const FileId file, const PageId pageNo, const int size)
 {
-  intptr_t tmp; 
-  tmp = (intptr_t)file.get();  // cast of pointer to the file object to an integer
-  int value = (tmp + pageNo) % HTSIZE;
+  // 把 (file, pageNo) 拼成 64 位键后做一次乘法散列, 让相邻页号和相邻文件编号
+  // 都均匀地落到不同的桶里.
+  std::uint64_t key = (static_cast<std::uint64_t>(file) << 32) | pageNo;
+  key *= 0x9E3779B97F4A7C15ull;
+  int value = static_cast<int>((key >> 32) % static_cast<std::uint64_t>(size));
   return value;
 }
 
+hashBucket** BufHashTbl::locate(hashBucket** table, const int size, const FileId file, const PageId pageNo)
+{
+  hashBucket** link = &table[hash(file, pageNo, size)];
+  while (*link) {
+    if ((*link)->file == file && (*link)->pageNo == pageNo)
+      return link;
+    link = &(*link)->next;
+  }
+  return NULL;
+}
+
 BufHashTbl::BufHashTbl(int htSize)
 	: HTSIZE(htSize)
 {
@@ -35,81 +62,101 @@ BufHashTbl::BufHashTbl(int htSize)
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
+  for (hashBucket** table : {ht, old_ht}) {
+    const int size = table == ht ? HTSIZE : OLD_HTSIZE;
+    for(int i = 0; table && i < size; i++) {
+      while (table[i]) {
+        hashBucket* tmpBuf = table[i];
+        table[i] = table[i]->next;
+        delete tmpBuf;
+      }
     }
   }
   delete [] ht;
+  delete [] old_ht;
 }
 
-void BufHashTbl::insert(const File::sptr file, const PageId pageNo, const FrameId frameNo)
+void BufHashTbl::resize(const int htSize)
 {
-  int index = hash(file, pageNo);
+  if (old_ht)
+    rehashStep(OLD_HTSIZE);
+  hashBucket** table = new hashBucket* [htSize];
+  for(int i=0; i < htSize; i++)
+    table[i] = NULL;
+  old_ht = ht;
+  OLD_HTSIZE = HTSIZE;
+  rehash_index = 0;
+  ht = table;
+  HTSIZE = htSize;
+}
 
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file.get() && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+void BufHashTbl::rehashStep(int buckets)
+{
+  for (; old_ht && buckets > 0; buckets--) {
+    // 节点整体移到新表, 不重新分配
+    while (hashBucket* tmpBuc = old_ht[rehash_index]) {
+      old_ht[rehash_index] = tmpBuc->next;
+      const int index = hash(tmpBuc->file, tmpBuc->pageNo, HTSIZE);
+      tmpBuc->next = ht[index];
+      ht[index] = tmpBuc;
+    }
+    if (++rehash_index == OLD_HTSIZE) {
+      delete [] old_ht;
+      old_ht = NULL;
+      OLD_HTSIZE = 0;
+    }
   }
+}
 
-  tmpBuc = new hashBucket;
+void BufHashTbl::insert(const FileId file, const PageId pageNo, const FrameId frameNo)
+{
+  rehashStep(REHASH_STEP);
+  hashBucket** existing = locate(ht, HTSIZE, file, pageNo);
+  if (!existing && old_ht)
+    existing = locate(old_ht, OLD_HTSIZE, file, pageNo);
+  if (existing)
+    throw HashAlreadyPresentException(nameOf(file), pageNo, (*existing)->frameNo);
+
+  hashBucket* tmpBuc = new hashBucket;
   if (!tmpBuc)
   	throw HashTableException();
 
-  tmpBuc->file = file.get();
+  const int index = hash(file, pageNo, HTSIZE);
+  tmpBuc->file = file;
   tmpBuc->pageNo = pageNo;
   tmpBuc->frameNo = frameNo;
   tmpBuc->next = ht[index];
   ht[index] = tmpBuc;
 }
 
-void BufHashTbl::lookup(const File::sptr file, const PageId pageNo, FrameId &frameNo) 
+void BufHashTbl::lookup(const FileId file, const PageId pageNo, FrameId &frameNo) const
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file.get() && tmpBuc->pageNo == pageNo)
-    {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
-    }
-    tmpBuc = tmpBuc->next;
-  }
-
-  throw HashNotFoundException(file->filename(), pageNo);
+  if (!find(file, pageNo, frameNo))
+    throw HashNotFoundException(nameOf(file), pageNo);
 }
 
-void BufHashTbl::remove(const File::sptr file, const PageId pageNo) {
-
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = NULL;
-
-  while (tmpBuc)
-	{
-    if (tmpBuc->file == file.get() && tmpBuc->pageNo == pageNo)
-		{
-      if(prevBuc) 
-				prevBuc->next = tmpBuc->next;
-      else
-				ht[index] = tmpBuc->next;
-
-      delete tmpBuc;
-      return;
-    }
-		else
-		{
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
-    }
-  }
+bool BufHashTbl::find(const FileId file, const PageId pageNo, FrameId &frameNo) const
+{
+  hashBucket** link = locate(ht, HTSIZE, file, pageNo);
+  if (!link && old_ht)
+    link = locate(old_ht, OLD_HTSIZE, file, pageNo);
+  if (!link)
+    return false;
+  frameNo = (*link)->frameNo; // return frameNo by reference
+  return true;
+}
 
-  throw HashNotFoundException(file->filename(), pageNo);
+void BufHashTbl::remove(const FileId file, const PageId pageNo) {
+  rehashStep(REHASH_STEP);
+  hashBucket** link = locate(ht, HTSIZE, file, pageNo);
+  if (!link && old_ht)
+    link = locate(old_ht, OLD_HTSIZE, file, pageNo);
+  if (!link)
+    throw HashNotFoundException(nameOf(file), pageNo);
+
+  hashBucket* tmpBuc = *link;
+  *link = tmpBuc->next;
+  delete tmpBuc;
 }
 
 }
@@ -16,9 +16,9 @@ namespace badgerdb {
 */
 struct hashBucket {
 	/**
-	 * pointer a file object (more on this below)
+	 * 文件编号
 	 */
-	File *file;
+	FileId file;
 
 	/**
 	 * page number within a file
@@ -40,6 +40,10 @@ struct hashBucket {
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
+* 表的大小可以在使用中改变 (resize()): 新的桶数组分配好以后, 旧表中的链
+* 在之后的每次 insert() 和 remove() 中迁移 REHASH_STEP 个桶, 而不是一次全部重新散列;
+* 迁移期间查找同时查两张表.
+*
 * @warning This class is not threadsafe.
 */
 class BufHashTbl
@@ -53,15 +57,35 @@ class BufHashTbl
 	 * Actual Hash table object
 	 */
   hashBucket**  ht;
+	/**
+	 * 正在迁移时的旧表及其大小, 不在迁移时为 nullptr
+	 */
+  hashBucket**  old_ht = nullptr;
+  int OLD_HTSIZE = 0;
+	/**
+	 * 旧表中下一个要迁移的桶
+	 */
+  int rehash_index = 0;
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * returns hash value between 0 and size-1 computed using file and pageNo
 	 *
-	 * @param file   	File object
+	 * @param file   	文件编号
 	 * @param pageNo  Page number in the file
+	 * @param size    表的大小
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File::sptr file, const PageId pageNo);
+  static int hash(const FileId file, const PageId pageNo, const int size);
+
+	/**
+	 * 迁移旧表中的至多 buckets 个桶, 迁移完时释放旧表
+	 */
+  void rehashStep(int buckets);
+
+	/**
+	 * 在一张表中查找, 找到时返回指向该节点的指针的地址 (便于删除)
+	 */
+  static hashBucket** locate(hashBucket** table, const int size, const FileId file, const PageId pageNo);
 
  public:
 	/**
@@ -73,37 +97,74 @@ class BufHashTbl
    * Destructor of BufHashTbl class
 	 */
   ~BufHashTbl(); // destructor
+
+	BufHashTbl(const BufHashTbl&) = delete;
+	BufHashTbl& operator=(const BufHashTbl&) = delete;
+
+	/**
+	 * 每次 insert() 或 remove() 迁移的旧表的桶数
+	 */
+	static constexpr int REHASH_STEP = 8;
+
+	/**
+	 * 把表的大小改为 htSize.  只分配新的桶数组, 已有的项在之后的操作中逐步迁移;
+	 * 上一次改变大小还没有迁移完时, 先把它迁移完.
+	 *
+	 * @param htSize 新的大小
+	 */
+  void resize(const int htSize);
+
+	/**
+	 * 表的 (目标) 大小
+	 */
+  int size() const { return HTSIZE; }
+
+	/**
+	 * 是否还在迁移旧表
+	 */
+  bool rehashing() const { return old_ht != nullptr; }
 	
 	/**
    * Insert entry into hash table mapping (file, pageNo) to frameNo.
 	 *
-	 * @param file   	File object
+	 * @param file   	文件编号
 	 * @param pageNo 	Page number in the file
 	 * @param frameNo Frame number assigned to that page of the file
    * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
    * @throws  HashTableException (optional) if could not create a new bucket as running of memory
 	 */
-  void insert(const File::sptr file, const PageId pageNo, const FrameId frameNo);
+  void insert(const FileId file, const PageId pageNo, const FrameId frameNo);
 
 	/**
    * Check if (file, pageNo) is currently in the buffer pool (ie. in
    * the hash table).
 	 *
-	 * @param file  	File object
+	 * @param file  	文件编号
 	 * @param pageNo	Page number in the file
 	 * @param frameNo Frame number reference
    * @throws HashNotFoundException if the page entry is not found in the hash table 
 	 */
-  void lookup(const File::sptr file, const PageId pageNo, FrameId &frameNo);
+  void lookup(const FileId file, const PageId pageNo, FrameId &frameNo) const;
+
+	/**
+	 * 与 lookup() 相同,但找不到时返回 false 而不是抛出异常,
+	 * 缓冲池的未命中路径用它来避免异常的开销.
+	 *
+	 * @param file  	文件编号
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference
+	 * @return 是否找到
+	 */
+  bool find(const FileId file, const PageId pageNo, FrameId &frameNo) const;
 
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
-	 * @param file   	File object
+	 * @param file   	文件编号
 	 * @param pageNo  Page number in the file
    * @throws HashNotFoundException if the page entry is not found in the hash table 
 	 */
-  void remove(const File::sptr file, const PageId pageNo);  
+  void remove(const FileId file, const PageId pageNo);  
 };
 
 }
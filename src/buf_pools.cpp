@@ -0,0 +1,119 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "buf_pools.h"
+
+#include <mutex>
+#include <stdexcept>
+
+namespace badgerdb {
+
+BufPools::BufPools(const std::string& default_name, const std::uint32_t default_bufs) {
+  default_ = &create(default_name, default_bufs);
+  close_listener_ = FileRegistry::addCloseListener([this](File& file) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    bindings_.erase(file.id());
+  });
+}
+
+BufPools::~BufPools() {
+  FileRegistry::removeCloseListener(close_listener_);
+}
+
+BufMgr& BufPools::create(const std::string& name, const std::uint32_t bufs) {
+  // 在 mutex_ 之外构造: BufMgr 登记关闭回调, 而关闭回调会取 mutex_
+  auto mgr = std::make_unique<BufMgr>(bufs);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  if (pools_.count(name) > 0) {
+    throw std::invalid_argument("buffer pool already exists: " + name);
+  }
+  BufMgr& ref = *mgr;
+  pools_.emplace(name, std::move(mgr));
+  return ref;
+}
+
+BufMgr& BufPools::pool(const std::string& name) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const auto it = pools_.find(name);
+  if (it == pools_.end()) {
+    throw std::out_of_range("no buffer pool named " + name);
+  }
+  return *it->second;
+}
+
+std::vector<std::string> BufPools::names() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  std::vector<std::string> names;
+  names.reserve(pools_.size());
+  for (const auto& [name, mgr] : pools_) {
+    names.push_back(name);
+  }
+  return names;
+}
+
+void BufPools::bind(File& file, const std::string& name) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  const auto it = pools_.find(name);
+  if (it == pools_.end()) {
+    throw std::out_of_range("no buffer pool named " + name);
+  }
+  BufMgr* const target = it->second.get();
+  const auto bound = bindings_.find(file.id());
+  BufMgr* const current = bound == bindings_.end() ? default_ : bound->second;
+  if (current != target) {
+    current->flushFile(file);
+  }
+  if (target == default_) {
+    bindings_.erase(file.id());
+  } else {
+    bindings_[file.id()] = target;
+  }
+}
+
+void BufPools::unbind(File& file) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  const auto bound = bindings_.find(file.id());
+  if (bound == bindings_.end()) {
+    default_->flushFile(file);
+    return;
+  }
+  bound->second->flushFile(file);
+  bindings_.erase(bound);
+}
+
+void BufPools::dropFile(File::sptr& file) {
+  // 不持有 mutex_: 关闭文件时的回调会取它来解除绑定
+  poolOf(*file).dropFile(file);
+}
+
+BufMgr& BufPools::poolOf(const File& file) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const auto bound = bindings_.find(file.id());
+  return bound == bindings_.end() ? *default_ : *bound->second;
+}
+
+BufStats BufPools::getBufStats() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  BufStats total;
+  for (const auto& [name, mgr] : pools_) {
+    const BufStats stats = mgr->getBufStats();
+    total += stats;
+    for (const auto& [id, file] : stats.files) {
+      total.files[id] += file;
+    }
+  }
+  return total;
+}
+
+void BufPools::clearBufStats() {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  for (const auto& [name, mgr] : pools_) {
+    mgr->clearBufStats();
+  }
+}
+
+}
@@ -0,0 +1,174 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 一组有名字的缓冲池, 以及把文件分派到其中一个池的路由.
+ *
+ * 所有文件共用一个池时, 一次大表扫描会把小而热的索引页挤出去.  把文件
+ * 绑定到各自大小的池 (如 "index", "heap", "temp") 可以隔离它们:
+ * 一个池中的换出不影响其他池.  没有绑定的文件使用默认池.
+ *
+ * 调用者通过 readPage() 等函数访问页, 不需要知道文件在哪个池中;
+ * 需要 BufMgr& 的算子 (如 BTreeIndex) 可以直接传入 poolOf(file).
+ *
+ * @code
+ * BufPools pools("heap", 4096);
+ * pools.create("index", 512);
+ * pools.bind(index_file, "index");
+ * BTreeIndex index(index_file, pools.poolOf(index_file));
+ * auto page = pools.readPage(heap_file, 1);  // 在 "heap" 池中
+ * @endcode
+ *
+ * 多个线程可以同时使用; 绑定和创建池之间互斥, 路由只取共享锁.
+ * 池在 BufPools 析构之前一直存在.  文件关闭时它的绑定随之解除, 编号被重用后
+ * 新文件使用默认池.
+ */
+class BufPools {
+ public:
+  /**
+   * @param default_name 默认池的名字
+   * @param default_bufs 默认池的帧数
+   */
+  BufPools(const std::string& default_name, const std::uint32_t default_bufs);
+
+  ~BufPools();
+
+  BufPools(const BufPools&) = delete;
+  BufPools& operator=(const BufPools&) = delete;
+
+  /**
+   * 创建一个有 bufs 个帧的池
+   *
+   * @throws std::invalid_argument 已有同名的池, 或 bufs 为 0 时
+   */
+  BufMgr& create(const std::string& name, const std::uint32_t bufs);
+
+  /**
+   * 名为 name 的池
+   *
+   * @throws std::out_of_range 没有这个池时
+   */
+  BufMgr& pool(const std::string& name) const;
+
+  /**
+   * 默认池
+   */
+  BufMgr& defaultPool() const { return *default_; }
+
+  /**
+   * 所有池的名字, 按字典序
+   */
+  std::vector<std::string> names() const;
+
+  /**
+   * 把文件绑定到名为 name 的池.  文件原来所在的池中它的页先被写回并移出
+   * (见 BufMgr::flushFile()), 所以之后不会有同一页的两个副本.
+   * 不应与对该文件的访问同时进行.
+   *
+   * @throws std::out_of_range 没有这个池时
+   * @throws PagePinnedException 文件在原来的池中还有被引用的页时 (绑定不变)
+   */
+  void bind(File& file, const std::string& name);
+
+  /**
+   * 写回文件的所有页并解除绑定 (文件关闭时绑定会自动解除)
+   *
+   * @throws PagePinnedException 文件还有被引用的页时 (绑定不变)
+   */
+  void unbind(File& file);
+
+  /**
+   * 文件所在的池, 没有绑定时为默认池
+   */
+  BufMgr& poolOf(const File& file) const;
+
+  /**
+   * 见 BufMgr::readPage()
+   */
+  template <is_page_view IPageView = PageView>
+  IPageView readPage(File& file, const PageId page_no) {
+    return poolOf(file).readPage<IPageView>(file, page_no);
+  }
+
+  /**
+   * 带着 ring 读页, 见 BufMgr::readPage().  一个环只应用于同一个池中的文件.
+   */
+  template <is_page_view IPageView = PageView>
+  IPageView readPage(File& file, const PageId page_no, AccessRing& ring) {
+    return poolOf(file).readPage<IPageView>(file, page_no, ring);
+  }
+
+  /**
+   * 见 BufMgr::allocPage()
+   */
+  MutablePageView allocPage(File& file, PageId& page_no) {
+    return poolOf(file).allocPage(file, page_no);
+  }
+
+  /**
+   * 见 BufMgr::allocPage()
+   */
+  MutablePageView allocPage(File& file, PageId& page_no, AccessRing& ring) {
+    return poolOf(file).allocPage(file, page_no, ring);
+  }
+
+  /**
+   * 见 BufMgr::flushFile()
+   */
+  void flushFile(File& file) { poolOf(file).flushFile(file); }
+
+  /**
+   * 见 BufMgr::discardFile()
+   */
+  void discardFile(File& file) { poolOf(file).discardFile(file); }
+
+  /**
+   * 在文件所在的池中删除它并解除绑定, 见 BufMgr::dropFile()
+   */
+  void dropFile(File::sptr& file);
+
+  /**
+   * 见 BufMgr::disposePage()
+   */
+  void disposePage(File& file, const PageId page_no) { poolOf(file).disposePage(file, page_no); }
+
+  /**
+   * 所有池的使用情况之和.  各池的计数按文件编号细分, 一个文件只在它所在的池中有计数.
+   */
+  BufStats getBufStats() const;
+
+  /**
+   * 清零所有池的计数
+   */
+  void clearBufStats();
+
+ private:
+  /// 保护下面的两个表
+  mutable std::shared_mutex mutex_;
+  std::map<std::string, std::unique_ptr<BufMgr>> pools_;
+  /// 文件编号到池的绑定
+  std::unordered_map<FileId, BufMgr*> bindings_;
+  BufMgr* default_;
+  /// FileRegistry 中关闭回调的标识, 回调解除关闭的文件的绑定
+  std::uint64_t close_listener_;
+};
+
+}
@@ -0,0 +1,106 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "buf_stats.h"
+
+#include "file.h"
+
+namespace badgerdb {
+
+FileStats& FileStats::operator+=(const FileStats& rhs) {
+  accesses += rhs.accesses;
+  hits += rhs.hits;
+  misses += rhs.misses;
+  diskreads += rhs.diskreads;
+  diskwrites += rhs.diskwrites;
+  evictions += rhs.evictions;
+  dirty_evictions += rhs.dirty_evictions;
+  pin_waits += rhs.pin_waits;
+  optimistic_reads += rhs.optimistic_reads;
+  optimistic_fails += rhs.optimistic_fails;
+  return *this;
+}
+
+FileStats& FileStats::operator-=(const FileStats& rhs) {
+  accesses -= rhs.accesses;
+  hits -= rhs.hits;
+  misses -= rhs.misses;
+  diskreads -= rhs.diskreads;
+  diskwrites -= rhs.diskwrites;
+  evictions -= rhs.evictions;
+  dirty_evictions -= rhs.dirty_evictions;
+  pin_waits -= rhs.pin_waits;
+  optimistic_reads -= rhs.optimistic_reads;
+  optimistic_fails -= rhs.optimistic_fails;
+  return *this;
+}
+
+BufStats BufStats::operator-(const BufStats& earlier) const {
+  BufStats delta = *this;
+  static_cast<FileStats&>(delta) -= earlier;
+  for (const auto& [file, stats] : earlier.files) {
+    delta.files[file] -= stats;
+  }
+  return delta;
+}
+
+BufStats BufCounters::snapshot() const {
+  BufStats stats;
+  for (FileId slot = 0; slot <= MAX_FILES; ++slot) {
+    std::uint64_t sums[NUM_COUNTERS] = {};
+    bool any = false;
+    for (const Shard& shard : shards_) {
+      for (unsigned c = 0; c < NUM_COUNTERS; ++c) {
+        sums[c] += shard.counts[slot][c].load(std::memory_order_relaxed);
+        any |= sums[c] != 0;
+      }
+    }
+    if (!any) {
+      continue;
+    }
+    FileStats file;
+    file.accesses = sums[ACCESSES];
+    file.hits = sums[HITS];
+    file.misses = sums[MISSES];
+    file.diskreads = sums[DISK_READS];
+    file.diskwrites = sums[DISK_WRITES];
+    file.evictions = sums[EVICTIONS];
+    file.dirty_evictions = sums[DIRTY_EVICTIONS];
+    file.pin_waits = sums[PIN_WAITS];
+    file.optimistic_reads = sums[OPTIMISTIC_READS];
+    file.optimistic_fails = sums[OPTIMISTIC_FAILS];
+    stats += file;
+    stats.files[slot == MAX_FILES ? FileRegistry::INVALID_ID : slot] = file;
+  }
+  return stats;
+}
+
+void BufCounters::clear() {
+  for (Shard& shard : shards_) {
+    for (auto& file : shard.counts) {
+      for (auto& count : file) {
+        count.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+void BufCounters::retire(const FileId file) {
+  if (file >= MAX_FILES) {
+    return;
+  }
+  for (Shard& shard : shards_) {
+    for (unsigned c = 0; c < NUM_COUNTERS; ++c) {
+      const std::uint64_t n = shard.counts[file][c].exchange(0, std::memory_order_relaxed);
+      if (n != 0) {
+        shard.counts[MAX_FILES][c].fetch_add(n, std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+}
@@ -0,0 +1,151 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 一组缓冲池计数器的取值, 用于整个缓冲池或其中一个文件
+ */
+struct FileStats {
+  /// 访问次数 (readPage 和 allocPage)
+  std::uint64_t accesses = 0;
+  /// 页已经在缓冲池中的访问
+  std::uint64_t hits = 0;
+  /// 需要读盘 (或新分配) 的访问
+  std::uint64_t misses = 0;
+  /// Number of pages read from disk (including allocs)
+  std::uint64_t diskreads = 0;
+  /// Number of pages written back to disk
+  std::uint64_t diskwrites = 0;
+  /// 为了腾出帧而换出的页
+  std::uint64_t evictions = 0;
+  /// 换出时需要先写回的脏页 (也计入 diskwrites)
+  std::uint64_t dirty_evictions = 0;
+  /// 访问时页正在被其他线程读入, 需要等待的次数
+  std::uint64_t pin_waits = 0;
+  /// 不引用页、验证版本成功的乐观读 (不计入 accesses)
+  std::uint64_t optimistic_reads = 0;
+  /// 验证失败、改为引用页的乐观读
+  std::uint64_t optimistic_fails = 0;
+
+  /// 命中率 hits / accesses, 没有访问时为 0
+  double hitRatio() const {
+    return accesses == 0 ? 0 : static_cast<double>(hits) / static_cast<double>(accesses);
+  }
+
+  FileStats& operator+=(const FileStats& rhs);
+  FileStats& operator-=(const FileStats& rhs);
+};
+
+/**
+ * @brief 缓冲池使用情况的快照: 总计, 以及按文件编号 (FileId) 的细分.
+ *
+ * 两个快照相减得到期间的增量:
+ * @code
+ * const BufStats before = mgr.getBufStats();
+ * runQuery();
+ * const BufStats delta = mgr.getBufStats() - before;
+ * @endcode
+ *
+ * 细分按文件编号.  编号会被重用, 所以文件关闭时它的计数并入 FileRegistry::INVALID_ID
+ * 下的合计, 一个编号的细分只属于正在使用它的文件 (跨越文件关闭的两个快照之差中,
+ * 该编号的细分没有意义).  编号不小于 BufCounters::MAX_FILES 的文件也合计在 INVALID_ID 下.
+ */
+struct BufStats : FileStats {
+  /// 有过计数的文件的细分
+  std::map<FileId, FileStats> files;
+
+  //Clear all values to zero
+  void clear() { *this = BufStats(); }
+
+  /**
+   * 与更早的快照 earlier 之差
+   */
+  BufStats operator-(const BufStats& earlier) const;
+};
+
+/**
+ * @brief 缓冲池的计数器, 按线程分片以免多个线程争用同一个缓存行.
+ *
+ * 每个线程固定使用一个分片 (按线程第一次计数的先后轮流分配), 计数是分片内的
+ * 一次 relaxed 原子加; snapshot() 把所有分片加起来.  计数器为 64 位, 不会溢出.
+ */
+class BufCounters {
+ public:
+  enum Counter : unsigned {
+    ACCESSES,
+    HITS,
+    MISSES,
+    DISK_READS,
+    DISK_WRITES,
+    EVICTIONS,
+    DIRTY_EVICTIONS,
+    PIN_WAITS,
+    OPTIMISTIC_READS,
+    OPTIMISTIC_FAILS,
+    NUM_COUNTERS,
+  };
+
+  /// 分片数
+  static constexpr unsigned NUM_SHARDS = 16;
+  /// 单独计数的文件编号个数, 更大的编号合计在一起
+  static constexpr FileId MAX_FILES = 64;
+
+  BufCounters() = default;
+  BufCounters(const BufCounters&) = delete;
+  BufCounters& operator=(const BufCounters&) = delete;
+
+  /**
+   * 把文件 file 的计数器 counter 加 n
+   */
+  void add(const Counter counter, const FileId file, const std::uint64_t n = 1) {
+    const FileId slot = file < MAX_FILES ? file : MAX_FILES;
+    shards_[shardIndex()].counts[slot][counter].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /**
+   * 所有分片的合计.  与计数同时进行时, 各计数器分别是某一时刻的值.
+   */
+  BufStats snapshot() const;
+
+  /**
+   * 清零.  与计数同时进行时, 同时发生的计数可能保留也可能被清掉.
+   */
+  void clear();
+
+  /**
+   * 文件关闭时调用: 把它的计数移到合计 (INVALID_ID) 中, 总数不变,
+   * 之后使用同一编号的文件从 0 开始计数.
+   */
+  void retire(const FileId file);
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<std::uint64_t> counts[MAX_FILES + 1][NUM_COUNTERS] = {};
+  };
+
+  /**
+   * 本线程的分片
+   */
+  static unsigned shardIndex() {
+    static std::atomic<unsigned> next{0};
+    thread_local const unsigned index = next.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+    return index;
+  }
+
+  Shard shards_[NUM_SHARDS];
+};
+
+}
@@ -5,78 +5,666 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <memory>
 #include <iostream>
 #include "buffer.h"
+#include "event_trace.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
+#include "exceptions/file_open_exception.h"
 #include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
 namespace badgerdb { 
 
+namespace {
+
+/**
+ * 帧数为 bufs 时页表的大小
+ */
+int tableSizeFor(const std::uint32_t bufs) {
+	return ((((int) (bufs * 1.2))*2)/2)+1;
+}
+
+/**
+ * 异常信息中的文件名.  文件可能已经关闭, 那时只有编号.
+ */
+std::string nameOf(const FileId file) {
+	const File* const f = FileRegistry::get(file);
+	return f != nullptr ? f->filename() : "#" + std::to_string(file);
+}
+
+/**
+ * 把退出的帧的页所占的物理内存还给操作系统, 虚拟地址保持有效.
+ * 页按 PAGE_IO_ALIGNMENT (操作系统页的整数倍) 对齐, 不会影响相邻的内存.
+ */
+void releasePageMemory(Page& page) {
+#if defined(MADV_DONTNEED)
+	::madvise(static_cast<void*>(&page), Page::SIZE, MADV_DONTNEED);
+#else
+	static_cast<void>(page);
+#endif
+}
+
+}
+
 BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs),frame_of_each_file_and_page(((((int) (bufs * 1.2))*2)/2)+1){
-	frames.reserve(bufs);
+	: numBufs(bufs),frame_of_each_file_and_page(tableSizeFor(bufs)),
+	  reuse(4 * static_cast<std::uint64_t>(bufs)){
+	if (bufs == 0) {
+		throw std::invalid_argument("buffer pool needs at least one frame");
+	}
+	segments.push_back({0, bufs, std::unique_ptr<Page[]>(new Page[bufs])});
   for (FrameId i = 0; i < bufs; i++){
-		frames.push_back(StatedPage(i));
+		frames.emplace_back(i, segments.back().pages[i]);
   }
   clockHand = bufs - 1;
+	close_listener = FileRegistry::addCloseListener([this](File& file) { releaseFile(file); });
 }
 
 
 BufMgr::~BufMgr() {
+	FileRegistry::removeCloseListener(close_listener);
 }
 
 void BufMgr::advanceClock(){
+	clockHand = (clockHand + 1) % numBufs;
+}
+
+AccessRing::AccessRing(const AccessStrategy strategy, std::uint32_t frames) : strategy_(strategy) {
+	if (strategy == AccessStrategy::Normal) {
+		frames = 0;
+	} else if (frames == 0) {
+		frames = strategy == AccessStrategy::Sequential ? SEQUENTIAL_FRAMES : BULK_WRITE_FRAMES;
+	}
+	slots.assign(frames, NO_FRAME);
+}
+
+void BufMgr::evictFrame(StatedPage& frame) {
+	counters.add(BufCounters::EVICTIONS, frame.file);
+	if (frame.dirty) {
+		frame.dump_to_file();
+		counters.add(BufCounters::DIRTY_EVICTIONS, frame.file);
+		counters.add(BufCounters::DISK_WRITES, frame.file);
+	}
+	detachFrame(frame);
+}
+
+void BufMgr::linkFrame(FrameList& list, FrameLinks StatedPage::*links, const FrameId frameNo) {
+	FrameLinks& link = frames[frameNo].*links;
+	link.prev = NO_FRAME;
+	link.next = list.head;
+	if (list.head != NO_FRAME) {
+		(frames[list.head].*links).prev = frameNo;
+	}
+	list.head = frameNo;
+	list.size++;
+}
+
+void BufMgr::unlinkFrame(FrameList& list, FrameLinks StatedPage::*links, const FrameId frameNo) {
+	FrameLinks& link = frames[frameNo].*links;
+	if (link.prev != NO_FRAME) {
+		(frames[link.prev].*links).next = link.next;
+	} else {
+		list.head = link.next;
+	}
+	if (link.next != NO_FRAME) {
+		(frames[link.next].*links).prev = link.prev;
+	}
+	link = FrameLinks();
+	list.size--;
+}
+
+BufMgr::FileFrames& BufMgr::framesOf(const FileId file) {
+	if (file >= file_frames.size()) {
+		file_frames.resize(file + 1);
+	}
+	return file_frames[file];
+}
+
+void BufMgr::attachFrame(StatedPage& frame, const FileId file, const PageId pageNo) {
+	frame_of_each_file_and_page.insert(file, pageNo, frame.frameNo);
+	frame.occupy_for(file, pageNo);
+	// acq_rel: 之后读入帧的页不会被提前到代数改变之前
+	frame.generation.exchange(++generations, std::memory_order_acq_rel);
+	linkFrame(framesOf(file).resident, &StatedPage::file_link, frame.frameNo);
+}
+
+void BufMgr::detachFrame(StatedPage& frame) {
+	if (frame.file != FileRegistry::INVALID_ID) {
+		FileFrames& owner = framesOf(frame.file);
+		unlinkFrame(owner.resident, &StatedPage::file_link, frame.frameNo);
+		if (frame.dirty) {
+			unlinkFrame(owner.dirty, &StatedPage::dirty_link, frame.frameNo);
+		}
+		frame_of_each_file_and_page.remove(frame.file, frame.pageNo);
+	}
+	frame.Clear();
+	frame.generation.exchange(++generations, std::memory_order_acq_rel);
+	// 只有读入失败时帧才会带着引用 (和可变视图的登记) 被移出
+	if (frame.writers > 0) {
+		frame.writers = 0;
+		frame.version.fetch_add(1, std::memory_order_release);
+	}
+}
+
+void BufMgr::releaseFile(File& file) {
+	std::lock_guard<std::mutex> guard(latch);
+	const FileId id = file.id();
+	if (id < file_frames.size()) {
+		FileFrames& owner = file_frames[id];
+		while (owner.resident.head != NO_FRAME) {
+			StatedPage& frame = frames[owner.resident.head];
+			// 有可变视图时页可能正被修改, 不写回
+			if (frame.dirty && !frame.io_pending && frame.writers == 0) {
+				try {
+					frame.dump_to_file();
+					counters.add(BufCounters::DISK_WRITES, id);
+				} catch (const std::exception&) {
+					// 文件正在关闭, 无法报告; 页被丢弃
+				}
+			}
+			if (frame.pinCnt == 0 && !frame.io_pending) {
+				detachFrame(frame);
+				continue;
+			}
+			unlinkFrame(owner.resident, &StatedPage::file_link, frame.frameNo);
+			if (frame.dirty) {
+				unlinkFrame(owner.dirty, &StatedPage::dirty_link, frame.frameNo);
+			}
+			frame_of_each_file_and_page.remove(id, frame.pageNo);
+			frame.file = FileRegistry::INVALID_ID;
+			frame.dirty = false;
+			// 句柄不能再重新引用它
+			frame.generation.exchange(++generations, std::memory_order_acq_rel);
+		}
+	}
+	traceEvent(TraceEventKind::Close, id, 0);
+	counters.retire(id);
+}
+
+void BufMgr::markDirty(StatedPage& frame) {
+	if (!frame.dirty) {
+		frame.dirty = true;
+		linkFrame(framesOf(frame.file).dirty, &StatedPage::dirty_link, frame.frameNo);
+	}
+}
+
+FrameId BufMgr::allocFrame(AccessRing* ring) {
+	BADGERDB_TRACE_SCOPE("BufMgr::allocFrame");
+	if (ring != nullptr && !ring->slots.empty()) {
+		// 环不超过缓冲池的 1/8, 否则小缓冲池中一次扫描就会占去大部分帧
+		const std::uint32_t limit = std::min(ring->size(), std::max<std::uint32_t>(1, numBufs / 8));
+		ring->current = (ring->current + 1) % limit;
+		FrameId& slot = ring->slots[ring->current];
+		// 环中的帧可能已经被时钟换出并分给了别的页: 那时它被标记为最近访问过, 不再重用.
+		if (slot < numBufs) {
+			StatedPage& frame = frames[slot];
+			if (frame.pinCnt == 0 && !frame.io_pending && !frame.recently_referenced) {
+				if (frame.valid) {
+					evictFrame(frame);
+				}
+				return slot;
+			}
+		}
+		slot = allocFrame();
+		return slot;
+	}
+	// 时钟最多转两圈: 第一圈清除 recently_referenced, 第二圈若还找不到,
+	// 说明所有帧都被引用了.
+	for (std::uint32_t i = 0; i < 2 * numBufs; i++) {
+		advanceClock();
+		StatedPage& frame = frames[clockHand];
+		if (frame.empty()) {
+			return clockHand;
+		}
+		if (frame.recently_referenced) {
+			frame.recently_referenced = false;
+			continue;
+		}
+		if (frame.pinCnt > 0) {
+			continue;
+		}
+		evictFrame(frame);
+		return clockHand;
+	}
+	throw BufferExceededException();
+}
+
+StatedPage& BufMgr::readPageInner(File& file, const PageId pageNo, AccessRing* ring, const bool writer){
+	BADGERDB_TRACE_SCOPE("BufMgr::readPage");
+	std::unique_lock<std::mutex> lock(latch);
+	counters.add(BufCounters::ACCESSES, file.id());
+	traceEvent(TraceEventKind::Pin, file.id(), pageNo);
+	reuse.access(file.id(), pageNo);
+	FrameId frameNo;
+	while (frame_of_each_file_and_page.find(file.id(), pageNo, frameNo)) {
+		StatedPage& frame = frames[frameNo];
+		if (!frame.io_pending) {
+			frame.pinCnt++;
+			if (writer) {
+				beginWrite(frame);
+			}
+			if (ring == nullptr) {
+				frame.recently_referenced = true;
+			}
+			counters.add(BufCounters::HITS, file.id());
+			return frame;
+		}
+		// 另一个线程正在读入这一页: 等它完成后重新查找, 读入失败时页已不在表中.
+		counters.add(BufCounters::PIN_WAITS, file.id());
+		ioDone.wait(lock, [&] { return !frame.io_pending; });
+	}
+	frameNo = allocFrame(ring);
+	StatedPage& frame = frames[frameNo];
+	attachFrame(frame, file.id(), pageNo);
+	if (writer) {
+		beginWrite(frame);
+	}
+	frame.recently_referenced = ring == nullptr;
+	frame.io_pending = true;
+	counters.add(BufCounters::MISSES, file.id());
+	counters.add(BufCounters::DISK_READS, file.id());
+	lock.unlock();
+
+	// 帧已经被本线程引用, 不会被换出, 可以在锁外读盘.
+	try {
+		file.readPage(pageNo, frame.data);
+	} catch (...) {
+		lock.lock();
+		detachFrame(frame);
+		lock.unlock();
+		ioDone.notify_all();
+		throw;
+	}
+	lock.lock();
+	frame.io_pending = false;
+	lock.unlock();
+	ioDone.notify_all();
+	return frame;
+}
+
+void BufMgr::unPinPage(const FileId file, const PageId pageNo, const bool dirty){
+	BADGERDB_TRACE_SCOPE("BufMgr::unPinPage");
+	std::lock_guard<std::mutex> guard(latch);
+	FrameId frameNo;
+	if (!frame_of_each_file_and_page.find(file, pageNo, frameNo)) {
+		throw PageNotPinnedException(nameOf(file), pageNo, NO_FRAME);
+	}
+	releasePin(frames[frameNo], dirty, false);
+}
+
+void BufMgr::unPinFrame(const FrameId frameNo, const bool dirty, const bool writer){
+	BADGERDB_TRACE_SCOPE("BufMgr::unPinPage");
+	std::lock_guard<std::mutex> guard(latch);
+	if (frameNo >= frames.size()) {
+		throw std::out_of_range("no buffer frame " + std::to_string(frameNo));
+	}
+	releasePin(frames[frameNo], dirty, writer);
+}
 
+void BufMgr::releasePin(StatedPage& frame, const bool dirty, const bool writer){
+	if (frame.pinCnt == 0) {
+		throw PageNotPinnedException(nameOf(frame.file), frame.pageNo, frame.frameNo);
+	}
+	frame.pinCnt--;
+	if (writer) {
+		endWrite(frame);
+	}
+	if (frame.file == FileRegistry::INVALID_ID) {
+		// 文件已经关闭 (见 releaseFile()): 修改不再写回, 最后一个引用放开时回收帧
+		if (frame.pinCnt == 0) {
+			detachFrame(frame);
+		}
+	} else {
+		traceEvent(TraceEventKind::Unpin, frame.file, frame.pageNo, dirty);
+		if (dirty) {
+			markDirty(frame);
+		}
+	}
+	if (frame.frameNo >= numBufs && frame.pinCnt == 0) {
+		retireFrame(frame.frameNo);
+	}
+}
+
+void BufMgr::beginWrite(StatedPage& frame){
+	if (frame.writers++ == 0) {
+		// acq_rel: 之后对页的写不会被提前到版本变为奇数之前
+		frame.version.fetch_add(1, std::memory_order_acq_rel);
+	}
+}
+
+void BufMgr::endWrite(StatedPage& frame){
+	if (frame.writers > 0 && --frame.writers == 0) {
+		frame.version.fetch_add(1, std::memory_order_release);
+	}
+}
+
+void BufMgr::pinFrame(const FrameId frameNo){
+	std::lock_guard<std::mutex> guard(latch);
+	StatedPage& frame = frames[frameNo];
+	frame.pinCnt++;
+	// 不是新的访问, 不计数; 但要记入踪迹, 与之后的放开配对 (脱离了文件的帧的放开不记入)
+	if (frame.file != FileRegistry::INVALID_ID) {
+		traceEvent(TraceEventKind::Pin, frame.file, frame.pageNo);
+	}
+}
+
+StatedPage* BufMgr::repinInner(const PageHandle& handle, const bool writer){
+	BADGERDB_TRACE_SCOPE("BufMgr::repin");
+	std::lock_guard<std::mutex> guard(latch);
+	if (handle.frame >= frames.size()) {
+		return nullptr;
+	}
+	StatedPage& frame = frames[handle.frame];
+	// 代数相同说明帧从取得句柄起一直缓存着这一页; 核对页号只是多一道保险
+	if (frame.generation != handle.generation || !frame.valid || frame.io_pending ||
+	    frame.file != handle.file || frame.pageNo != handle.page) {
+		return nullptr;
+	}
+	frame.pinCnt++;
+	if (writer) {
+		beginWrite(frame);
+	}
+	frame.recently_referenced = true;
+	counters.add(BufCounters::ACCESSES, frame.file);
+	counters.add(BufCounters::HITS, frame.file);
+	traceEvent(TraceEventKind::Pin, frame.file, frame.pageNo);
+	reuse.access(frame.file, frame.pageNo);
+	return &frame;
 }
 
-FrameId BufMgr::allocFrame() {
-	
+void BufMgr::flushFile(File& file){
+	BADGERDB_TRACE_SCOPE("BufMgr::flushFile");
+	std::lock_guard<std::mutex> guard(latch);
+	traceEvent(TraceEventKind::Flush, file.id(), 0);
+	FrameId frameNo = framesOf(file.id()).resident.head;
+	while (frameNo != NO_FRAME) {
+		StatedPage& frame = frames[frameNo];
+		// 先取下一帧, 本帧会被移出链表
+		frameNo = frame.file_link.next;
+		if (!frame.valid) {
+			throw BadBufferException(frame.frameNo, frame.dirty, frame.valid, frame.recently_referenced);
+		}
+		if (frame.pinCnt > 0) {
+			throw PagePinnedException(file.filename(), frame.pageNo, frame.frameNo);
+		}
+		if (frame.dirty) {
+			frame.dump_to_file();
+			counters.add(BufCounters::DISK_WRITES, frame.file);
+		}
+		detachFrame(frame);
+	}
 }
 
-	
-void BufMgr::readPage(File* file, const PageId pageNo, Page*& page){
-	
+std::uint32_t BufMgr::writeBack(File& file){
+	BADGERDB_TRACE_SCOPE("BufMgr::writeBack");
+	std::lock_guard<std::mutex> guard(latch);
+	FileFrames& owner = framesOf(file.id());
+	std::uint32_t written = 0;
+	FrameId frameNo = owner.dirty.head;
+	while (frameNo != NO_FRAME) {
+		StatedPage& frame = frames[frameNo];
+		frameNo = frame.dirty_link.next;
+		if (frame.pinCnt > 0 || frame.io_pending) {
+			continue;
+		}
+		frame.dump_to_file();
+		counters.add(BufCounters::DISK_WRITES, frame.file);
+		frame.dirty = false;
+		unlinkFrame(owner.dirty, &StatedPage::dirty_link, frame.frameNo);
+		written++;
+	}
+	return written;
 }
 
+std::uint32_t BufMgr::residentPages(const File& file) const{
+	std::lock_guard<std::mutex> guard(latch);
+	return file.id() < file_frames.size() ? file_frames[file.id()].resident.size : 0;
+}
 
-void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty){
+std::uint32_t BufMgr::dirtyPages(const File& file) const{
+	std::lock_guard<std::mutex> guard(latch);
+	return file.id() < file_frames.size() ? file_frames[file.id()].dirty.size : 0;
+}
 
+MutablePageView BufMgr::allocPage(File& file, PageId &pageNo) {
+	return MutablePageView(&allocPageInner(file, pageNo, nullptr), *this);
 }
 
-void BufMgr::flushFile(const File* file){
+MutablePageView BufMgr::allocPage(File& file, PageId &pageNo, AccessRing& ring) {
+	return MutablePageView(&allocPageInner(file, pageNo, &ring), *this);
+}
 
+MutablePageView BufMgr::adoptPage(File& file, const PageId pageNo) {
+	PageId adopted = pageNo;
+	return MutablePageView(&allocPageInner(file, adopted, nullptr, true), *this);
 }
 
-void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) {
+StatedPage& BufMgr::allocPageInner(File& file, PageId &pageNo, AccessRing* ring, const bool adopt) {
+	BADGERDB_TRACE_SCOPE("BufMgr::allocPage");
+	std::lock_guard<std::mutex> guard(latch);
+	FrameId frameNo;
+	if (adopt && frame_of_each_file_and_page.find(file.id(), pageNo, frameNo)) {
+		// 新页取代缓存着的旧内容, 不写回
+		StatedPage& old = frames[frameNo];
+		if (old.pinCnt > 0 || old.io_pending) {
+			throw PagePinnedException(file.filename(), pageNo, frameNo);
+		}
+		detachFrame(old);
+	}
+	frameNo = allocFrame(ring);
+	StatedPage& frame = frames[frameNo];
+	if (adopt) {
+		frame.data = Page();
+		frame.data.set_page_number(pageNo);
+	} else {
+		frame.data = file.allocatePage();
+		pageNo = frame.data.page_number();
+	}
+	counters.add(BufCounters::ACCESSES, file.id());
+	counters.add(BufCounters::MISSES, file.id());
+	counters.add(BufCounters::DISK_READS, file.id());
+	traceEvent(TraceEventKind::Alloc, file.id(), pageNo);
+	reuse.access(file.id(), pageNo);
+	attachFrame(frame, file.id(), pageNo);
+	beginWrite(frame);
+	frame.recently_referenced = ring == nullptr;
+	return frame;
+}
 
+void BufMgr::discardFile(File& file){
+	BADGERDB_TRACE_SCOPE("BufMgr::discardFile");
+	std::lock_guard<std::mutex> guard(latch);
+	FileFrames& owner = framesOf(file.id());
+	// 先检查再丢弃, 失败时不改变任何帧
+	for (FrameId frameNo = owner.resident.head; frameNo != NO_FRAME; frameNo = frames[frameNo].file_link.next) {
+		const StatedPage& frame = frames[frameNo];
+		if (frame.pinCnt > 0 || frame.io_pending) {
+			throw PagePinnedException(file.filename(), frame.pageNo, frame.frameNo);
+		}
+	}
+	traceEvent(TraceEventKind::Discard, file.id(), 0);
+	while (owner.resident.head != NO_FRAME) {
+		detachFrame(frames[owner.resident.head]);
+	}
 }
 
-void BufMgr::disposePage(File* file, const PageId pageNo){
+void BufMgr::dropFile(File::sptr& file){
+	if (file.use_count() > 1) {
+		throw FileOpenException(file->filename());
+	}
+	discardFile(*file);
+	const std::string name = file->filename();
+	file.reset();
+	File::remove(name);
+}
 
+void BufMgr::disposePage(File& file, const PageId pageNo){
+	BADGERDB_TRACE_SCOPE("BufMgr::disposePage");
+	std::lock_guard<std::mutex> guard(latch);
+	traceEvent(TraceEventKind::Dispose, file.id(), pageNo);
+	FrameId frameNo;
+	if (frame_of_each_file_and_page.find(file.id(), pageNo, frameNo)) {
+		StatedPage& frame = frames[frameNo];
+		if (frame.pinCnt > 0) {
+			throw PagePinnedException(file.filename(), pageNo, frameNo);
+		}
+		detachFrame(frame);
+	}
+	file.deletePage(pageNo);
+}
+
+FrameReservation BufMgr::reserveFrames(const std::uint32_t count) {
+	BADGERDB_TRACE_SCOPE("BufMgr::reserveFrames");
+	std::lock_guard<std::mutex> guard(latch);
+	// 找一段连续的、没有被引用 (也没有被预留) 的帧.  预留的帧 pinCnt 为 1, 会被跳过.
+	// 各段的页在内存中不相邻, 所以这段帧不能跨越段的边界.
+	std::uint32_t run = 0;
+	FrameId first = 0;
+	for (const Segment& segment : segments) {
+		run = 0;
+		for (FrameId i = segment.first; i < segment.first + segment.count && i < numBufs && run < count; i++) {
+			const StatedPage& frame = frames[i];
+			if (frame.pinCnt > 0 || frame.io_pending) {
+				run = 0;
+				continue;
+			}
+			if (run == 0) {
+				first = i;
+			}
+			run++;
+		}
+		if (run == count) {
+			break;
+		}
+	}
+	if (run < count) {
+		throw BufferExceededException();
+	}
+	for (FrameId i = first; i < first + count; i++) {
+		StatedPage& frame = frames[i];
+		if (frame.valid) {
+			evictFrame(frame);
+		}
+		frame.valid = true;
+		frame.pinCnt = 1;
+	}
+	traceEvent(TraceEventKind::Reserve, first, count);
+	return FrameReservation(*this, first, count);
+}
+
+void BufMgr::releaseFrames(const FrameId first, const std::uint32_t count) {
+	std::lock_guard<std::mutex> guard(latch);
+	traceEvent(TraceEventKind::Release, first, count);
+	for (FrameId i = first; i < first + count; i++) {
+		frames[i].Clear();
+		if (i >= numBufs) {
+			releasePageMemory(frames[i].data);
+		}
+	}
+}
+
+void BufMgr::retireFrame(const FrameId frameNo) {
+	StatedPage& frame = frames[frameNo];
+	if (frame.pinCnt > 0 || frame.io_pending) {
+		return;
+	}
+	if (frame.valid) {
+		evictFrame(frame);
+	}
+	releasePageMemory(frame.data);
+}
+
+void BufMgr::resize(const std::uint32_t bufs) {
+	if (bufs == 0) {
+		throw std::invalid_argument("buffer pool needs at least one frame");
+	}
+	std::lock_guard<std::mutex> guard(latch);
+	if (bufs == numBufs) {
+		return;
+	}
+	if (bufs > numBufs) {
+		// 先重新启用正在退出的帧 (它们和它们的段一直保留着), 不够时再分配一段
+		const auto existing = static_cast<std::uint32_t>(frames.size());
+		if (bufs > existing) {
+			const std::uint32_t count = bufs - existing;
+			segments.push_back({existing, count, std::unique_ptr<Page[]>(new Page[count])});
+			for (std::uint32_t i = 0; i < count; i++) {
+				frames.emplace_back(existing + i, segments.back().pages[i]);
+			}
+		}
+		numBufs = bufs;
+	} else {
+		numBufs = bufs;
+		if (clockHand >= numBufs) {
+			clockHand = numBufs - 1;
+		}
+		for (FrameId i = numBufs; i < frames.size(); i++) {
+			retireFrame(i);
+		}
+	}
+	frame_of_each_file_and_page.resize(tableSizeFor(numBufs));
+	reuse.rescale(4 * static_cast<std::uint64_t>(numBufs));
+}
+
+std::uint32_t BufMgr::size() const {
+	std::lock_guard<std::mutex> guard(latch);
+	return numBufs;
+}
+
+void BufMgr::startTrace(const std::string& path) {
+	std::unique_ptr<TraceWriter> writer = std::make_unique<TraceWriter>(path);
+	{
+		std::lock_guard<std::mutex> guard(latch);
+		trace.swap(writer);
+	}
+	// writer 现在是之前的踪迹 (如果有), 在锁外析构并写出
+}
+
+void BufMgr::stopTrace() {
+	std::unique_ptr<TraceWriter> finished;
+	{
+		std::lock_guard<std::mutex> guard(latch);
+		finished = std::move(trace);
+	}
+	// 析构时写出剩余的事件, 不必持有 latch
+}
+
+std::vector<MissRatioPoint> BufMgr::missRatioCurve() const {
+	std::lock_guard<std::mutex> guard(latch);
+	std::vector<MissRatioPoint> curve;
+	for (const std::uint64_t size : {std::max<std::uint64_t>(numBufs / 2, 1), std::uint64_t{numBufs},
+	                                 2 * std::uint64_t{numBufs}, 4 * std::uint64_t{numBufs}}) {
+		curve.push_back({size, reuse.hitRatio(size)});
+	}
+	return curve;
+}
+
+void BufMgr::clearMissRatioCurve() {
+	std::lock_guard<std::mutex> guard(latch);
+	reuse.clear();
 }
 
 void BufMgr::printSelf(void) 
 {
+	std::lock_guard<std::mutex> guard(latch);
 	int validFrames = 0;
-  for(auto [i,buf] : enumerate(frames)){
+  for (std::uint32_t i = 0; i < numBufs; i++)
+	{
 		std::cout << "FrameNo:" << i << " ";
-		buf.Print();
-		if (buf.valid == true)
-    	validFrames++;
-	}
-  // for (std::uint32_t i = 0; i < numBufs; i++)
-	// {
-  // 	tmpbuf = &(buffer_descriptors[i]);
-	// 	std::cout << "FrameNo:" << i << " ";
-	// 	tmpbuf->Print();
-
-  // 	if (tmpbuf->valid == true)
-  //   	validFrames++;
-  // }
+		frames[i].Print();
+
+		if (frames[i].valid == true)
+			validFrames++;
+	}
 
 	std::cout << "Total Number of Valid Frames:" << validFrames << "\n";
 }
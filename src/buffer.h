@@ -9,9 +9,18 @@
 
 #include "file.h"
 #include "bufHashTbl.h"
+#include "page_trace.h"
+#include "miss_ratio.h"
+#include "buf_stats.h"
 #include <iostream>
 #include<vector>
+#include<deque>
 #include<memory>
+#include<mutex>
+#include<shared_mutex>
+#include<condition_variable>
+#include<optional>
+#include<atomic>
 namespace badgerdb {
 
 /**
@@ -19,16 +28,42 @@ namespace badgerdb {
 */
 class BufMgr;
 class PageView;class MutablePageView;
+
+/// 表示 "没有帧" 的帧号
+constexpr FrameId NO_FRAME = UINT32_MAX;
+
+/// @brief 经过帧的侵入式双向链表中的一环, 两端为 NO_FRAME
+struct FrameLinks {
+	FrameId prev = NO_FRAME;
+	FrameId next = NO_FRAME;
+};
+
+class StatedPage;
+
+/// @brief 页曾经所在的帧, 由 PageView::handle() 取得.
+///
+/// 放开页以后仍可保留它, 之后用 BufMgr::repin() 在页还在那个帧中时直接重新引用,
+/// 不查页表 (如游标回到上次读到的页), 或用 BufMgr::tryReadOptimistic() 不引用地读它.
+/// 帧每次换页都取缓冲池中一个新的代数 (单调递增, 不会重复), 所以过时的句柄不会引用到别的页.
+struct PageHandle {
+	FileId file = FileRegistry::INVALID_ID;
+	PageId page = Page::INVALID_NUMBER;
+	FrameId frame = NO_FRAME;
+	std::uint64_t generation = 0;
+	/// 帧本身, 供乐观读在不查帧表的情况下找到它.  帧在缓冲池析构之前一直存在
+	const StatedPage* slot = nullptr;
+};
+
 /**
 * @brief 包含一个真正的页,并记录了它的信息
 */
 class StatedPage {
-	friend class BufMgr;friend class PageView;friend class MutablePageView;
+	friend class BufMgr;friend class PageView;friend class MutablePageView;friend class FrameReservation;
  private:
-	//Pointer to file to which corresponding frame is assigned
-  File::sptr file;
+	//该帧所属文件的编号 (见 FileRegistry).  在 latch 内修改, 乐观读在锁外核对它和页号
+  std::atomic<FileId> file;
   //Page within file to which corresponding frame is assigned
-  PageId pageNo;
+  std::atomic<PageId> pageNo;
   //Frame number of the frame, in the buffer pool, being used
   const FrameId	frameNo;
   //Number of times this page has been pinned
@@ -37,50 +72,70 @@ class StatedPage {
   bool dirty;
   //这个页是否可用(对外部使用者来说)
   bool valid;
-  //这个页是否最近被引用
-  bool recently_referenced;
+  //这个页是否最近被引用 (乐观读在锁外设置它, 因此是原子的)
+  mutable std::atomic<bool> recently_referenced;
+  //这个页正在从磁盘读入(读入在 BufMgr 的锁之外进行), 其他线程需要等待
+  bool io_pending;
+  //页内容的读写锁 (latch), 由页的使用者 (如 B+ 树) 自行加锁, 缓冲池本身不使用.
+  //帧被引用期间不会被换出, 所以它在引用期间始终对应同一个页.
+  mutable std::shared_mutex content_latch;
+  //所属文件的帧链表, 以及 (脏页时) 该文件的脏页链表中的前后帧, 见 BufMgr::FileFrames
+  FrameLinks file_link;
+  FrameLinks dirty_link;
+  //帧的代数: 每次开始或结束缓存一个页时取缓冲池的下一个代数, 用来识别过时的 PageHandle.
+  //在 latch 内修改, 乐观读在锁外读取
+  std::atomic<std::uint64_t> generation{0};
+  //页内容的版本: 有可变视图引用该页时为奇数, 最后一个可变视图放开时再加一.
+  //乐观读前后版本相同且为偶数, 说明读的期间没有人写 (见 BufMgr::tryReadOptimistic())
+  std::atomic<std::uint64_t> version{0};
+  //引用该页的可变视图数.  由 latch 保护
+  std::uint32_t writers = 0;
 
-	// 真正的页
-	Page data;
+	// 真正的页, 位于 BufMgr 连续且按 PAGE_IO_ALIGNMENT 对齐的页池中,
+	// 因而可以直接作为 O_DIRECT 读写的缓冲区
+	Page& data;
 	/**
    * 为新用户初始化缓冲区
 	 */
   void Clear()	{
     pinCnt = 0;
-		file = NULL;
+		file = FileRegistry::INVALID_ID;
 		pageNo = Page::INVALID_NUMBER;
     dirty = false;
     recently_referenced = false;
 		valid = false;
+		io_pending = false;
   };
 	//空闲----valid 的反义词
 	bool empty()const{return !valid;}
 	//向文件中写入该页
 	void dump_to_file(){
-		if(file == nullptr){throw std::invalid_argument("file is empty: "+file->filename());}
-		//std::cerr<<"[debug] dumping "<<file->filename()<<" page "<<pageNo<<"\n";
-		file->writePage(data);
+		File* f = FileRegistry::get(file);
+		if(f == nullptr){throw std::invalid_argument("file is closed: "+std::to_string(file));}
+		//std::cerr<<"[debug] dumping "<<f->filename()<<" page "<<pageNo<<"\n";
+		f->writePage(data);
 	}
 	/**
 	 * 将成员变量设为它所映射的文件中,和文件中的页号.
 	 * 在 readPage() or allocPage() 中,当一个空页被绑定到一个现存的页时调用. 
 	 *
-	 * @param filePtr	文件
+	 * @param fileId	文件编号
 	 * @param pageNum	文件中的页号
 	 */
-  void occupy_for(File::sptr filePtr, PageId pageNum)	{ 
-		if(filePtr == nullptr){throw std::invalid_argument("file is empty: "+file->filename());}
-		file = filePtr;
+  void occupy_for(FileId fileId, PageId pageNum)	{ 
+		if(fileId == FileRegistry::INVALID_ID){throw std::invalid_argument("file id is invalid");}
+		file = fileId;
     pageNo = pageNum;
     pinCnt = 1;
     dirty = false;
     valid = true;
     recently_referenced = true;
+    io_pending = false;
   }
 
   void Print()const	{
-		if(file){
-			std::cout << "file:" << file->filename() << " ";
+		if(const File* f = FileRegistry::get(file); valid && f){
+			std::cout << "file:" << f->filename() << " ";
 			std::cout << "pageNo:" << pageNo << " ";
 		}
 		else
@@ -94,8 +149,11 @@ class StatedPage {
 	public:
 	/**
    * Constructor of BufDesc class 
+	 *
+	 * @param frame_id 帧号
+	 * @param page     该帧在页池中对应的页
 	 */
-  StatedPage(FrameId frame_id):frameNo(frame_id)	{  	Clear();  }
+  StatedPage(FrameId frame_id, Page& page):frameNo(frame_id),data(page)	{  	Clear();  }
 };
 
 
@@ -117,14 +175,16 @@ class PageView{
 		page = & _stpage ->data;
 	}
 	const Page* operator->()const{return page;}
+	const Page& operator*()const{return *page;}
+	/// @brief 该页内容的读写锁, 见 StatedPage::content_latch
+	///
+	std::shared_mutex& latch()const{return stpage->content_latch;}
+	/// @brief 页所在的帧, 放开以后可以用 BufMgr::repin() 重新引用
+	///
+	PageHandle handle()const{return {stpage->file,stpage->pageNo,stpage->frameNo,stpage->generation,stpage};}
 	/// @brief 放弃自己对页的引用,这样它们就不再需要维持在内存中了.
 	///
-	void unpin(){
-		if(page){
-			mgr.unPinPage(stpage->file,stpage->pageNo,false);
-		}
-		page = nullptr;
-	}
+	void unpin();
 	~PageView(){unpin();}
 };
 
@@ -147,56 +207,203 @@ class MutablePageView {
 		page =&  _stpage->data;
 	}
 	Page* operator->(){return page;}
-	/// @brief 生成一个不改变的视图
+	Page& operator*(){return *page;}
+	/// @brief 该页内容的读写锁, 见 StatedPage::content_latch
+	///
+	std::shared_mutex& latch()const{return stpage->content_latch;}
+	/// @brief 页所在的帧, 放开以后可以用 BufMgr::repin() 重新引用
+	///
+	PageHandle handle()const{return {stpage->file,stpage->pageNo,stpage->frameNo,stpage->generation,stpage};}
+	/// @brief 生成一个不改变的视图, 它自己持有一次引用
 	/// 
-	PageView to_immut()const{return PageView(stpage,mgr);}
+	PageView to_immut()const;
 	/// @brief 放弃自己对页的引用,这样它们就不再需要维持在内存中了.
 	///
-	void unpin(){
-		if(page){
-			mgr.unPinPage(stpage->file,stpage->pageNo,true);
-		}
-		page = nullptr;
-	}
+	void unpin();
 	~MutablePageView(){unpin();}
 };
 
 
-template<typename T>
-concept is_page_view = std::same_as<T,PageView> || std::same_as<T,MutablePageView>;
+/// @brief 从缓冲池中预留的一段连续的帧, 供算子 (如外部排序) 作为工作内存.
+///
+/// 预留的帧不属于任何文件, 不会被换出, 也不在哈希表中; 它们的页在内存中连续,
+/// 可以直接作为 File::readPages() 的目标.  析构时归还给缓冲池.
+class FrameReservation {
+	BufMgr* mgr;
+	FrameId first;
+	std::uint32_t count;
+	friend class BufMgr;
+	FrameReservation(BufMgr& _mgr, FrameId _first, std::uint32_t _count)
+		: mgr(&_mgr), first(_first), count(_count) {}
+	public:
+	FrameReservation(const FrameReservation&) = delete;
+	FrameReservation& operator=(const FrameReservation&) = delete;
+	FrameReservation(FrameReservation&& b) : mgr(b.mgr), first(b.first), count(b.count) { b.count = 0; }
+	/// @brief 预留的第一页; 共 size() 页连续存放
+	///
+	Page* pages() const;
+	/// @brief 预留的页数
+	///
+	std::uint32_t size() const { return count; }
+	~FrameReservation();
+};
 
-/**
-* @brief 缓冲区使用情况的统计信息
-*/
-struct BufStats{
-  //缓冲池的总访问次数
-  int accesses;
-  //Number of pages read from disk (including allocs)
-  int diskreads;
-  //Number of pages written back to disk
-  int diskwrites;
-  //Clear all values to zero
-  void clear()  {		accesses = diskreads = diskwrites = 0;  }
-  BufStats() {		clear();  }
+
+/// @brief 读写页时对访问方式的提示, 决定 AccessRing 的默认大小
+enum class AccessStrategy {
+	Normal,      ///< 普通访问, 使用整个缓冲池 (没有私有的环)
+	Sequential,  ///< 顺序扫描: 读过的页很快不再需要
+	BulkWrite,   ///< 批量写: 大量新页或改写的页, 写回由环的大小节流
+};
+
+/// @brief 一次扫描或批量写私有的一圈帧, 用来保护缓冲池中的热页.
+///
+/// 带着环读页时, 未命中的页优先读入环中下一个帧 (其中的旧页被换出, 脏页先写回),
+/// 而不是由时钟在整个缓冲池中挑选; 环里还没有帧、或那个帧正被引用、
+/// 或在读入后被别人访问过时, 才照常从缓冲池分配一个帧并把它加入环.
+/// 于是一次大表扫描只循环使用这几个帧, 不会把其他页挤出去.
+/// 带着环读入的页和命中的页都不标记为最近访问过, 时钟也会先换出它们.
+///
+/// 环不加锁, 每个扫描线程用自己的环; 它只记录帧号, 不持有帧,
+/// 可以比缓冲池活得更久.  环的实际大小不超过缓冲池的 1/8.
+class AccessRing {
+	friend class BufMgr;
+	public:
+	/// 顺序扫描的默认帧数 (256 KiB)
+	static constexpr std::uint32_t SEQUENTIAL_FRAMES = 32;
+	/// 批量写的默认帧数 (2 MiB)
+	static constexpr std::uint32_t BULK_WRITE_FRAMES = 256;
+
+	/// @param strategy 访问方式, Normal 时环为空, 读页与不带环时相同
+	/// @param frames   环的帧数, 为 0 时使用该访问方式的默认值
+	explicit AccessRing(const AccessStrategy strategy = AccessStrategy::Sequential, const std::uint32_t frames = 0);
+	AccessStrategy strategy() const { return strategy_; }
+	/// @brief 环的帧数
+	///
+	std::uint32_t size() const { return static_cast<std::uint32_t>(slots.size()); }
+	private:
+	AccessStrategy strategy_;
+	/// 环中的帧号, 还没有帧的位置为 NO_FRAME
+	std::vector<FrameId> slots;
+	/// 上一次使用的位置
+	std::uint32_t current = 0;
 };
 
 
+template<typename T>
+concept is_page_view = std::same_as<T,PageView> || std::same_as<T,MutablePageView>;
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+*
+* 帧以 (FileId, PageId) 标识页, 不持有 File 的所有权.
+*
+* 缓冲池可以被多个线程同时使用: 帧的元数据和哈希表由一把锁 (latch) 保护,
+* 而未命中时从磁盘读页是在锁外进行的, 多个线程的读请求可以同时下发到磁盘.
+* 正在读入的页在哈希表中已经可见, 其他线程访问它时会等待读入完成.
+* 缓冲池不保护页的内容本身: 同时写同一个页的调用者需要自己协调.
+* 文件关闭时 (见 FileRegistry::addCloseListener()) 缓冲池写回并移出它的页, 它的编号被
+* 重用后不会看到残留的帧.  那时仍被引用的帧脱离文件, 最后一个引用放开时才被回收,
+* 期间对它的修改不再写回.
 */
 class BufMgr {
-	friend class PageView; friend class MutablePageView;
+	friend class PageView; friend class MutablePageView; friend class FrameReservation;
  private:
   //Current position of clockhand in our buffer pool
   FrameId clockHand;
   //Number of frames in the buffer pool
-  const std::uint32_t numBufs;	
+  /// (可以用 resize() 改变; 编号不小于 numBufs 的帧正在退出, 不再分配给新的页)
+  std::uint32_t numBufs;	
   //Hash table mapping (File, page) to frame
   BufHashTbl frame_of_each_file_and_page;
+  /// @brief 一段连续存放的帧的页, 每页按 PAGE_IO_ALIGNMENT 对齐.
+  /// 构造时分配一段, 之后每次 resize() 扩大时再分配一段.
+  struct Segment {
+    FrameId first;
+    std::uint32_t count;
+    std::unique_ptr<Page[]> pages;
+  };
+  /// 缓冲池占用的内存因此至多为帧数 * Page::SIZE (退出的帧的页的物理内存已经归还), 与文件的 I/O 方式无关.
+  std::vector<Segment> segments;
   //Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
-  std::vector<StatedPage> frames;
-  //Maintains Buffer pool usage statistics 
-  BufStats bufStats;
+  //(帧含有不可移动的读写锁, 因此用 deque 原地构造; 只在末尾增加, 已有的帧地址不变)
+  /// 缩小时退出的帧和它们的段都保留 (只归还页的物理内存), 所以 PageHandle::slot
+  /// 在缓冲池析构之前总是指向一个帧, 扩大时这些帧被重新启用.
+  std::deque<StatedPage> frames;
+  /// 帧的代数的来源, 见 StatedPage::generation.  由 latch 保护
+  std::uint64_t generations = 0;
+  //Maintains Buffer pool usage statistics (按线程分片, 不需要 latch)
+  BufCounters counters;
+  /// 访问的重用距离抽样, 用于估计其他大小的缓冲池的命中率
+  MissRatioEstimator reuse;
+  /// 保护以上所有状态以及各帧的元数据 (页的内容除外)
+  mutable std::mutex latch;
+  /// 有页读入完成 (或失败) 时通知等待它的线程
+  std::condition_variable ioDone;
+  /// 页访问踪迹, 没有在记录时为空.  由 latch 保护
+  std::unique_ptr<TraceWriter> trace;
+
+  /// @brief 经过 StatedPage 的一条帧链表
+  struct FrameList {
+    FrameId head = NO_FRAME;
+    std::uint32_t size = 0;
+  };
+  /// @brief 一个文件在缓冲池中的帧, 以及其中的脏页.
+  /// 写回、丢弃一个文件只需遍历它自己的帧, 与缓冲池的大小无关.
+  struct FileFrames {
+    FrameList resident;
+    FrameList dirty;
+  };
+  /// 以文件编号为下标, 按需增长.  由 latch 保护
+  std::vector<FileFrames> file_frames;
+  /// FileRegistry 中关闭回调的标识, 析构时注销
+  std::uint64_t close_listener;
+
+	/**
+	 * 把帧加入链表 list 的头部.  links 是帧中该链表的一环.  调用者须持有 latch.
+	 */
+  void linkFrame(FrameList& list, FrameLinks StatedPage::*links, const FrameId frameNo);
+
+	/**
+	 * 把帧从链表 list 中取出.  调用者须持有 latch.
+	 */
+  void unlinkFrame(FrameList& list, FrameLinks StatedPage::*links, const FrameId frameNo);
+
+	/**
+	 * 文件的帧, 没有时创建.  调用者须持有 latch.
+	 */
+  FileFrames& framesOf(const FileId file);
+
+	/**
+	 * 让空闲的帧缓存文件 file 的页 pageNo: 登记到页表和文件的帧链表中, 并引用一次.
+	 * 调用者须持有 latch.
+	 */
+  void attachFrame(StatedPage& frame, const FileId file, const PageId pageNo);
+
+	/**
+	 * attachFrame() 的反操作: 从页表和链表中去掉帧并清空它 (不写回).  调用者须持有 latch.
+	 * 已经脱离文件的帧 (见 releaseFile()) 只被清空.
+	 */
+  void detachFrame(StatedPage& frame);
+
+	/**
+	 * 文件关闭时的回调: 写回并移出它的页, 丢掉它的计数.  仍被引用的帧脱离文件
+	 * (从页表和链表中去掉, file 为 INVALID_ID), 由最后一个 releasePin() 回收.
+	 * 写回失败时页被丢弃: 回调不能抛出异常.
+	 */
+  void releaseFile(File& file);
+
+	/**
+	 * 把帧标记为脏页并加入文件的脏页链表.  调用者须持有 latch.
+	 */
+  void markDirty(StatedPage& frame);
+
+	/**
+	 * 记录踪迹时写一个事件.  调用者须持有 latch.
+	 */
+  void traceEvent(const TraceEventKind kind, const FileId file, const PageId pageNo, const bool dirty = false){
+		if(trace){trace->record({file, pageNo, kind, dirty});}
+	}
 
 	/**
    * Advance clock to next frame in the buffer pool
@@ -204,19 +411,115 @@ class BufMgr {
   void advanceClock();
 
 	/**
-	 * 分配一个空闲的帧.  
+	 * 分配一个空闲的帧.  调用者须持有 latch.
 	 *
+	 * @param ring 不为空时优先重用环中的下一个帧, 见 AccessRing
 	 * @throws BufferExceededException 如果找不到一个可用的帧
 	 */
-  FrameId allocFrame();
+  FrameId allocFrame(AccessRing* ring = nullptr);
+
+	/**
+	 * 换出帧中的页 (脏页先写回) 并计数.  帧须没有被引用.  调用者须持有 latch.
+	 */
+  void evictFrame(StatedPage& frame);
+
 	/**
 	 * @brief 找到一个内部的页,供PageView 包装
 	 * 
 	 * @param file 
 	 * @param PageNo 
+	 * @param ring 不为空时按 AccessRing 的方式分配帧
+	 * @param writer 是否为可变视图引用 (见 beginWrite())
 	 * @return StatedPage& 返回的内部页
 	 */
-	StatedPage& readPageInner(File::sptr file, const PageId PageNo);
+	StatedPage& readPageInner(File& file, const PageId PageNo, AccessRing* ring, const bool writer);
+
+	/**
+	 * allocPage() 的实现, 返回新页所在的帧
+	 *
+	 * @param adopt 为真时不在文件中分配页, 而是把已有的页 PageNo 当作新页 (见 adoptPage())
+	 */
+	StatedPage& allocPageInner(File& file, PageId &PageNo, AccessRing* ring, const bool adopt = false);
+
+	/**
+	 * 按文件编号减少页的引用, 供页视图在析构时调用.
+	 *
+	 * @param file   	文件编号
+	 * @param PageNo  页号
+	 * @param dirty		这个被取消的页是否需要为脏
+   * @throws  PageNotPinnedException 如果页面没有被引用
+	 */
+  void unPinPage(const FileId file, const PageId PageNo, const bool dirty);
+
+	/**
+	 * 按帧号减少页的引用, 供页视图在析构时调用: 视图知道自己的帧, 不需要查页表.
+	 *
+	 * @param frameNo 帧号
+	 * @param dirty		这个被取消的页是否需要为脏
+	 * @param writer	放开的是否为可变视图的引用
+   * @throws  PageNotPinnedException 如果页面没有被引用
+   * @throws  std::out_of_range 如果没有这个帧
+	 */
+  void unPinFrame(const FrameId frameNo, const bool dirty, const bool writer);
+
+	/**
+	 * unPinPage() 和 unPinFrame() 的实现.  调用者须持有 latch.
+	 */
+  void releasePin(StatedPage& frame, const bool dirty, const bool writer);
+
+	/**
+	 * 可变视图开始引用帧: 第一个可变视图使页的版本变为奇数, 乐观读随之失败.
+	 * 调用者须持有 latch.
+	 */
+  void beginWrite(StatedPage& frame);
+
+	/**
+	 * 可变视图放开帧: 最后一个可变视图使版本再变为偶数.  调用者须持有 latch.
+	 */
+  void endWrite(StatedPage& frame);
+
+	/**
+	 * 再引用一次已经被引用的帧, 供 MutablePageView::to_immut() 调用
+	 */
+  void pinFrame(const FrameId frameNo);
+
+	/**
+	 * repin() 的实现: 句柄仍然有效时引用它的帧, 否则返回 nullptr
+	 */
+  StatedPage* repinInner(const PageHandle& handle, const bool writer);
+
+	/**
+	 * 按 seqlock 的方式让 fn 读帧中的页, 返回读的期间帧是否一直缓存着句柄所指的页,
+	 * 且代数和版本都没有变.  成功时把页标记为最近访问过, 以免只被乐观地读的热页被换出.
+	 */
+	template<typename Fn>
+  static bool readValidated(const StatedPage& frame, const PageHandle& handle, Fn& fn){
+		const std::uint64_t generation = handle.generation;
+		if(frame.generation.load(std::memory_order_acquire) != generation){return false;}
+		if(frame.file.load(std::memory_order_relaxed) != handle.file ||
+		   frame.pageNo.load(std::memory_order_relaxed) != handle.page){return false;}
+		const std::uint64_t version = frame.version.load(std::memory_order_acquire);
+		if(version & 1){return false;}
+		fn(static_cast<const Page&>(frame.data));
+		// 读页之后的检查不能提前到读页之前
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(frame.version.load(std::memory_order_relaxed) != version ||
+		   frame.generation.load(std::memory_order_relaxed) != generation){return false;}
+		frame.recently_referenced.store(true, std::memory_order_relaxed);
+		return true;
+	}
+
+	/**
+	 * 归还 reserveFrames() 预留的帧, 供 FrameReservation 在析构时调用.
+	 */
+  void releaseFrames(const FrameId first, const std::uint32_t count);
+
+	/**
+	 * 换出一个正在退出的帧 (脏页先写回) 并归还它的内存.  帧被引用、
+	 * 正在读入或被预留时什么也不做, 等它被放开时再换出.  调用者须持有 latch.
+	 */
+  void retireFrame(const FrameId frameNo);
+
  public:
   
   BufMgr(std::uint32_t bufs);
@@ -227,27 +530,117 @@ class BufMgr {
 	 * If the requested page is already present in the buffer pool pointer to that frame is returned
 	 * otherwise a new frame is allocated from the buffer pool for reading the page.
 	 *
+	 * 文件以引用传入, 缓冲池内部只使用它的编号 File::id(), 命中路径上
+	 * 没有 shared_ptr 的复制.
+	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
-	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @tparam IPageView 返回的视图类型, PageView 或 MutablePageView
+	 */
+	template<is_page_view IPageView = PageView>
+  IPageView readPage(File& file, const PageId PageNo){
+		return IPageView(&readPageInner(file,PageNo,nullptr,std::same_as<IPageView,MutablePageView>),*this);
+	}
+
+	/**
+	 * 同上, 但未命中时在 ring 的帧中读入, 不占用缓冲池的其他帧.
+	 * 用于顺序扫描等读过就不再需要的访问, 见 AccessRing.
+	 *
+	 * @param ring 本线程的环
+	 */
+	template<is_page_view IPageView = PageView>
+  IPageView readPage(File& file, const PageId PageNo, AccessRing& ring){
+		return IPageView(&readPageInner(file,PageNo,&ring,std::same_as<IPageView,MutablePageView>),*this);
+	}
+
+	/**
+	 * 如果句柄所指的页还在原来的帧中, 直接重新引用它: 只检查帧的代数, 不查页表.
+	 * 页已被换出 (或正在读入) 时返回空, 调用者应改用 readPage().
+	 *
+	 * @code
+	 * std::optional<PageView> view = mgr.repin(handle);
+	 * if (!view) { view.emplace(mgr.readPage(file, handle.page)); }
+	 * @endcode
+	 *
+	 * @param handle 以前从页视图取得的句柄
+	 * @tparam IPageView 返回的视图类型, PageView 或 MutablePageView
 	 */
-	template<typename IPageView = PageView>
-  IPageView readPage(File::sptr file, const PageId PageNo){
-		return IPageView(readPageInner(file,PageNo),*this);
+	template<is_page_view IPageView = PageView>
+  std::optional<IPageView> repin(const PageHandle& handle){
+		StatedPage* frame = repinInner(handle,std::same_as<IPageView,MutablePageView>);
+		if(frame == nullptr){return std::nullopt;}
+		return IPageView(frame,*this);
 	}
 
-	
+	/**
+	 * 乐观读: 不引用页、不加锁地让 fn 读句柄所指的页, 之后验证页的版本.
+	 *
+	 * 读之前和之后帧的代数都与句柄相同, 且版本相同并为偶数 (期间没有可变视图引用该页),
+	 * 才算成功.  失败时 fn 读到的可能是正在被修改、甚至已经换成别的页的内容,
+	 * 所以 fn 只应把需要的定长数据复制出来 (不要按读到的长度分配内存或循环),
+	 * 失败时丢弃复制的结果.  被频繁读、很少写的页 (如索引的根) 用这种方式读,
+	 * 多个线程之间不会因为引用计数和锁而争用缓存行.
+	 *
+	 * @param handle 以前从页视图取得的句柄
+	 * @param fn     以 const Page& 调用
+	 * @return 是否成功
+	 */
+	template<typename Fn>
+  bool tryReadOptimistic(const PageHandle& handle, Fn&& fn){
+		const bool ok = handle.slot != nullptr && readValidated(*handle.slot, handle, fn);
+		counters.add(ok ? BufCounters::OPTIMISTIC_READS : BufCounters::OPTIMISTIC_FAILS, handle.file);
+		return ok;
+	}
+
+	/**
+	 * 先尝试乐观读 hint 所指的页, 失败时引用该页并加共享锁 (StatedPage::content_latch) 再读,
+	 * 并把 hint 更新为该页现在的句柄, 供下一次乐观读使用.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  页号
+	 * @param hint   	上一次读这一页时得到的句柄, 可以为空的 PageHandle()
+	 * @param fn     	以 const Page& 调用, 返回复制出来的结果; 要求同 tryReadOptimistic()
+	 * @return fn 的结果
+	 */
+	template<typename Fn>
+  std::invoke_result_t<Fn&, const Page&> readOptimistic(File& file, const PageId PageNo, PageHandle& hint, Fn&& fn){
+		if(hint.file == file.id() && hint.page == PageNo){
+			std::optional<std::invoke_result_t<Fn&, const Page&>> result;
+			if(tryReadOptimistic(hint, [&](const Page& page){result.emplace(fn(page));})){
+				return std::move(*result);
+			}
+		}
+		PageView view = readPage(file, PageNo);
+		hint = view.handle();
+		std::shared_lock<std::shared_mutex> lock(view.latch());
+		return fn(*view);
+	}
 
-	PageView readPageAsMutable(File::sptr file, const PageId PageNo, Page*& page);
 	/**
 	 * Allocates a new, empty page in the file and returns the Page object.
 	 * The newly allocated page is also assigned a frame in the buffer pool.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
-	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 * @return 新页的可写视图
 	 */
-  void allocPage(File::sptr file, PageId &PageNo, Page*& page); 
+  MutablePageView allocPage(File& file, PageId &PageNo); 
+
+	/**
+	 * 同上, 但新页放在 ring 的帧中.  用于批量写 (AccessStrategy::BulkWrite):
+	 * 脏页在环转回来时写回, 不会占满缓冲池.
+	 *
+	 * @param ring 本线程的环
+	 */
+  MutablePageView allocPage(File& file, PageId &PageNo, AccessRing& ring);
+
+	/**
+	 * 把文件中已经存在的页 PageNo 当作刚分配的空页放入缓冲池: 不读盘, 也不改动文件,
+	 * 计数和踪迹与 allocPage() 相同.  缓存着的旧内容被丢弃.  供 TraceReplay 重放分配.
+	 *
+	 * @throws PagePinnedException 页正被引用时
+	 */
+  MutablePageView adoptPage(File& file, const PageId PageNo);
 
 
 	/**
@@ -256,21 +649,64 @@ class BufMgr {
 	 * @param file   	文件对象
 	 * @param PageNo  页号
 	 * @param dirty		这个被取消的页是否需要为脏
-   * @throws  PageNotPinnedException 如果页面没有被引用
+   * @throws  PageNotPinnedException 如果页面没有被引用 (包括页不在缓冲池中)
 	 * @warning PageView 在析构时会自动地调用这个函数,请勿手动调用它,以免造成重复释放
 	 */
-  void unPinPage(File::sptr file, const PageId PageNo, const bool dirty);
+  void unPinPage(File& file, const PageId PageNo, const bool dirty){
+		unPinPage(file.id(), PageNo, dirty);
+	}
 
 	/**
 	 * Writes out all dirty pages of the file to disk.
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
 	 * Otherwise Error returned.
 	 *
+	 * 只遍历该文件的帧 (见 FileFrames), 代价与缓冲池的大小无关.
+	 *
 	 * @param file   	File object
    * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
    * @throws BadBufferException If any frame allocated to the file is found to be invalid
 	 */
-  void flushFile(File::sptr file);
+  void flushFile(File& file);
+
+	/**
+	 * 把文件的脏页写回磁盘, 但保留在缓冲池中 (如检查点).  被引用的页可能正在被修改, 跳过.
+	 * 只遍历该文件的脏页.
+	 *
+	 * @param file   	File object
+	 * @return 写回的页数
+	 */
+  std::uint32_t writeBack(File& file);
+
+	/**
+	 * 文件在缓冲池中的页数
+	 */
+  std::uint32_t residentPages(const File& file) const;
+
+	/**
+	 * 文件在缓冲池中的脏页数
+	 */
+  std::uint32_t dirtyPages(const File& file) const;
+
+	/**
+	 * 不写回地丢弃文件在缓冲池中的所有页 (脏页的修改也被丢弃).  只遍历该文件的帧.
+	 * 有页被引用时什么也不丢弃.
+	 *
+	 * @param file   	File object
+	 * @throws  PagePinnedException 如果文件有页被引用
+	 */
+  void discardFile(File& file);
+
+	/**
+	 * 删除一个不再需要的文件, 如排序和连接的临时文件: 先 discardFile(), 不写回任何页,
+	 * 然后关闭并删除文件 (一次 unlink, 不逐页调用 File::deletePage()).
+	 *
+	 * @param file   	要删除的文件, 调用后为空.  不能有其他持有者.
+	 * @throws  PagePinnedException 如果文件有页被引用 (文件保持不变)
+	 * @throws  FileOpenException 如果 file 还有其他持有者 (文件保持不变),
+	 *          或另一个 File 对象打开了同名的文件 (页已被丢弃, file 已关闭, 但文件没有删除)
+	 */
+  void dropFile(File::sptr& file);
 
 	/**
 	 * Delete page from file and also from buffer pool if present.
@@ -279,15 +715,105 @@ class BufMgr {
 	 * @param file   	File object
 	 * @param PageNo  Page number
 	 */
-  void disposePage(File::sptr file, const PageId PageNo);
+  void disposePage(File& file, const PageId PageNo);
+
+	/**
+	 * 预留 count 个连续的帧作为调用者的工作内存.  帧中原有的页被换出
+	 * (脏页先写回), 预留期间这些帧不参与页的缓存.
+	 *
+	 * @param count 帧数
+	 * @return 预留的帧, 析构时归还
+	 * @throws BufferExceededException 如果找不到 count 个连续的、没有被引用的帧
+	 */
+  FrameReservation reserveFrames(const std::uint32_t count);
+
+	/**
+	 * 开始把页访问事件 (引用, 放开, 分配, 删除, 写回文件, 预留帧) 记录到 path,
+	 * 供 TraceReplay 在其他配置的缓冲池上重放.  已经在记录时先结束之前的踪迹.
+	 *
+	 * 事件在 latch 内按发生顺序写入, 多个线程的访问交织在同一条踪迹中.
+	 *
+	 * @param path 踪迹文件, 已存在时覆盖
+	 * @throws std::runtime_error 文件无法打开时
+	 */
+  void startTrace(const std::string& path);
+
+	/**
+	 * 结束记录并写出踪迹文件.  没有在记录时什么也不做.
+	 */
+  void stopTrace();
+
+	/**
+	 * 在运行中改变缓冲池的帧数, 不丢弃缓存的页, 也不使已有的页视图失效.
+	 *
+	 * 扩大时先重新启用正在退出的帧, 再分配一段新的帧.  缩小时编号不小于 bufs 的帧
+	 * 立即不再分配给新的页; 其中空闲的帧马上被换出 (脏页写回), 被引用的帧在放开时换出.
+	 * 换出的帧的页的物理内存归还给操作系统, 帧本身和虚拟地址保留到再次扩大时重用.
+	 * 页表 (哈希表) 随之改变大小, 已有的项逐步迁移.
+	 * 缺失率曲线的样本保留, 按新的大小重新分桶 (见 MissRatioEstimator::rescale()).
+	 * bufs 与当前的帧数相同时什么也不做.
+	 *
+	 * @param bufs 新的帧数
+	 * @throws std::invalid_argument bufs 为 0 时
+	 */
+  void resize(const std::uint32_t bufs);
+
+	/**
+	 * 当前的帧数 (不含正在退出的帧)
+	 */
+  std::uint32_t size() const;
+
+	/**
+	 * 根据到目前为止的访问估计缺失率曲线: 缓冲池为当前大小的 0.5, 1, 2, 4 倍时预计的命中率.
+	 *
+	 * 估计假定替换策略为 LRU (CLOCK 与它接近), 只抽样约 1% 的页, 内存占用有上界,
+	 * 访问路径上未抽中的页只多一次散列.  见 MissRatioEstimator.
+	 */
+  std::vector<MissRatioPoint> missRatioCurve() const;
+
+	/**
+	 * 丢弃到目前为止的重用距离样本, 之后的 missRatioCurve() 只反映新的访问
+	 */
+  void clearMissRatioCurve();
 
   //Print member variable values. 
   void  printSelf();
 
-  //Get buffer pool usage statistics
-  BufStats & getBufStats(){		return bufStats;  }
+	/**
+	 * 缓冲池使用情况的快照, 含按文件的细分.  两个快照相减得到期间的增量.
+	 */
+  BufStats getBufStats() const {		return counters.snapshot();  }
   //Clear buffer pool usage statistics
-  void clearBufStats()   {		bufStats.clear();  }
+  void clearBufStats()   {		counters.clear();  }
 };
 
+inline void PageView::unpin(){
+	if(page){
+		mgr.unPinFrame(stpage->frameNo,false,false);
+	}
+	page = nullptr;
+}
+
+inline PageView MutablePageView::to_immut()const{
+	mgr.pinFrame(stpage->frameNo);
+	return PageView(stpage,mgr);
+}
+
+inline Page* FrameReservation::pages() const{
+	return &mgr->frames[first].data;
+}
+
+inline FrameReservation::~FrameReservation(){
+	if(count > 0){
+		mgr->releaseFrames(first,count);
+	}
+}
+
+inline void MutablePageView::unpin(){
+	if(page){
+		mgr.unPinFrame(stpage->frameNo,true,true);
+	}
+	page = nullptr;
+}
+
 }
@@ -0,0 +1,74 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bulk_loader.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "exceptions/insufficient_space_exception.h"
+
+namespace badgerdb {
+
+BulkLoader::BulkLoader(File& file, const PageId batch_pages)
+    : file_(file),
+      batch_(std::max<PageId>(1, batch_pages)),
+      used_(0),
+      batch_first_(file.numPages()),
+      record_page_open_(false) {}
+
+BulkLoader::~BulkLoader() {
+  try {
+    finish();
+  } catch (...) {
+  }
+}
+
+RecordId BulkLoader::insertRecord(std::string_view record) {
+  if (!record_page_open_ || !batch_[used_ - 1].hasSpaceForRecord(record)) {
+    if (record.size() + sizeof(PageSlot) > Page::DATA_SIZE) {
+      throw InsufficientSpaceException(Page::INVALID_NUMBER, record.size(),
+                                       Page::DATA_SIZE - sizeof(PageSlot));
+    }
+    newPage();
+    record_page_open_ = true;
+  }
+  return batch_[used_ - 1].insertRecord(record);
+}
+
+Page& BulkLoader::newPage() {
+  if (used_ == batch_.size()) {
+    flush();
+  }
+  Page& page = batch_[used_];
+  page.initialize();
+  page.set_page_number(batch_first_ + used_);
+  ++used_;
+  record_page_open_ = false;
+  return page;
+}
+
+void BulkLoader::finish() {
+  flush();
+}
+
+void BulkLoader::flush() {
+  record_page_open_ = false;
+  if (used_ == 0) {
+    return;
+  }
+  // 页号在装入记录时就已填好, 先确认文件没有变过再写出, 否则不写
+  if (file_.numPages() != batch_first_) {
+    throw std::logic_error("pages were allocated in " + file_.filename() +
+                           " during a bulk load");
+  }
+  file_.appendPages(batch_.data(), used_);
+  batch_first_ += used_;
+  used_ = 0;
+}
+
+}
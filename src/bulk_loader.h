@@ -0,0 +1,106 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 批量装载: 在内存中把记录装进页, 整批地追加到文件末尾.
+ *
+ * 逐条装载记录要为每条记录读写一次页, 为每个新页调用一次 File::allocatePage()
+ * (读写文件头和前驱页的页头).  BulkLoader 在内存中填满一批页 (默认 256 页,
+ * 即 2 MiB), 然后用 File::appendPages() 一次顺序写出整批, 文件头和使用链表
+ * 每批只改写一次.  追加的页不经过缓冲池.
+ *
+ * 页号在装入记录时就已确定 (从构造时文件的 numPages() 起连续分配),
+ * 所以 insertRecord() 能立即返回 RecordId.  因此装载期间不能有其他人在同一
+ * 文件中分配页, 缓冲池中也不能有该文件的脏页等着被写回到这些页号.
+ */
+class BulkLoader {
+ public:
+  /**
+   * 每批默认的页数
+   */
+  static constexpr PageId DEFAULT_BATCH_PAGES = 256;
+
+  /**
+   * @param file         装载的目标文件
+   * @param batch_pages  每次写出的页数
+   */
+  explicit BulkLoader(File& file, const PageId batch_pages = DEFAULT_BATCH_PAGES);
+
+  /**
+   * 写出还没写出的页.  出错时错误被忽略, 需要知道写出是否成功请先调用 finish().
+   */
+  ~BulkLoader();
+
+  BulkLoader(const BulkLoader&) = delete;
+  BulkLoader& operator=(const BulkLoader&) = delete;
+
+  /**
+   * 追加一条记录.  当前页放不下时开始一个新页.
+   *
+   * @param record  组成该记录的字节
+   * @return  新记录的ID
+   * @throws  InsufficientSpaceException  记录比一个空页还大时
+   */
+  RecordId insertRecord(std::string_view record);
+
+  /**
+   * 追加一个空页, 由调用者自行组织它的内容 (例如索引节点, 见 Page::rawData()).
+   * 页号已经填好.  返回的引用在下一次调用 insertRecord()/newPage()/finish() 之前有效.
+   *
+   * @return  新页
+   */
+  Page& newPage();
+
+  /**
+   * 写出所有还没写出的页
+   *
+   * @throws std::logic_error 装载期间有别人在文件中分配了页时 (这批页不会写出,
+   *         不会覆盖别人分配的页)
+   */
+  void finish();
+
+ private:
+  /**
+   * 把内存中的这批页追加到文件
+   */
+  void flush();
+
+  File& file_;
+
+  /**
+   * 正在填充的一批页
+   */
+  std::vector<Page> batch_;
+
+  /**
+   * batch_ 中已经使用的页数
+   */
+  PageId used_;
+
+  /**
+   * batch_[0] 的页号
+   */
+  PageId batch_first_;
+
+  /**
+   * batch_ 的最后一页是否是 insertRecord() 正在填充的记录页
+   */
+  bool record_page_open_;
+};
+
+}
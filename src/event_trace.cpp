@@ -0,0 +1,119 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "event_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+namespace badgerdb {
+
+std::atomic<bool> EventTracer::enabled_{false};
+thread_local EventTracer::Ring* EventTracer::local_ring_ = nullptr;
+std::mutex EventTracer::mutex_;
+std::vector<std::unique_ptr<EventTracer::Ring>> EventTracer::rings_;
+std::vector<EventTracer::Ring*> EventTracer::free_rings_;
+std::uint64_t EventTracer::start_ticks_ = 0;
+std::uint64_t EventTracer::start_ns_ = 0;
+
+namespace {
+
+std::uint64_t steadyNs() {
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void writeJsonString(std::ostream& out, const char* s) {
+  out << '"';
+  for (; *s != '\0'; ++s) {
+    if (*s == '"' || *s == '\\') {
+      out << '\\';
+    }
+    out << *s;
+  }
+  out << '"';
+}
+
+}
+
+void EventTracer::start() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  start_ns_ = steadyNs();
+  start_ticks_ = now();
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void EventTracer::stop() {
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+EventTracer::Ring* EventTracer::registerThread() {
+  // 与 local_ring_ 分开: local_ring_ 在热路径上, 不能带析构函数
+  static thread_local ThreadExit exit;
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (free_rings_.empty()) {
+    rings_.push_back(std::make_unique<Ring>(static_cast<std::uint32_t>(rings_.size())));
+    local_ring_ = rings_.back().get();
+  } else {
+    local_ring_ = free_rings_.back();
+    free_rings_.pop_back();
+  }
+  exit.ring = local_ring_;
+  return local_ring_;
+}
+
+EventTracer::ThreadExit::~ThreadExit() {
+  if (ring == nullptr) {
+    return;
+  }
+  local_ring_ = nullptr;
+  std::lock_guard<std::mutex> guard(mutex_);
+  free_rings_.push_back(ring);
+}
+
+void EventTracer::writeChromeTrace(std::ostream& out) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  // 用 start() 以来时间戳和 steady_clock 的增量换算时间戳的单位
+  const std::uint64_t ticks = now() - start_ticks_;
+  const std::uint64_t ns = steadyNs() - start_ns_;
+  const double us_per_tick = ticks == 0 ? 1e-3 : static_cast<double>(ns) / 1e3 / static_cast<double>(ticks);
+
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  for (const std::unique_ptr<Ring>& ring : rings_) {
+    const std::uint64_t head = ring->head.load(std::memory_order_acquire);
+    const std::uint64_t oldest = head > RING_CAPACITY ? head - RING_CAPACITY : 0;
+    for (std::uint64_t i = oldest; i < head; ++i) {
+      const Event& event = ring->events[i % RING_CAPACITY];
+      const char* name = event.name.load(std::memory_order_relaxed);
+      const std::uint64_t begin = event.begin.load(std::memory_order_relaxed);
+      const std::uint64_t end = event.end.load(std::memory_order_relaxed);
+      if (name == nullptr || begin < start_ticks_ || end < begin) {
+        continue;
+      }
+      out << (first ? "\n" : ",\n") << "{\"name\":";
+      writeJsonString(out, name);
+      out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid
+          << ",\"ts\":" << static_cast<double>(begin - start_ticks_) * us_per_tick
+          << ",\"dur\":" << static_cast<double>(end - begin) * us_per_tick << "}";
+      first = false;
+    }
+  }
+  out << "\n]}\n";
+}
+
+void EventTracer::writeChromeTrace(const std::string& path) {
+  std::ofstream out(path);
+  if (!out) {
+    throw std::runtime_error("cannot open trace file " + path);
+  }
+  writeChromeTrace(out);
+}
+
+}
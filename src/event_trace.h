@@ -0,0 +1,178 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <chrono>
+
+namespace badgerdb {
+
+/**
+ * @brief 热路径上的事件追踪: 记录带时间戳的区间 (开始时间和持续时间),
+ * 可以导出为 Chrome trace / Perfetto 的 JSON.
+ *
+ * 追踪在编译期开关: 定义 BADGERDB_TRACING 时 BADGERDB_TRACE_SCOPE(name)
+ * 记录所在作用域的区间, 否则展开为空, 没有任何开销.  编译进来以后,
+ * 还需要在运行时 start() 才开始记录.
+ *
+ * 每个线程写自己的环形缓冲区 (单生产者, 不加锁, 满了覆盖最旧的事件),
+ * 时间戳在 x86 上是 TSC, 导出时换算成微秒.  线程结束后它的环留给之后的新线程
+ * 接着写, 所以环的个数是同时存在过的线程数的最大值, 而不是创建过的线程总数;
+ * 先后使用同一个环的线程在导出的 trace 中是同一个 tid.  一个事件是两次读时间戳和三次普通的写.
+ *
+ * @code
+ * EventTracer::start();
+ * runQuery();
+ * EventTracer::stop();
+ * EventTracer::writeChromeTrace("query.json");  // 在 chrome://tracing 或 ui.perfetto.dev 中打开
+ * @endcode
+ */
+class EventTracer {
+ public:
+  /**
+   * 每个线程保留的最近事件数
+   */
+  static constexpr std::size_t RING_CAPACITY = 1 << 15;
+
+  /**
+   * 当前时间戳 (x86 上为 TSC 的计数, 其他平台为纳秒)
+   */
+  static std::uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+  }
+
+  /**
+   * 是否在记录
+   */
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  /**
+   * 开始记录.  之前记录的事件不再导出.
+   */
+  static void start();
+
+  /**
+   * 停止记录, 已记录的事件保留到下一次 start().  正在进行的区间结束时仍会被记录.
+   */
+  static void stop();
+
+  /**
+   * 记录本线程的一个区间.  name 须是字符串字面量 (或至少活到导出时).
+   */
+  static void record(const char* name, const std::uint64_t begin, const std::uint64_t end) {
+    Ring* ring = local_ring_;
+    if (ring == nullptr) {
+      ring = registerThread();
+    }
+    const std::uint64_t head = ring->head.load(std::memory_order_relaxed);
+    Event& event = ring->events[head % RING_CAPACITY];
+    event.name.store(name, std::memory_order_relaxed);
+    event.begin.store(begin, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    ring->head.store(head + 1, std::memory_order_release);
+  }
+
+  /**
+   * 以 Chrome trace 的 JSON 格式输出所有线程记录的事件.
+   * 应在 stop() 之后调用; 记录同时进行时, 各线程最旧的几个事件可能已被覆盖而不一致.
+   */
+  static void writeChromeTrace(std::ostream& out);
+
+  /**
+   * @throws std::runtime_error 文件无法打开时
+   */
+  static void writeChromeTrace(const std::string& path);
+
+ private:
+  struct Event {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<std::uint64_t> begin{0};
+    std::atomic<std::uint64_t> end{0};
+  };
+
+  struct Ring {
+    explicit Ring(const std::uint32_t _tid) : tid(_tid), events(RING_CAPACITY) {}
+    const std::uint32_t tid;
+    std::atomic<std::uint64_t> head{0};
+    std::vector<Event> events;
+  };
+
+  /**
+   * 为本线程取一个环形缓冲区: 优先用已经结束的线程留下的环, 没有时创建并登记一个.
+   */
+  static Ring* registerThread();
+
+  /**
+   * 线程结束时析构, 把线程的环放回 free_rings_.  环中的事件保留, 直到被新的线程覆盖.
+   */
+  struct ThreadExit {
+    Ring* ring = nullptr;
+    ~ThreadExit();
+  };
+
+  static std::atomic<bool> enabled_;
+  static thread_local Ring* local_ring_;
+  static std::mutex mutex_;
+  static std::vector<std::unique_ptr<Ring>> rings_;
+  /// 线程已经结束、可以重用的环.  由 mutex_ 保护
+  static std::vector<Ring*> free_rings_;
+  /// start() 时的时间戳和 steady_clock 纳秒: 更早的事件不导出, 并用于把时间戳换算为微秒.
+  /// 由 mutex_ 保护
+  static std::uint64_t start_ticks_;
+  static std::uint64_t start_ns_;
+};
+
+/**
+ * @brief 在析构时把从构造到析构的区间记录为一个事件
+ */
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name)
+      : name_(EventTracer::enabled() ? name : nullptr), begin_(name_ ? EventTracer::now() : 0) {}
+
+  ~TraceScope() {
+    if (name_ != nullptr) {
+      EventTracer::record(name_, begin_, EventTracer::now());
+    }
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* const name_;
+  const std::uint64_t begin_;
+};
+
+}
+
+#define BADGERDB_TRACE_CONCAT_INNER(a, b) a##b
+#define BADGERDB_TRACE_CONCAT(a, b) BADGERDB_TRACE_CONCAT_INNER(a, b)
+
+#ifdef BADGERDB_TRACING
+/// 把所在作用域记录为名为 name (字符串字面量) 的事件
+#define BADGERDB_TRACE_SCOPE(name) \
+  ::badgerdb::TraceScope BADGERDB_TRACE_CONCAT(badgerdb_trace_scope_, __LINE__)(name)
+#else
+#define BADGERDB_TRACE_SCOPE(name) static_cast<void>(0)
+#endif
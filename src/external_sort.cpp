@@ -0,0 +1,273 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "external_sort.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "bulk_loader.h"
+#include "page_iterator.h"
+#include "temp_file.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * 顺序读取一个顺串中的记录.  每次把顺串中连续的若干页整段读入调用者提供的缓冲区.
+ */
+class RunReader {
+ public:
+  RunReader(File& file, const PageId first, const PageId last, Page* buffer,
+            const PageId capacity)
+      : file_(&file), next_page_(first), last_(last), buffer_(buffer),
+        capacity_(capacity), loaded_(0), page_index_(0), valid_(true) {
+    seek();
+  }
+
+  /**
+   * 是否还有记录
+   */
+  bool valid() const { return valid_; }
+
+  /**
+   * 当前记录, 在 next() 之前有效
+   */
+  std::string_view record() const { return current_; }
+
+  /**
+   * 移到下一条记录
+   */
+  void next() {
+    ++iter_;
+    seek();
+  }
+
+ private:
+  /**
+   * 从当前位置起找到下一条记录, 需要时读入顺串的下一段页
+   */
+  void seek() {
+    for (;;) {
+      if (page_index_ < loaded_) {
+        const Page& page = buffer_[page_index_];
+        if (iter_ != page.end()) {
+          current_ = page.getRecordView(iter_.record_id());
+          return;
+        }
+        if (++page_index_ < loaded_) {
+          iter_ = buffer_[page_index_].begin();
+        }
+        continue;
+      }
+      if (next_page_ >= last_) {
+        valid_ = false;
+        return;
+      }
+      loaded_ = std::min(capacity_, last_ - next_page_);
+      file_->readPages(next_page_, loaded_, buffer_);
+      next_page_ += loaded_;
+      page_index_ = 0;
+      iter_ = buffer_[0].begin();
+    }
+  }
+
+  File* file_;
+  PageId next_page_;
+  PageId last_;
+  Page* buffer_;
+  PageId capacity_;
+  PageId loaded_;
+  PageId page_index_;
+  PageIterator iter_;
+  std::string_view current_;
+  bool valid_;
+};
+
+/**
+ * k 路归并用的败者树.  内部节点 tree_[1..k-1] 记录在该处比赛中输掉的顺串,
+ * tree_[0] 是总的胜者.  取走胜者的一条记录后只需沿它到根的路径重赛一次,
+ * 每条记录 O(log k) 次比较.
+ */
+class LoserTree {
+ public:
+  LoserTree(const std::vector<RunReader>& readers, const ExternalSort::Less& less)
+      : readers_(readers), less_(less), k_(readers.size()), tree_(readers.size(), readers.size()) {
+    // 所有节点先填上一个比任何记录都小的虚拟顺串 k_, 再依次让每个顺串参赛.
+    for (std::size_t i = k_; i-- > 0;) {
+      adjust(i);
+    }
+  }
+
+  /**
+   * 当前记录最小的顺串; 它已经没有记录时, 所有顺串都归并完了
+   */
+  std::size_t winner() const { return tree_[0]; }
+
+  /**
+   * 胜者前进到下一条记录之后, 重新决出胜者
+   */
+  void replay() { adjust(tree_[0]); }
+
+ private:
+  /**
+   * 顺串 a 的当前记录是否应排在 b 的之前.  没有记录的顺串视为无穷大;
+   * 相等时下标小的在前, 结果与参赛顺序无关.
+   */
+  bool beats(const std::size_t a, const std::size_t b) const {
+    if (a == k_) {
+      return true;
+    }
+    if (b == k_) {
+      return false;
+    }
+    if (!readers_[a].valid()) {
+      return false;
+    }
+    if (!readers_[b].valid()) {
+      return true;
+    }
+    if (less_(readers_[a].record(), readers_[b].record())) {
+      return true;
+    }
+    if (less_(readers_[b].record(), readers_[a].record())) {
+      return false;
+    }
+    return a < b;
+  }
+
+  /**
+   * 顺串 s 从它的叶节点一路比赛到根
+   */
+  void adjust(std::size_t s) {
+    for (std::size_t t = (s + k_) / 2; t > 0; t /= 2) {
+      if (beats(tree_[t], s)) {
+        std::swap(s, tree_[t]);
+      }
+    }
+    tree_[0] = s;
+  }
+
+  const std::vector<RunReader>& readers_;
+  const ExternalSort::Less& less_;
+  const std::size_t k_;
+  std::vector<std::size_t> tree_;
+};
+
+}
+
+ExternalSort::ExternalSort(BufMgr& mgr, ThreadPool& pool, const std::uint32_t budget,
+                           Less less)
+    : mgr_(mgr), pool_(pool), budget_(budget), less_(std::move(less)) {
+  if (budget_ < 2 || budget_ < pool_.size()) {
+    throw std::invalid_argument("sort budget must be at least 2 frames and one frame per worker");
+  }
+}
+
+void ExternalSort::sort(File& input, File& output) {
+  FrameReservation reservation = mgr_.reserveFrames(budget_);
+  Page* arena = reservation.pages();
+
+  std::vector<std::unique_ptr<TempFile>> temps;
+  std::vector<File*> files;
+  for (unsigned w = 0; w < pool_.size(); ++w) {
+    temps.push_back(std::make_unique<TempFile>(output.filename(), "sort", output.ioMode()));
+    files.push_back(&temps.back()->file());
+  }
+  std::vector<Run> runs = generateRuns(input, arena, files);
+
+  // 顺串比帧多时每个顺串连一页读缓冲都分不到: 每趟把每 budget_ 个顺串
+  // 归并成一个, 写到新的临时文件, 直到能一次归并完.
+  while (runs.size() > budget_) {
+    auto merged_file = std::make_unique<TempFile>(output.filename(), "sort", output.ioMode());
+    File& file = merged_file->file();
+    std::vector<Run> merged;
+    for (std::size_t begin = 0; begin < runs.size(); begin += budget_) {
+      const std::size_t end = std::min<std::size_t>(begin + budget_, runs.size());
+      const PageId first = file.numPages();
+      mergeRuns(runs, begin, end, arena, file);
+      merged.push_back({&file, first, file.numPages()});
+    }
+    temps.clear();
+    temps.push_back(std::move(merged_file));
+    runs = std::move(merged);
+  }
+  if (!runs.empty()) {
+    mergeRuns(runs, 0, runs.size(), arena, output);
+  }
+}
+
+std::vector<ExternalSort::Run> ExternalSort::generateRuns(File& input, Page* arena,
+                                                          const std::vector<File*>& files) {
+  const PageId per_worker = budget_ / pool_.size();
+  const PageId num_pages = input.numPages();
+  const std::size_t num_tasks =
+      num_pages > 1 ? (num_pages - 1 + per_worker - 1) / per_worker : 0;
+  std::vector<Run> runs(num_tasks, Run{nullptr, 0, 0});
+
+  pool_.parallelFor(num_tasks, [&](unsigned worker, std::size_t task) {
+    // 把输入中连续的一段页整段读入本线程分到的帧, 记录留在页里原地排序.
+    Page* pages = arena + static_cast<std::size_t>(worker) * per_worker;
+    const PageId first = static_cast<PageId>(1 + task * per_worker);
+    const PageId count = std::min<PageId>(per_worker, num_pages - first);
+    input.readPages(first, count, pages);
+
+    std::vector<std::string_view> records;
+    for (PageId i = 0; i < count; ++i) {
+      const Page& page = pages[i];
+      if (page.page_number() == Page::INVALID_NUMBER) {
+        continue;  // 空闲页
+      }
+      for (PageIterator iter = page.begin(); iter != page.end(); ++iter) {
+        records.push_back(page.getRecordView(iter.record_id()));
+      }
+    }
+    if (records.empty()) {
+      return;
+    }
+    std::sort(records.begin(), records.end(), less_);
+
+    File& file = *files[worker];
+    const PageId run_first = file.numPages();
+    BulkLoader loader(file, RUN_WRITE_PAGES);
+    for (const std::string_view record : records) {
+      loader.insertRecord(record);
+    }
+    loader.finish();
+    runs[task] = {&file, run_first, file.numPages()};
+  });
+
+  std::erase_if(runs, [](const Run& run) { return run.file == nullptr; });
+  return runs;
+}
+
+void ExternalSort::mergeRuns(const std::vector<Run>& runs, const std::size_t begin,
+                             const std::size_t end, Page* arena, File& output) {
+  const std::size_t k = end - begin;
+  const PageId per_run = static_cast<PageId>(budget_ / k);
+  std::vector<RunReader> readers;
+  readers.reserve(k);
+  for (std::size_t i = 0; i < k; ++i) {
+    const Run& run = runs[begin + i];
+    readers.emplace_back(*run.file, run.first, run.last, arena + i * per_run, per_run);
+  }
+
+  LoserTree tree(readers, less_);
+  BulkLoader loader(output, RUN_WRITE_PAGES);
+  for (std::size_t w = tree.winner(); readers[w].valid(); w = tree.winner()) {
+    loader.insertRecord(readers[w].record());
+    readers[w].next();
+    tree.replay();
+  }
+  loader.finish();
+}
+
+}
@@ -0,0 +1,105 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "thread_pool.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 外部归并排序: 对比内存大得多的堆文件中的记录排序.
+ *
+ * 工作内存是从 BufMgr 预留的 budget 个连续的帧 (见 BufMgr::reserveFrames()),
+ * 排序期间它们不参与页的缓存, 结束后归还.
+ *
+ * 1. 生成顺串: 预留的帧平分给 ThreadPool 的各个工作线程.  每个线程一次把
+ *    输入文件中连续的一段页 (与它分到的帧数一样多) 整段读入自己的帧, 在页内
+ *    原地对记录排序, 写成一个顺串.  每个线程的顺串写在自己的临时文件里.
+ * 2. 归并: 预留的帧平分给各个顺串作为读缓冲, 每次整段读入一个顺串中连续的页,
+ *    用败者树做 k 路归并.  顺串多于帧数时先分组归并成更长的顺串 (多趟归并).
+ *
+ * 顺串和结果都通过 BulkLoader 成批顺序写出 (每个写者另有 RUN_WRITE_PAGES 页的
+ * 写缓冲, 不计入 budget).  临时文件与输出文件同目录, 名为 "<输出文件名>.sort<n>",
+ * 排序结束 (或出错) 时删除.
+ *
+ * 排序直接从磁盘读输入文件, 不经过缓冲池: 输入文件在缓冲池中的脏页须先写回.
+ */
+class ExternalSort {
+ public:
+  /**
+   * 记录的比较函数: 第一条记录是否应排在第二条之前.
+   * 生成顺串时会被多个线程同时调用.
+   */
+  using Less = std::function<bool(std::string_view, std::string_view)>;
+
+  /**
+   * 顺串和结果的每个写者一次写出的页数
+   */
+  static constexpr PageId RUN_WRITE_PAGES = 32;
+
+  /**
+   * @param mgr     从中预留工作内存的缓冲池
+   * @param pool    生成顺串的线程池
+   * @param budget  工作内存的帧数, 至少为线程数, 且至少为 2
+   * @param less    记录的比较函数
+   * @throws std::invalid_argument budget 太小时
+   */
+  ExternalSort(BufMgr& mgr, ThreadPool& pool, const std::uint32_t budget, Less less);
+
+  /**
+   * 把 input 中的所有记录排好序后追加到 output.
+   * 相等的记录在结果中的相对顺序不确定.
+   *
+   * @param input   输入的堆文件
+   * @param output  输出的堆文件, 记录追加在它的末尾
+   * @throws BufferExceededException 缓冲池中找不到 budget 个连续的空闲帧时
+   */
+  void sort(File& input, File& output);
+
+ private:
+  /**
+   * 一个顺串: 某个临时文件中 [first, last) 的页
+   */
+  struct Run {
+    File* file;
+    PageId first;
+    PageId last;
+  };
+
+  /**
+   * 生成顺串
+   *
+   * @param input   输入文件
+   * @param arena   预留的帧
+   * @param files   各个线程的临时文件
+   * @return 所有的顺串
+   */
+  std::vector<Run> generateRuns(File& input, Page* arena,
+                                const std::vector<File*>& files);
+
+  /**
+   * 把 runs 中 [begin, end) 的顺串归并后追加到 output
+   */
+  void mergeRuns(const std::vector<Run>& runs, const std::size_t begin,
+                 const std::size_t end, Page* arena, File& output);
+
+  BufMgr& mgr_;
+  ThreadPool& pool_;
+  const std::uint32_t budget_;
+  Less less_;
+};
+
+}
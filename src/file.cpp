@@ -11,8 +11,22 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <algorithm>
 #include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
 #include <cassert>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#define BADGERDB_HAVE_POSIX_IO 1
+#endif
 
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
@@ -20,26 +34,145 @@
 #include "exceptions/invalid_page_exception.h"
 #include "file_iterator.h"
 #include "page.h"
+#include "event_trace.h"
 
 namespace badgerdb {
 
 constexpr std::ios_base::openmode OPEN_MODE =std::fstream::in | std::fstream::out | std::fstream::binary;
 
-File::CountMap File::opened_files;
+namespace {
+
+/**
+ * 文件头所在块的大小.  只读写这么多字节,直接 I/O 下也满足对齐要求.
+ */
+constexpr std::size_t HEADER_BLOCK_SIZE = PAGE_IO_ALIGNMENT;
+
+/**
+ * 读写文件头/页头时使用的对齐缓冲区.
+ */
+struct alignas(PAGE_IO_ALIGNMENT) HeaderBlock {
+  char bytes[HEADER_BLOCK_SIZE];
+};
+
+static_assert(sizeof(FileHeader) <= HEADER_BLOCK_SIZE);
+static_assert(sizeof(PageHeader) <= HEADER_BLOCK_SIZE);
+
+/**
+ * 直接 I/O 的缓冲区是否满足对齐要求.  Page 虽然按 PAGE_IO_ALIGNMENT 声明对齐,
+ * 但编译器不一定为按值返回的临时 Page 保证这一点.
+ */
+bool isIoAligned(const void* buf) {
+  return reinterpret_cast<std::uintptr_t>(buf) % PAGE_IO_ALIGNMENT == 0;
+}
+
+struct AlignedDeleter {
+  void operator()(char* p) const {
+    ::operator delete[](p, std::align_val_t(PAGE_IO_ALIGNMENT));
+  }
+};
+
+/**
+ * 为不对齐的调用者缓冲区分配一个对齐的中转缓冲区.
+ */
+std::unique_ptr<char[], AlignedDeleter> allocateAligned(const std::size_t len) {
+  return std::unique_ptr<char[], AlignedDeleter>(static_cast<char*>(
+      ::operator new[](len, std::align_val_t(PAGE_IO_ALIGNMENT))));
+}
+
+}
+
+std::mutex FileRegistry::mutex_;
+std::vector<File*> FileRegistry::files_;
+std::vector<FileId> FileRegistry::free_ids_;
+std::mutex FileRegistry::listeners_mutex_;
+std::map<std::uint64_t, FileRegistry::CloseListener> FileRegistry::listeners_;
+std::uint64_t FileRegistry::next_listener_ = 0;
+
+FileId FileRegistry::add(File* file) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (!free_ids_.empty()) {
+    const FileId id = free_ids_.back();
+    free_ids_.pop_back();
+    files_[id] = file;
+    return id;
+  }
+  files_.push_back(file);
+  return static_cast<FileId>(files_.size() - 1);
+}
+
+void FileRegistry::remove(const FileId id) {
+  {
+    std::lock_guard<std::mutex> guard(listeners_mutex_);
+    File* const file = get(id);
+    for (const auto& [token, listener] : listeners_) {
+      listener(*file);
+    }
+  }
+  std::lock_guard<std::mutex> guard(mutex_);
+  files_[id] = nullptr;
+  free_ids_.push_back(id);
+}
+
+std::uint64_t FileRegistry::addCloseListener(CloseListener listener) {
+  std::lock_guard<std::mutex> guard(listeners_mutex_);
+  const std::uint64_t token = next_listener_++;
+  listeners_.emplace(token, std::move(listener));
+  return token;
+}
+
+void FileRegistry::removeCloseListener(const std::uint64_t token) {
+  std::lock_guard<std::mutex> guard(listeners_mutex_);
+  listeners_.erase(token);
+}
+
+File* FileRegistry::get(const FileId id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return id < files_.size() ? files_[id] : nullptr;
+}
+
+bool FileRegistry::contains(const std::string& filename) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (const File* file : files_) {
+    if (file != nullptr && file->filename() == filename) {
+      return true;
+    }
+  }
+  return false;
+}
 
-File::sptr File::create(const std::string& filename) {
+File::sptr File::create(const std::string& filename, const IoMode mode,
+                        const PageLayout& layout) {
   if(exists(filename)){throw FileExistsException(filename);  }
-  auto res = std::make_shared<File>(filename, std::fstream(filename ,OPEN_MODE));
+  sptr res(new File(filename, mode, true /* create_new */));
 
-  FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+  FileHeader header = {FileHeader::MAGIC, FileHeader::VERSION,
+                         1 /* num_pages */, 0 /* first_used_page */,
+                         0 /* num_free_pages */, 0 /* first_free_page */, layout};
   res -> writeHeader(header);
+  res -> layout_ = layout;
   return res;
 }
 
-File::sptr File::open(const std::string& filename) {
+File::sptr File::open(const std::string& filename, const IoMode mode) {
   if(! exists(filename)){throw FileNotFoundException(filename);  }
-  return std::make_shared<File>(filename, std::fstream(filename ,OPEN_MODE));
+  sptr res(new File(filename, mode, false /* create_new */));
+  const FileHeader header = res -> readHeader();
+  if (header.magic != FileHeader::MAGIC) {
+    throw std::invalid_argument("not a BadgerDB file: " + filename);
+  }
+  if (header.version != FileHeader::VERSION) {
+    throw std::invalid_argument("unsupported file format version " +
+                                std::to_string(header.version) + ": " + filename);
+  }
+  res -> layout_ = header.layout;
+  res -> num_pages_.store(header.num_pages, std::memory_order_release);
+  return res;
+}
+
+File::File(const std::string& name, const IoMode mode, const bool create_new)
+    : filename_(name), mode_(mode) {
+  openIfNeeded(create_new);
+  id_ = FileRegistry::add(this);
 }
 
 void File::remove(const std::string& filename) {
@@ -56,7 +189,7 @@ bool File::isOpen(const std::string& filename) {
   if (!exists(filename)) {
     return false;
   }
-  return opened_files.contains(filename);
+  return FileRegistry::contains(filename);
 }
 
 bool File::exists(const std::string& filename) {
@@ -72,89 +205,148 @@ bool File::exists(const std::string& filename) {
 
 
 
-
-File::~File() {
-  close();
-}
-
 Page File::allocatePage() {
+  BADGERDB_TRACE_SCOPE("File::allocatePage");
   FileHeader header = readHeader();
+  allocationMap();
   Page new_page;
-  Page existing_page;
   if (header.num_free_pages > 0) {
     new_page = readPage(header.first_free_page, true /* allow_free */);
     new_page.set_page_number(header.first_free_page);
     header.first_free_page = new_page.next_page_number();
     --header.num_free_pages;
 
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
-    }
-
     assert((header.num_free_pages == 0) ==
            (header.first_free_page == Page::INVALID_NUMBER));
   } else {
     new_page.set_page_number(header.num_pages);
-    if (header.first_used_page == Page::INVALID_NUMBER) {
-      header.first_used_page = new_page.page_number();
-    } else {
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
-    }
     ++header.num_pages;
+    allocation_map_.resize(header.num_pages, false);
   }
-  writePage(new_page.page_number(), new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page);
+
+  // Insert the new page into the used list, which is kept sorted by page
+  // number.  The allocation map tells us its predecessor and successor without
+  // walking the list on disk.
+  const PageId previous_page_number = previousUsedPage(new_page.page_number());
+  if (previous_page_number == Page::INVALID_NUMBER) {
+    new_page.set_next_page_number(header.first_used_page);
+    header.first_used_page = new_page.page_number();
+  } else {
+    new_page.set_next_page_number(nextUsedPage(previous_page_number));
+    writeNextPageNumber(previous_page_number, new_page.page_number());
   }
+  writePage(new_page.page_number(), new_page);
   writeHeader(header);
+  allocation_map_[new_page.page_number()] = true;
 
   return new_page;
 }
 
-Page File::readPage(const PageId page_number) {
+PageId File::appendPages(Page* pages, const PageId count) {
+  BADGERDB_TRACE_SCOPE("File::appendPages");
   FileHeader header = readHeader();
-  if (page_number >= header.num_pages) {
+  const PageId first = header.num_pages;
+  if (count == 0) {
+    return first;
+  }
+  allocationMap();
+  // The new pages have the largest numbers in the file, so they go to the end
+  // of the used list: chain them together and hang them off the last used page.
+  for (PageId i = 0; i < count; ++i) {
+    pages[i].set_page_number(first + i);
+    pages[i].set_next_page_number(i + 1 < count ? first + i + 1
+                                                : Page::INVALID_NUMBER);
+  }
+  writeAt(pagePosition(first), reinterpret_cast<const char*>(pages),
+          static_cast<std::size_t>(count) * Page::SIZE, IoOp::Write);
+  const PageId previous_page_number = previousUsedPage(first);
+  if (previous_page_number == Page::INVALID_NUMBER) {
+    header.first_used_page = first;
+  } else {
+    writeNextPageNumber(previous_page_number, first);
+  }
+  header.num_pages += count;
+  writeHeader(header);
+  allocation_map_.resize(header.num_pages, true);
+
+  return first;
+}
+
+Page File::readPage(const PageId page_number) {
+  if (page_number >= numPages()) {
     throw InvalidPageException(page_number, filename_);
   }
   return readPage(page_number, false /* allow_free */);
 }
 
+void File::readPage(const PageId page_number, Page& page) {
+  BADGERDB_TRACE_SCOPE("File::readPage");
+  if (page_number >= numPages()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  readAt(pagePosition(page_number), reinterpret_cast<char*>(&page), Page::SIZE, IoOp::Read);
+  if (!page.isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+}
+
+void File::readPages(const PageId first, const PageId count, Page* pages) {
+  BADGERDB_TRACE_SCOPE("File::readPages");
+  readAt(pagePosition(first), reinterpret_cast<char*>(pages),
+         static_cast<std::size_t>(count) * Page::SIZE, IoOp::Read);
+}
+
+const std::vector<bool>& File::allocationMap() {
+  if (!allocation_map_loaded_) {
+    const FileHeader header = readHeader();
+    allocation_map_.assign(header.num_pages, false);
+    std::vector<Page> chunk(READ_AHEAD_PAGES);
+    for (PageId first = 1; first < header.num_pages; first += READ_AHEAD_PAGES) {
+      const PageId count =
+          std::min<PageId>(READ_AHEAD_PAGES, header.num_pages - first);
+      readPages(first, count, chunk.data());
+      for (PageId i = 0; i < count; ++i) {
+        allocation_map_[first + i] = chunk[i].isUsed();
+      }
+    }
+    allocation_map_loaded_.store(true, std::memory_order_release);
+  }
+  return allocation_map_;
+}
+
+PageId File::previousUsedPage(const PageId page_number) {
+  const std::vector<bool>& used = allocationMap();
+  for (PageId i = std::min<PageId>(page_number, used.size()); i-- > 1;) {
+    if (used[i]) {
+      return i;
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
+PageId File::nextUsedPage(const PageId page_number) const {
+  for (PageId i = page_number + 1; i < allocation_map_.size(); ++i) {
+    if (allocation_map_[i]) {
+      return i;
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
+void File::writeNextPageNumber(const PageId page_number,
+                               const PageId next_page_number) {
+  HeaderBlock block;
+  readAt(pagePosition(page_number), block.bytes, HEADER_BLOCK_SIZE, IoOp::HeaderRead);
+  PageHeader header;
+  std::memcpy(&header, block.bytes, sizeof(header));
+  header.next_page_number = next_page_number;
+  std::memcpy(block.bytes, &header, sizeof(header));
+  writeAt(pagePosition(page_number), block.bytes, HEADER_BLOCK_SIZE, IoOp::HeaderWrite);
+}
+
 Page File::readPage(const PageId page_number, const bool allow_free) {
   Page page;
-  stream_.seekg(pagePosition(page_number), std::ios::beg);
-  stream_.read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_.read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
+  readAt(pagePosition(page_number), reinterpret_cast<char*>(&page), Page::SIZE, IoOp::Read);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
@@ -163,48 +355,50 @@ Page File::readPage(const PageId page_number, const bool allow_free) {
 }
 
 void File::writePage(const Page& new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
+  BADGERDB_TRACE_SCOPE("File::writePage");
+  const PageId page_number = new_page.page_number();
+  if (page_number == 0 || page_number >= numPages()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  // 只有分配和删除页会改动使用链表, 而它们都会先建立分配图: 分配图还没有
+  // 建立时, 页在读入之后后继页号没有变过.
+  if (!allocation_map_loaded_.load(std::memory_order_acquire)) {
+    writePage(page_number, new_page);
+    return;
+  }
+  if (!allocation_map_[page_number]) {
     // Page has been deleted since it was read.
-    throw InvalidPageException(new_page.page_number(), filename_);
+    throw InvalidPageException(page_number, filename_);
   }
   // Page on disk may have had its next page pointer updated since it was read;
-  // we don't modify that, but we do keep all the other modifications to the
-  // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
-  writePage(new_page.page_number(), header, new_page);
+  // the used list is sorted, so the allocation map tells us its current value.
+  // All the other modifications to the page header are kept.
+  PageHeader header = new_page.header_;
+  header.next_page_number = nextUsedPage(page_number);
+  writePage(page_number, header, new_page);
 }
 
 void File::deletePage(const PageId page_number) {
+  BADGERDB_TRACE_SCOPE("File::deletePage");
   FileHeader header = readHeader();
   Page existing_page = readPage(page_number);
-  Page previous_page;
+  allocationMap();
   // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
+  // the next page in line; otherwise update its predecessor in the list.
+  const PageId previous_page_number = previousUsedPage(page_number);
+  if (previous_page_number == Page::INVALID_NUMBER) {
     header.first_used_page = existing_page.next_page_number();
   } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
-      }
-    }
+    writeNextPageNumber(previous_page_number, existing_page.next_page_number());
   }
   // Clear the page and add it to the head of the free list.
   existing_page.initialize();
   existing_page.set_next_page_number(header.first_free_page);
   header.first_free_page = page_number;
   ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page);
-  }
   writePage(page_number, existing_page);
   writeHeader(header);
+  allocation_map_[page_number] = false;
 }
 
 FileIterator File::begin() {
@@ -216,43 +410,220 @@ FileIterator File::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
-
+void File::openIfNeeded(const bool create_new) {
+  bool created = false;
+  if (mode_ == IoMode::Direct) {
+#ifdef BADGERDB_HAVE_POSIX_IO
+    const int flags = O_RDWR | (create_new ? (O_CREAT | O_EXCL) : 0);
+    fd_ = ::open(filename_.c_str(), flags, 0644);
+    if (fd_ < 0 && create_new && errno == EEXIST) {
+      throw FileExistsException(filename_);
+    }
+    if (fd_ >= 0) {
+      created = create_new;
+      // 先以普通方式打开,再开启直接 I/O: 某些文件系统(如 tmpfs)不支持
+      // O_DIRECT,这时文件已经被创建,只能退化为带缓冲的 I/O.
+#if defined(O_DIRECT)
+      const bool direct_ok =
+          ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) | O_DIRECT) == 0;
+#elif defined(F_NOCACHE)
+      const bool direct_ok = ::fcntl(fd_, F_NOCACHE, 1) == 0;
+#else
+      const bool direct_ok = false;
+#endif
+      if (direct_ok) {
+        return;
+      }
+      ::close(fd_);
+      fd_ = -1;
+    }
+#endif
+    mode_ = IoMode::Buffered;
+  }
+#ifdef BADGERDB_HAVE_POSIX_IO
+  if (create_new && !created) {
+    // 以 O_EXCL 创建: 同时创建同名文件的线程 (或进程) 中只有一个成功,
+    // create() 开头的 exists() 检查做不到这一点.
+    const int fd = ::open(filename_.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno == EEXIST) {
+      throw FileExistsException(filename_);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+#endif
+  stream_.open(filename_, create_new ? OPEN_MODE | std::fstream::trunc
+                                     : OPEN_MODE);
+#ifdef BADGERDB_HAVE_POSIX_IO
+  if (stream_.is_open()) {
+    sync_fd_ = ::open(filename_.c_str(), O_RDONLY);
+  }
+#endif
+}
 
 void File::close() {
+#ifdef BADGERDB_HAVE_POSIX_IO
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  if (sync_fd_ >= 0) {
+    ::close(sync_fd_);
+    sync_fd_ = -1;
+  }
+#endif
   stream_.close();
 }
 
+void File::readAt(const std::streamoff pos, char* buf, const std::size_t len,
+                  const IoOp op) {
+  BADGERDB_TRACE_SCOPE("File::readAt");
+#ifdef BADGERDB_HAVE_POSIX_IO
+  if (fd_ >= 0 && !isIoAligned(buf)) {
+    auto bounce = allocateAligned(len);
+    readAt(pos, bounce.get(), len, op);
+    std::memcpy(buf, bounce.get(), len);
+    return;
+  }
+#endif
+  const FileIoStats::Timer timer(io_stats_, op, len);
+  std::size_t done = 0;
+#ifdef BADGERDB_HAVE_POSIX_IO
+  if (fd_ >= 0) {
+    while (done < len) {
+      const ssize_t n = ::pread(fd_, buf + done, len - done, pos + done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        throw std::system_error(errno, std::generic_category(), "read from " + filename_);
+      }
+      if (n == 0) {
+        break;  // 文件尾
+      }
+      done += static_cast<std::size_t>(n);
+    }
+  } else
+#endif
+  {
+    std::lock_guard<std::mutex> guard(stream_mutex_);
+    stream_.seekg(pos, std::ios::beg);
+    stream_.read(buf, len);
+    done = static_cast<std::size_t>(stream_.gcount());
+    if (stream_.bad()) {
+      stream_.clear();
+      throw std::runtime_error("read from " + filename_ + " failed");
+    }
+    if (done < len) {
+      // Reading past the end of the file; keep the stream usable.
+      stream_.clear();
+    }
+  }
+  if (done < len) {
+    std::memset(buf + done, 0, len - done);
+  }
+}
+
+void File::writeAt(const std::streamoff pos, const char* buf,
+                   const std::size_t len, const IoOp op) {
+  BADGERDB_TRACE_SCOPE("File::writeAt");
+#ifdef BADGERDB_HAVE_POSIX_IO
+  if (fd_ >= 0 && !isIoAligned(buf)) {
+    auto bounce = allocateAligned(len);
+    std::memcpy(bounce.get(), buf, len);
+    writeAt(pos, bounce.get(), len, op);
+    return;
+  }
+#endif
+  const FileIoStats::Timer timer(io_stats_, op, len);
+#ifdef BADGERDB_HAVE_POSIX_IO
+  if (fd_ >= 0) {
+    std::size_t done = 0;
+    while (done < len) {
+      const ssize_t n = ::pwrite(fd_, buf + done, len - done, pos + done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        throw std::system_error(errno, std::generic_category(), "write to " + filename_);
+      }
+      if (n == 0) {
+        throw std::runtime_error("short write to " + filename_);
+      }
+      done += static_cast<std::size_t>(n);
+    }
+    return;
+  }
+#endif
+  std::lock_guard<std::mutex> guard(stream_mutex_);
+  stream_.seekp(pos, std::ios::beg);
+  stream_.write(buf, len);
+  stream_.flush();
+  if (!stream_) {
+    stream_.clear();
+    throw std::runtime_error("write to " + filename_ + " failed");
+  }
+}
+
+void File::sync() {
+  BADGERDB_TRACE_SCOPE("File::sync");
+  const FileIoStats::Timer timer(io_stats_, IoOp::Sync, 0);
+#ifdef BADGERDB_HAVE_POSIX_IO
+  const int fd = fd_ >= 0 ? fd_ : sync_fd_;
+  if (fd >= 0) {
+#if defined(__APPLE__)
+    const int result = ::fsync(fd);  // macOS 没有 fdatasync
+#else
+    const int result = ::fdatasync(fd);
+#endif
+    if (result != 0) {
+      throw std::system_error(errno, std::generic_category(), "sync " + filename_);
+    }
+    return;
+  }
+#endif
+  std::lock_guard<std::mutex> guard(stream_mutex_);
+  stream_.flush();
+}
+
 void File::writePage(const PageId page_number, const Page& new_page) {
-  writePage(page_number, new_page.header_, new_page);
+  writeAt(pagePosition(page_number), reinterpret_cast<const char*>(&new_page),
+          Page::SIZE, IoOp::Write);
 }
 
 void File::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_.seekp(pagePosition(page_number), std::ios::beg);
-  stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_.write(reinterpret_cast<const char*>(&new_page.data_[0]),
-                 Page::DATA_SIZE);
-  stream_.flush();
+  if (&header == &new_page.header_) {
+    writePage(page_number, new_page);
+    return;
+  }
+  Page out = new_page;
+  out.header_ = header;
+  writePage(page_number, out);
 }
 
 FileHeader File::readHeader() {
+  HeaderBlock block;
+  readAt(0 /* pos */, block.bytes, HEADER_BLOCK_SIZE, IoOp::HeaderRead);
   FileHeader header;
-  stream_.seekg(0 /* pos */, std::ios::beg);
-  stream_.read(reinterpret_cast<char*>(&header), sizeof(header));
+  std::memcpy(&header, block.bytes, sizeof(header));
 
   return header;
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_.seekp(0 /* pos */, std::ios::beg);
-  stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_.flush();
+  HeaderBlock block = {};
+  std::memcpy(block.bytes, &header, sizeof(header));
+  writeAt(0 /* pos */, block.bytes, HEADER_BLOCK_SIZE, IoOp::HeaderWrite);
+  num_pages_.store(header.num_pages, std::memory_order_release);
 }
 
 PageHeader File::readPageHeader(PageId page_number) {
+  HeaderBlock block;
+  readAt(pagePosition(page_number), block.bytes, HEADER_BLOCK_SIZE, IoOp::HeaderRead);
   PageHeader header;
-  stream_.seekg(pagePosition(page_number), std::ios::beg);
-  stream_.read(reinterpret_cast<char*>(&header), sizeof(header));
+  std::memcpy(&header, block.bytes, sizeof(header));
 
   return header;
 }
@@ -7,21 +7,61 @@
 
 #pragma once
 
+#include <atomic>
 #include <fstream>
+#include <functional>
+#include <map>
 #include <string>
-#include <set>
+#include <vector>
+#include <mutex>
 #include <memory>
 
 #include "page.h"
+#include "file_io_stats.h"
 
 namespace badgerdb {
 
 class FileIterator;
+class File;
+
+/**
+ * @brief 文件的 I/O 方式,在打开/创建文件时逐个文件选择.
+ */
+enum class IoMode {
+  ///
+  /// 经由 std::fstream 的带缓冲 I/O,页面同时会被内核页缓存缓存一份.
+  Buffered,
+  ///
+  /// 绕过内核页缓存的直接 I/O (Linux 上为 O_DIRECT, macOS 上为 F_NOCACHE).
+  /// 缓冲池成为唯一的缓存.  读写缓冲区、偏移和长度都按 PAGE_IO_ALIGNMENT 对齐,
+  /// 而 Page 本身就是按此对齐的,所以缓冲池的帧可以直接作为读写目标.
+  /// 如果所在文件系统不支持直接 I/O, 文件会退化为 Buffered, 见 File::ioMode().
+  Direct,
+};
 
 /**
  * @brief 保存了文件中关于页使用情况的信息
+ *
+ * 文件头独占文件的第 0 块(即页号 0 的位置,该页号本身是不合法的),
+ * 这样所有页都从 Page::SIZE 的整数倍偏移处开始,满足直接 I/O 的对齐要求.
+ *
+ * 这改变了磁盘格式: 之前的文件头紧接着第 1 页, 页不在 Page::SIZE 的整数倍偏移处.
+ * 文件头以 MAGIC 和 VERSION 开头, File::open() 拒绝打开不匹配的文件 (包括之前格式的文件).
  */
 struct FileHeader {
+  ///
+  /// 文件头开头的标记, "BDBF"
+  static constexpr std::uint32_t MAGIC = 0x46424442;
+  ///
+  /// 当前的磁盘格式版本
+  static constexpr std::uint32_t VERSION = 1;
+
+  ///
+  /// 总是 MAGIC
+  std::uint32_t magic;
+  ///
+  /// 写入文件时的格式版本
+  std::uint32_t version;
   ///
   ///文件中的页数
   PageId num_pages;
@@ -34,10 +74,102 @@ struct FileHeader {
   ///
   /// 第一个空余(被分配但未使用)的页数
   PageId first_free_page;
+  ///
+  /// 文件中页的格式, 创建时确定
+  PageLayout layout;
 
   bool operator==(const FileHeader& rhs) const  = default;
 };
 
+/**
+ * @brief 为每个打开的 File 分配一个紧凑的 32 位编号 (FileId).
+ *
+ * 编号从 0 开始,关闭的文件的编号会被之后打开的文件重用,因此编号总是稠密的,
+ * 可以直接作为数组下标.  缓冲池、哈希表和页视图用 (FileId, PageId) 标识页,
+ * 只在需要真正读写磁盘时才通过 get() 找回 File 对象,
+ * 命中路径上不再有 shared_ptr 引用计数的原子操作.
+ *
+ * 以编号记录文件状态的组件 (缓冲池的帧和统计, 缓冲池的路由) 通过 addCloseListener()
+ * 得知文件关闭, 在编号被重用之前写回并丢掉该编号的状态.
+ */
+class FileRegistry {
+ public:
+  /**
+   * 表示不对应任何文件的编号
+   */
+  static constexpr FileId INVALID_ID = UINT32_MAX;
+
+  /**
+   * 登记一个刚打开的文件, 返回它的编号.
+   */
+  static FileId add(File* file);
+
+  /**
+   * 注销一个将要关闭的文件, 它的编号可以被重用.  先以该文件调用所有关闭回调.
+   */
+  static void remove(const FileId id);
+
+  /**
+   * 文件关闭时的回调.  调用时文件仍然登记着, 可以照常读写; 回调不能抛出异常,
+   * 也不能打开或关闭文件.
+   */
+  using CloseListener = std::function<void(File&)>;
+
+  /**
+   * 登记一个文件关闭时的回调
+   *
+   * @return 用于 removeCloseListener() 的标识
+   */
+  static std::uint64_t addCloseListener(CloseListener listener);
+
+  /**
+   * 注销回调.  返回之后它不会再被调用 (正在进行的调用先完成).
+   */
+  static void removeCloseListener(const std::uint64_t token);
+
+  /**
+   * 返回编号对应的文件, 编号未被使用时返回 nullptr.
+   */
+  static File* get(const FileId id);
+
+  /**
+   * 检查是否有已打开的文件叫这个名字.
+   */
+  static bool contains(const std::string& filename);
+
+ private:
+  /**
+   * 保护下面两个表
+   */
+  static std::mutex mutex_;
+
+  /**
+   * 以编号为下标的文件表, 空位为 nullptr.
+   */
+  static std::vector<File*> files_;
+
+  /**
+   * 可重用的编号.
+   */
+  static std::vector<FileId> free_ids_;
+
+  /**
+   * 保护关闭回调表, 调用回调期间一直持有, 所以注销回调会等待正在进行的调用.
+   * 与 mutex_ 分开: 回调 (如缓冲池写回页) 需要调用 get().
+   */
+  static std::mutex listeners_mutex_;
+
+  /**
+   * 关闭回调, 以登记时的标识为键
+   */
+  static std::map<std::uint64_t, CloseListener> listeners_;
+
+  /**
+   * 下一个回调的标识
+   */
+  static std::uint64_t next_listener_;
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
@@ -58,9 +190,14 @@ class File :public std::enable_shared_from_this<File> {
   /**
    * 创建一个新文档
    *
+   * @param filename  文件名
+   * @param mode      该文件使用的 I/O 方式
+   * @param layout    文件中页的格式, 默认为行式的插槽页
    * @throws  FileExistsException     如果文件已经存在
    */
-  static sptr create(const std::string& filename);
+  static sptr create(const std::string& filename,
+                     const IoMode mode = IoMode::Buffered,
+                     const PageLayout& layout = PageLayout());
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
@@ -69,9 +206,13 @@ class File :public std::enable_shared_from_this<File> {
 	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
 	 * open_streams_ map.
    *
+   * @param filename  文件名
+   * @param mode      该文件使用的 I/O 方式.  同一个文件可以用任意一种方式打开.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  std::invalid_argument   文件头的标记或格式版本不匹配 (不是 BadgerDB 文件或是之前格式的文件)
    */
-  static sptr open(const std::string& filename);
+  static sptr open(const std::string& filename,
+                   const IoMode mode = IoMode::Buffered);
 
   /**
    * 删除一个已存在的文件.
@@ -105,8 +246,13 @@ class File :public std::enable_shared_from_this<File> {
    */
   File& operator=(const File& rhs) = delete;
 
+  /**
+   * 顺序扫描时一次连续读入的页数.
+   */
+  static constexpr PageId READ_AHEAD_PAGES = 32;
+
 
-  ~File(){opened_files.erase(filename_);stream_.close();}
+  ~File(){FileRegistry::remove(id_);close();}
 
   /**
    * Allocates a new page in the file.
@@ -115,6 +261,18 @@ class File :public std::enable_shared_from_this<File> {
    */
   Page allocatePage();
 
+  /**
+   * 批量装载: 把 count 个已经填好内容的页追加到文件末尾.  所有页用一次连续的
+   * 写入写出, 文件头和使用链表各只改写一次, 而不是每页一次.
+   * 页号依次为调用前的 numPages() 起的连续值, 各页页头中的页号和后继页号
+   * 由本函数填写.  不复用空闲页.
+   *
+   * @param pages   要追加的页 (按 PAGE_IO_ALIGNMENT 对齐时直接 I/O 不需要复制)
+   * @param count   页数
+   * @return  第一页的页号
+   */
+  PageId appendPages(Page* pages, const PageId count);
+
   /**
    * Reads an existing page from the file.
    *
@@ -125,15 +283,60 @@ class File :public std::enable_shared_from_this<File> {
    */
   Page readPage(const PageId page_number) ;
 
+  /**
+   * 将一个已存在的页直接读入调用者提供的 Page 中(例如缓冲池中的帧),
+   * 避免经过临时对象的复制.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          读入的目标页
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPage(const PageId page_number, Page& page);
+
+  /**
+   * 用一次连续的读取读入从 first 开始的 count 个页, 包括空闲页 (isUsed() 为假)
+   * 和文件末尾之后的页 (全部为 0).  不做边界检查.
+   *
+   * @param first   第一页的页号
+   * @param count   页数
+   * @param pages   至少能容纳 count 个页的数组
+   */
+  void readPages(const PageId first, const PageId count, Page* pages);
+
+  /**
+   * 返回文件头中的页数: 文件中所有的页号都小于它.  页数缓存在内存中, 不读磁盘.
+   */
+  PageId numPages() const { return num_pages_.load(std::memory_order_acquire); }
+
+  /**
+   * 返回文件的分配图: 下标为页号, 值为该页是否被使用.
+   * 第一次调用时顺序扫描整个文件建立, 之后由 allocatePage()/deletePage() 维护.
+   * 建立分配图不是线程安全的; 要在多个线程中读取它, 先在一个线程里调用一次.
+   */
+  const std::vector<bool>& allocationMap();
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
    * must have been already allocated in this file by a call to allocatePage().
    *
+   * 页头中的后继页号取自分配图 (使用链表按页号排序), 不读磁盘上的页头;
+   * 分配图还没有建立时使用链表自打开以来没有变过, 页头原样写出.
+   *
    * @see allocatePage()
    * @param new_page  Page to write.
    */
   void writePage(const Page& new_page);
 
+  /**
+   * 把已写入的页落到设备上 (fdatasync), 计入 IoOp::Sync.  writePage() 返回时
+   * 写入只是交给了操作系统, 要在断电后保留它们需要调用这个函数.
+   * 不支持 POSIX I/O 的平台上只冲刷流.
+   *
+   * @throws  std::system_error   如果同步失败
+   */
+  void sync();
+
   /**
    * Deletes a page from the file.
    *
@@ -148,6 +351,28 @@ class File :public std::enable_shared_from_this<File> {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * 返回该文件实际使用的 I/O 方式.
+   * 若请求了 IoMode::Direct 而文件系统不支持, 返回 IoMode::Buffered.
+   */
+  IoMode ioMode() const { return mode_; }
+
+  /**
+   * 返回文件中页的格式 (创建时指定, 记录在文件头中).
+   */
+  const PageLayout& layout() const { return layout_; }
+
+  /**
+   * 返回该文件在 FileRegistry 中的编号, 在文件关闭之前保持不变.
+   */
+  FileId id() const { return id_; }
+
+  /**
+   * 该文件的 I/O 延迟, 字节数和队列深度统计, 可以在运行时查询或清零.
+   */
+  FileIoStats& ioStats() { return io_stats_; }
+  const FileIoStats& ioStats() const { return io_stats_; }
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -168,13 +393,13 @@ class File :public std::enable_shared_from_this<File> {
   
   /**
    * Returns the position of the page with the given number in the file (as an
-   * offset from the beginning of the file).
+   * offset from the beginning of the file).  Block 0 holds the file header.
    *
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  static std::streamoff pagePosition(const PageId page_number) {
+    return static_cast<std::streamoff>(page_number) * Page::SIZE;
   }
 
   /**
@@ -185,34 +410,43 @@ class File :public std::enable_shared_from_this<File> {
    * @see File::create()
    * @see File::open()
    * @param name        Name of file.
+   * @param mode        I/O mode requested for the file.
    * @param create_new  Whether to create a new file.
-   * @throws  FileExistsException     If the underlying file exists and
-   *                                  create_new is true.
-   * @throws  FileNotFoundException   If the underlying file doesn't exist and
-   *                                  create_new is false.
    */
-  File(const std::string& name, std::fstream fs):filename_(name),stream_(std::move(fs)){}
+  File(const std::string& name, const IoMode mode, const bool create_new);
 
   /**
-   * Opens the underlying file named in filename_.
-   * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * Opens the underlying file named in filename_, either as a std::fstream
+   * (IoMode::Buffered) or as a direct I/O file descriptor (IoMode::Direct).
    *
    * @param create_new  Whether to create a new file.
-   * @throws  FileExistsException     If the underlying file exists and
-   *                                  create_new is true.
-   * @throws  FileNotFoundException   If the underlying file doesn't exist and
-   *                                  create_new is false.
    */
   void openIfNeeded(const bool create_new);
 
   /**
-   * Closes the underlying file stream in <stream_>.
-   * This method only closes the file if no other File objects exist that access
-   * the same file.
+   * Closes the underlying file stream in <stream_> (or the descriptor in
+   * <fd_>).
    */
   void close();
 
+  /**
+   * 从文件的 pos 处读取 len 字节到 buf.  读到文件尾之后的部分以 0 填充.
+   * 直接 I/O 模式下 pos, len 和 buf 都必须按 PAGE_IO_ALIGNMENT 对齐.
+   * 用时计入 io_stats_ 中 op 类操作.
+   *
+   * @throws std::system_error, std::runtime_error 读取出错时
+   */
+  void readAt(const std::streamoff pos, char* buf, const std::size_t len, const IoOp op);
+
+  /**
+   * 将 buf 中的 len 字节写到文件的 pos 处.
+   * 直接 I/O 模式下 pos, len 和 buf 都必须按 PAGE_IO_ALIGNMENT 对齐.
+   * 用时计入 io_stats_ 中 op 类操作.
+   *
+   * @throws std::system_error, std::runtime_error 写入出错或没有写完时
+   */
+  void writeAt(const std::streamoff pos, const char* buf, const std::size_t len, const IoOp op);
+
   /**
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
@@ -255,8 +489,35 @@ class File :public std::enable_shared_from_this<File> {
    */
   FileHeader readHeader();
 
+
+  /**
+   * 借助分配图找到页号小于 page_number 的最后一个被使用的页,
+   * 即该页在按页号排序的使用链表中的前驱.
+   *
+   * @param page_number 页号
+   * @return 前驱的页号, 没有前驱时为 Page::INVALID_NUMBER
+   */
+  PageId previousUsedPage(const PageId page_number);
+
+  /**
+   * previousUsedPage() 的反方向: 页号大于 page_number 的第一个被使用的页,
+   * 即它在使用链表中的后继.  分配图须已建立.
+   *
+   * @return 后继的页号, 没有后继时为 Page::INVALID_NUMBER
+   */
+  PageId nextUsedPage(const PageId page_number) const;
+
   /**
-   * 写入文件头
+   * 只改写磁盘上某页页头中的 next_page_number, 只读写该页的第一个对齐块.
+   *
+   * @param page_number       页号
+   * @param next_page_number  新的后继页号
+   */
+  void writeNextPageNumber(const PageId page_number,
+                           const PageId next_page_number);
+
+  /**
+   * 写入文件头, 并更新缓存的页数
    */
   void writeHeader(const FileHeader& header);
 
@@ -269,23 +530,69 @@ class File :public std::enable_shared_from_this<File> {
    */
   PageHeader readPageHeader(const PageId page_number) ;
 
-  using CountMap =  std::set<std::string>;
+  /**
+   * Name of the file this object represents.
+   */
+  std::string filename_;
+
+  /**
+   * 该文件在 FileRegistry 中的编号
+   */
+  FileId id_;
 
   /**
-   * Counts for opened files.
+   * I/O mode actually in use for this file.
    */
-  static CountMap opened_files;
+  IoMode mode_;
 
   /**
-   * Name of the file this object represents.
+   * 文件中页的格式, 打开时从文件头读出
    */
-  std::string filename_;
+  PageLayout layout_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Stream for underlying filesystem object (IoMode::Buffered).
    */
   std::fstream stream_;
 
+  /**
+   * Direct I/O file descriptor (IoMode::Direct), -1 if unused.
+   */
+  int fd_ = -1;
+
+  /**
+   * IoMode::Buffered 下供 sync() 使用的只读描述符, 打开文件时一起打开, 以便
+   * 收到之后的写回错误 (std::fstream 不公开它的描述符).  -1 如果不使用.
+   */
+  int sync_fd_ = -1;
+
+  /**
+   * I/O 统计
+   */
+  FileIoStats io_stats_;
+
+  /**
+   * 保护 stream_ 的读写位置, 使多个线程可以同时读写同一个文件的不同页.
+   * 直接 I/O 使用 pread/pwrite, 不需要它.
+   */
+  std::mutex stream_mutex_;
+
+  /**
+   * 分配图, 见 allocationMap().  只对通过本对象进行的分配和删除保持最新,
+   * 因此同一个磁盘文件同时只应有一个 File 对象在分配或删除页.
+   */
+  std::vector<bool> allocation_map_;
+
+  /**
+   * 分配图是否已经建立.  写回页时 (可能在另一个线程中) 据此决定是否读分配图
+   */
+  std::atomic<bool> allocation_map_loaded_{false};
+
+  /**
+   * 文件头中的页数, 见 numPages().  打开时读出, 由 writeHeader() 维护
+   */
+  std::atomic<PageId> num_pages_{0};
+
   friend class FileIterator;
   friend class FileTest;
 };
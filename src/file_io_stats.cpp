@@ -0,0 +1,36 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_io_stats.h"
+
+namespace badgerdb {
+
+const char* ioOpName(const IoOp op) {
+  switch (op) {
+    case IoOp::Read:
+      return "read";
+    case IoOp::Write:
+      return "write";
+    case IoOp::HeaderRead:
+      return "header_read";
+    case IoOp::HeaderWrite:
+      return "header_write";
+    case IoOp::Sync:
+      return "sync";
+  }
+  return "unknown";
+}
+
+void FileIoStats::clear() {
+  for (unsigned i = 0; i < NUM_IO_OPS; ++i) {
+    latency_[i].clear();
+    bytes_[i].store(0, std::memory_order_relaxed);
+  }
+  queue_depth_.clear();
+}
+
+}
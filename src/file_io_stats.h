@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "hdr_histogram.h"
+
+namespace badgerdb {
+
+/**
+ * @brief File 的一类 I/O 操作
+ */
+enum class IoOp : unsigned {
+  Read,         ///< 读页 (readPage, readPages)
+  Write,        ///< 写页 (writePage, appendPages; IoMode::Buffered 下包括写之后的 flush)
+  HeaderRead,   ///< 读文件头或页头所在的块
+  HeaderWrite,  ///< 写文件头或页头所在的块
+  Sync,         ///< 把写入落到设备上 (File::sync 中的 fdatasync)
+};
+
+constexpr unsigned NUM_IO_OPS = 5;
+
+/**
+ * 操作的名字, 如 "read"
+ */
+const char* ioOpName(const IoOp op);
+
+/**
+ * @brief 一个 File 的 I/O 统计: 每类操作的延迟直方图 (纳秒) 和传输的字节数,
+ * 以及操作开始时该文件上进行中的操作数 (队列深度) 的直方图.
+ *
+ * 用来区分设备的延迟和缓冲池本身的开销: 例如 BufStats 中的一次缺失
+ * 对应这里的一次 Read.  多个线程可以同时记录和查询.
+ */
+class FileIoStats {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  FileIoStats() = default;
+  FileIoStats(const FileIoStats&) = delete;
+  FileIoStats& operator=(const FileIoStats&) = delete;
+
+  /**
+   * op 类操作的延迟, 单位为纳秒
+   */
+  const HdrHistogram& latency(const IoOp op) const { return latency_[index(op)]; }
+
+  /**
+   * op 类操作传输的字节数
+   */
+  std::uint64_t bytes(const IoOp op) const {
+    return bytes_[index(op)].load(std::memory_order_relaxed);
+  }
+
+  /**
+   * 每次读写开始时该文件上进行中的读写数 (包括它自己)
+   */
+  const HdrHistogram& queueDepth() const { return queue_depth_; }
+
+  /**
+   * 记录一次用时 ns 纳秒, 传输 bytes 字节的操作 (不计入队列深度)
+   */
+  void record(const IoOp op, const std::uint64_t ns, const std::uint64_t bytes) {
+    latency_[index(op)].record(ns);
+    bytes_[index(op)].fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  void clear();
+
+  /**
+   * @brief 为一次读写计时: 构造时开始并计入队列深度, 析构时记录
+   */
+  class Timer {
+   public:
+    Timer(FileIoStats& stats, const IoOp op, const std::uint64_t bytes)
+        : stats_(stats), op_(op), bytes_(bytes) {
+      stats_.queue_depth_.record(stats_.in_flight_.fetch_add(1, std::memory_order_relaxed) + 1);
+      start_ = Clock::now();
+    }
+
+    ~Timer() {
+      const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_);
+      stats_.in_flight_.fetch_sub(1, std::memory_order_relaxed);
+      stats_.record(op_, static_cast<std::uint64_t>(ns.count()), bytes_);
+    }
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+   private:
+    FileIoStats& stats_;
+    const IoOp op_;
+    const std::uint64_t bytes_;
+    Clock::time_point start_;
+  };
+
+ private:
+  static unsigned index(const IoOp op) { return static_cast<unsigned>(op); }
+
+  HdrHistogram latency_[NUM_IO_OPS];
+  std::atomic<std::uint64_t> bytes_[NUM_IO_OPS] = {};
+  HdrHistogram queue_depth_;
+  std::atomic<std::uint32_t> in_flight_{0};
+};
+
+}
@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
+#include <vector>
 #include "file.h"
 #include "page.h"
 #include "types.h"
@@ -18,7 +21,12 @@ namespace badgerdb {
  * @brief Iterator for iterating over the pages in a file.
  *
  * This class provides a forward-only iterator for iterating over all of the
- * pages in a file.
+ * used pages in a file, in physical (page number) order.
+ *
+ * 迭代器不再沿着页头里的 next_page_number 链表逐页读取, 而是每次从磁盘连续读入
+ * File::READ_AHEAD_PAGES 个页, 在内存中跳过空闲页.  文件的分配图已经载入时,
+ * 整段的空闲页不会被读取.  解引用直接返回预读缓冲区中的页, 不会再读一次磁盘,
+ * 所以整个文件的扫描是一条顺序的读流.
  */
 class FileIterator {
  public:
@@ -27,7 +35,9 @@ class FileIterator {
    */
   FileIterator()
       : file_(NULL),
-        current_page_number_(Page::INVALID_NUMBER) {
+        current_page_number_(Page::INVALID_NUMBER),
+        end_page_number_(Page::INVALID_NUMBER),
+        chunk_first_(Page::INVALID_NUMBER) {
   }
 
   /**
@@ -37,10 +47,7 @@ class FileIterator {
    * @param file  File to iterate over.
    */
   FileIterator(File* file)
-      : file_(file) {
-    assert(file_ != NULL);
-    const FileHeader& header = file_->readHeader();
-    current_page_number_ = header.first_used_page;
+      : FileIterator(file, file->readHeader().first_used_page) {
   }
 
   /**
@@ -52,7 +59,14 @@ class FileIterator {
    */
   FileIterator(File* file, PageId page_number)
       : file_(file),
-        current_page_number_(page_number) {
+        current_page_number_(page_number),
+        end_page_number_(Page::INVALID_NUMBER),
+        chunk_first_(Page::INVALID_NUMBER) {
+    assert(file_ != NULL);
+    if (current_page_number_ != Page::INVALID_NUMBER) {
+      end_page_number_ = file_->readHeader().num_pages;
+      seek(current_page_number_);
+    }
   }
 
   /**
@@ -60,8 +74,7 @@ class FileIterator {
    */
 	inline FileIterator& operator++() {
     assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    seek(current_page_number_ + 1);
 
 		return *this;
 	}
@@ -72,8 +85,7 @@ class FileIterator {
 		FileIterator tmp = *this;   // copy ourselves
 
     assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    seek(current_page_number_ + 1);
 
 		return tmp;
 	}
@@ -85,25 +97,70 @@ class FileIterator {
    * @return    True if other iterator is equal to this one.
    */
 	inline bool operator==(const FileIterator& rhs) const {
-    return file_->filename() == rhs.file_->filename() &&
+    return file_ == rhs.file_ &&
         current_page_number_ == rhs.current_page_number_;
   }
 
 	inline bool operator!=(const FileIterator& rhs) const {
-    return (file_->filename() != rhs.file_->filename()) ||
-        (current_page_number_ != rhs.current_page_number_);
+    return !(*this == rhs);
   }
 
   /**
-   * Dereferences the iterator, returning a copy of the current page in the
-   * file.
+   * Dereferences the iterator, returning the current page in the file.
+   * 返回的是预读缓冲区中的页, 在迭代器前进之后可能失效; 需要保留请复制.
    *
    * @return  Page in file.
    */
-	inline Page operator*() const
-  { return file_->readPage(current_page_number_); }
+	inline Page& operator*() const
+  { return (*chunk_)[current_page_number_ - chunk_first_]; }
+
+	inline Page* operator->() const
+  { return &**this; }
 
  private:
+  /**
+   * 移动到页号不小于 page_number 的第一个被使用的页, 没有则移动到末尾.
+   * 需要时从磁盘连续读入下一段页.
+   *
+   * @param page_number 开始查找的页号
+   */
+  void seek(PageId page_number) {
+    const std::vector<bool>* used =
+        file_->allocation_map_loaded_ ? &file_->allocation_map_ : nullptr;
+    for (; page_number < end_page_number_; ++page_number) {
+      if (used != nullptr && !(page_number < used->size() && (*used)[page_number])) {
+        continue;
+      }
+      if (!chunk_ || page_number < chunk_first_ ||
+          page_number >= chunk_first_ + chunk_->size()) {
+        load(page_number);
+      }
+      if ((*chunk_)[page_number - chunk_first_].page_number() !=
+          Page::INVALID_NUMBER) {
+        current_page_number_ = page_number;
+        return;
+      }
+    }
+    current_page_number_ = Page::INVALID_NUMBER;
+  }
+
+  /**
+   * 从 first 开始一次连续读入至多 File::READ_AHEAD_PAGES 个页.
+   *
+   * @param first 第一页的页号
+   */
+  void load(const PageId first) {
+    const PageId count =
+        std::min<PageId>(File::READ_AHEAD_PAGES, end_page_number_ - first);
+    if (!chunk_ || chunk_.use_count() > 1) {
+      // 迭代器的副本共享缓冲区, 不能覆盖别人正在看的页.
+      chunk_ = std::make_shared<std::vector<Page>>(File::READ_AHEAD_PAGES);
+    }
+    chunk_->resize(count);
+    file_->readPages(first, count, chunk_->data());
+    chunk_first_ = first;
+  }
+
   /**
    * File we're iterating over.
    */
@@ -113,6 +170,21 @@ class FileIterator {
    * Number of page in file iterator is currently pointing to.
    */
   PageId current_page_number_;
+
+  /**
+   * 迭代开始时文件的页数, 页号不小于它的页不会被访问.
+   */
+  PageId end_page_number_;
+
+  /**
+   * 预读缓冲区, 迭代器的副本之间共享.
+   */
+  std::shared_ptr<std::vector<Page>> chunk_;
+
+  /**
+   * 预读缓冲区中第一个页的页号.
+   */
+  PageId chunk_first_;
 };
 
 }
@@ -0,0 +1,365 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "filter_scan.h"
+
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BADGERDB_HAVE_AVX2 1
+// 只为这些函数生成 AVX2 指令, 是否调用它们在运行时决定
+#define BADGERDB_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * 一页最多的插槽数 (每条记录至少占一个插槽)
+ */
+constexpr std::size_t MAX_SLOTS = Page::DATA_SIZE / sizeof(PageSlot);
+
+/**
+ * 一页中的候选记录, 按插槽号顺序.  三个数组平行, 过滤时一起就地压缩.
+ * offset 和 length 用 32 位整数, 以便直接作为 gather 的下标.
+ */
+struct Candidates {
+  std::size_t size;
+  alignas(32) std::int32_t offset[MAX_SLOTS];
+  alignas(32) std::int32_t length[MAX_SLOTS];
+  SlotId slot[MAX_SLOTS];
+
+  /**
+   * 把第 from 个候选留作第 to 个 (to <= from)
+   */
+  void keep(const std::size_t to, const std::size_t from) {
+    offset[to] = offset[from];
+    length[to] = length[from];
+    slot[to] = slot[from];
+  }
+
+  /**
+   * 留下 [base, base + 位数) 中 bits 的对应位为 1 的候选
+   */
+  void keepMasked(std::size_t& out, const std::size_t base, unsigned bits) {
+    while (bits != 0) {
+      keep(out++, base + std::countr_zero(bits));
+      bits &= bits - 1;
+    }
+  }
+};
+
+template<typename T>
+bool compare(const T lhs, const CompareOp op, const T rhs) {
+  switch (op) {
+    case CompareOp::EQ: return lhs == rhs;
+    case CompareOp::NE: return lhs != rhs;
+    case CompareOp::LT: return lhs < rhs;
+    case CompareOp::LE: return lhs <= rhs;
+    case CompareOp::GT: return lhs > rhs;
+    case CompareOp::GE: return lhs >= rhs;
+  }
+  return false;
+}
+
+/**
+ * 从第 begin 个候选起逐个求值整数谓词, 留下的候选写到 out 处
+ */
+template<typename T>
+void filterIntScalar(const char* data, Candidates& c, const IntPredicate& predicate,
+                     std::size_t begin, std::size_t& out) {
+  const std::int32_t min_length = predicate.offset + predicate.width;
+  const T value = static_cast<T>(predicate.value);
+  for (std::size_t i = begin; i < c.size; ++i) {
+    if (c.length[i] < min_length) {
+      continue;
+    }
+    T field;
+    std::memcpy(&field, data + c.offset[i] + predicate.offset, sizeof(T));
+    if (compare(field, predicate.op, value)) {
+      c.keep(out++, i);
+    }
+  }
+}
+
+#ifdef BADGERDB_HAVE_AVX2
+
+bool cpuHasAvx2() {
+  return __builtin_cpu_supports("avx2");
+}
+
+/**
+ * AVX2 只有 == 和有符号 >: 其他运算由交换操作数和对结果取反得到.
+ * 返回比较用的两个操作数中字段值是否在右边, 以及是否需要取反.
+ */
+struct VectorCompare {
+  bool swap;
+  bool negate;
+  bool equal;
+};
+
+constexpr VectorCompare vectorCompare(const CompareOp op) {
+  switch (op) {
+    case CompareOp::EQ: return {false, false, true};
+    case CompareOp::NE: return {false, true, true};
+    case CompareOp::GT: return {false, false, false};
+    case CompareOp::LE: return {false, true, false};
+    case CompareOp::LT: return {true, false, false};
+    case CompareOp::GE: return {true, true, false};
+  }
+  return {false, false, true};
+}
+
+/**
+ * 32 位字段: 每次 8 个候选.  返回第一个没有处理的候选.
+ */
+BADGERDB_AVX2 std::size_t filterInt32Avx2(const char* data, Candidates& c,
+                                          const IntPredicate& predicate, std::size_t& out) {
+  const VectorCompare how = vectorCompare(predicate.op);
+  const __m256i field_offset = _mm256_set1_epi32(predicate.offset);
+  const __m256i too_short = _mm256_set1_epi32(predicate.offset + predicate.width - 1);
+  const __m256i value = _mm256_set1_epi32(static_cast<std::int32_t>(predicate.value));
+  const int* base = reinterpret_cast<const int*>(data);
+  std::size_t i = 0;
+  for (; i + 8 <= c.size; i += 8) {
+    const __m256i length = _mm256_load_si256(reinterpret_cast<const __m256i*>(c.length + i));
+    const __m256i offset = _mm256_load_si256(reinterpret_cast<const __m256i*>(c.offset + i));
+    // 太短的记录不读取: 掩码为 0 的通道 gather 不访问内存
+    const __m256i fits = _mm256_cmpgt_epi32(length, too_short);
+    const __m256i field = _mm256_mask_i32gather_epi32(
+        _mm256_setzero_si256(), base, _mm256_add_epi32(offset, field_offset), fits, 1);
+    const __m256i lhs = how.swap ? value : field;
+    const __m256i rhs = how.swap ? field : value;
+    const __m256i result = how.equal ? _mm256_cmpeq_epi32(lhs, rhs) : _mm256_cmpgt_epi32(lhs, rhs);
+    unsigned bits = _mm256_movemask_ps(_mm256_castsi256_ps(result));
+    if (how.negate) {
+      bits = ~bits & 0xFFu;
+    }
+    c.keepMasked(out, i, bits & _mm256_movemask_ps(_mm256_castsi256_ps(fits)));
+  }
+  return i;
+}
+
+/**
+ * 64 位字段: 每次 4 个候选.  返回第一个没有处理的候选.
+ */
+BADGERDB_AVX2 std::size_t filterInt64Avx2(const char* data, Candidates& c,
+                                          const IntPredicate& predicate, std::size_t& out) {
+  const VectorCompare how = vectorCompare(predicate.op);
+  const __m128i field_offset = _mm_set1_epi32(predicate.offset);
+  const __m128i too_short = _mm_set1_epi32(predicate.offset + predicate.width - 1);
+  const __m256i value = _mm256_set1_epi64x(predicate.value);
+  const long long* base = reinterpret_cast<const long long*>(data);
+  std::size_t i = 0;
+  for (; i + 4 <= c.size; i += 4) {
+    const __m128i length = _mm_load_si128(reinterpret_cast<const __m128i*>(c.length + i));
+    const __m128i offset = _mm_load_si128(reinterpret_cast<const __m128i*>(c.offset + i));
+    const __m128i fits = _mm_cmpgt_epi32(length, too_short);
+    const __m256i field = _mm256_mask_i32gather_epi64(
+        _mm256_setzero_si256(), base, _mm_add_epi32(offset, field_offset),
+        _mm256_cvtepi32_epi64(fits), 1);
+    const __m256i lhs = how.swap ? value : field;
+    const __m256i rhs = how.swap ? field : value;
+    const __m256i result = how.equal ? _mm256_cmpeq_epi64(lhs, rhs) : _mm256_cmpgt_epi64(lhs, rhs);
+    unsigned bits = _mm256_movemask_pd(_mm256_castsi256_pd(result));
+    if (how.negate) {
+      bits = ~bits & 0xFu;
+    }
+    c.keepMasked(out, i, bits & _mm_movemask_ps(_mm_castsi128_ps(fits)));
+  }
+  return i;
+}
+
+/**
+ * 子串查找: 比较 pattern 的首字节与末字节, 每次检查 32 个起始位置,
+ * 两者都相同的位置再比较中间的字节.
+ */
+BADGERDB_AVX2 bool containsAvx2(const std::string_view text, const std::string_view pattern) {
+  const std::size_t k = pattern.size();
+  if (k <= 1) {
+    return k == 0 || std::memchr(text.data(), pattern[0], text.size()) != nullptr;
+  }
+  const char* s = text.data();
+  const std::size_t n = text.size();
+  const __m256i first = _mm256_set1_epi8(pattern.front());
+  const __m256i last = _mm256_set1_epi8(pattern.back());
+  std::size_t i = 0;
+  for (; i + k - 1 + 32 <= n; i += 32) {
+    const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+    const __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + k - 1));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last))));
+    while (mask != 0) {
+      if (std::memcmp(s + i + std::countr_zero(mask) + 1, pattern.data() + 1, k - 2) == 0) {
+        return true;
+      }
+      mask &= mask - 1;
+    }
+  }
+  return text.substr(i).find(pattern) != std::string_view::npos;
+}
+
+#else
+
+bool cpuHasAvx2() {
+  return false;
+}
+
+#endif
+
+void filterInt(const char* data, Candidates& c, const IntPredicate& predicate, const bool simd) {
+  std::size_t out = 0;
+  std::size_t begin = 0;
+#ifdef BADGERDB_HAVE_AVX2
+  if (simd) {
+    begin = predicate.width == 4 ? filterInt32Avx2(data, c, predicate, out)
+                                 : filterInt64Avx2(data, c, predicate, out);
+  }
+#endif
+  if (predicate.width == 4) {
+    filterIntScalar<std::int32_t>(data, c, predicate, begin, out);
+  } else {
+    filterIntScalar<std::int64_t>(data, c, predicate, begin, out);
+  }
+  c.size = out;
+}
+
+bool contains(const std::string_view text, const std::string_view pattern, const bool simd) {
+#ifdef BADGERDB_HAVE_AVX2
+  if (simd) {
+    return containsAvx2(text, pattern);
+  }
+#endif
+  return text.find(pattern) != std::string_view::npos;
+}
+
+void filterBytes(const char* data, Candidates& c, const BytesPredicate& predicate,
+                 const bool simd) {
+  const std::string_view pattern = predicate.pattern;
+  std::size_t out = 0;
+  for (std::size_t i = 0; i < c.size; ++i) {
+    if (c.length[i] < predicate.offset) {
+      continue;
+    }
+    const std::string_view field(data + c.offset[i] + predicate.offset,
+                                 c.length[i] - predicate.offset);
+    bool match = false;
+    switch (predicate.kind) {
+      case MatchKind::EQUALS: match = field == pattern; break;
+      case MatchKind::PREFIX: match = field.starts_with(pattern); break;
+      case MatchKind::CONTAINS: match = contains(field, pattern, simd); break;
+    }
+    if (match) {
+      c.keep(out++, i);
+    }
+  }
+  c.size = out;
+}
+
+}
+
+PredicateFilter::PredicateFilter(const bool allow_simd)
+    : simd_(allow_simd && cpuHasAvx2()) {}
+
+PredicateFilter& PredicateFilter::where(const IntPredicate& predicate) {
+  if (predicate.width != 4 && predicate.width != 8) {
+    throw std::invalid_argument("integer field width must be 4 or 8 bytes");
+  }
+  if (predicate.width == 4 &&
+      (predicate.value < std::numeric_limits<std::int32_t>::min() ||
+       predicate.value > std::numeric_limits<std::int32_t>::max())) {
+    throw std::invalid_argument("constant does not fit in a 4-byte field");
+  }
+  ints_.push_back(predicate);
+  return *this;
+}
+
+PredicateFilter& PredicateFilter::where(const BytesPredicate& predicate) {
+  bytes_.push_back(predicate);
+  return *this;
+}
+
+void PredicateFilter::evaluate(const Page& page, std::vector<RecordId>& selection) const {
+  if (page.page_number() == Page::INVALID_NUMBER) {
+    return;
+  }
+  Candidates c;
+  c.size = 0;
+  for (SlotId s = 1; s <= page.header_.num_slots; ++s) {
+    const PageSlot& slot = page.getSlot(s);
+    if (slot.used) {
+      c.offset[c.size] = slot.item_offset;
+      c.length[c.size] = slot.item_length;
+      c.slot[c.size] = s;
+      ++c.size;
+    }
+  }
+
+  const char* data = page.data_.data();
+  for (const IntPredicate& predicate : ints_) {
+    if (c.size == 0) {
+      return;
+    }
+    filterInt(data, c, predicate, simd_);
+  }
+  for (const BytesPredicate& predicate : bytes_) {
+    if (c.size == 0) {
+      return;
+    }
+    filterBytes(data, c, predicate, simd_);
+  }
+  for (std::size_t i = 0; i < c.size; ++i) {
+    selection.push_back({page.page_number(), c.slot[i]});
+  }
+}
+
+std::vector<RecordId> FilterScan::run() {
+  std::vector<RecordId> selection;
+  AccessRing ring(strategy_);
+  scan(file_.allocationMap(), 1, file_.numPages(), ring, selection);
+  return selection;
+}
+
+std::vector<RecordId> FilterScan::run(ThreadPool& pool, const PageId morsel_pages) {
+  const std::vector<bool>& used = file_.allocationMap();
+  const std::vector<Morsel> work = ParallelScan(file_, mgr_, pool, morsel_pages).morsels();
+  std::vector<std::vector<RecordId>> parts(work.size());
+  std::vector<AccessRing> rings(pool.size(), AccessRing(strategy_));
+  pool.parallelFor(work.size(), [&](unsigned worker, std::size_t task) {
+    scan(used, work[task].first, work[task].last, rings[worker], parts[task]);
+  });
+
+  std::size_t total = 0;
+  for (const std::vector<RecordId>& part : parts) {
+    total += part.size();
+  }
+  std::vector<RecordId> selection;
+  selection.reserve(total);
+  for (const std::vector<RecordId>& part : parts) {
+    selection.insert(selection.end(), part.begin(), part.end());
+  }
+  return selection;
+}
+
+void FilterScan::scan(const std::vector<bool>& used, const PageId first, const PageId last,
+                      AccessRing& ring, std::vector<RecordId>& selection) {
+  for (PageId page_number = first; page_number < last; ++page_number) {
+    if (page_number >= used.size() || !used[page_number]) {
+      continue;
+    }
+    PageView view = mgr_.readPage(file_, page_number, ring);
+    filter_.evaluate(*view, selection);
+  }
+}
+
+}
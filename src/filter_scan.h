@@ -0,0 +1,158 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "parallel_scan.h"
+#include "thread_pool.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 比较运算: 字段值 (左) 与常量 (右) 比较
+ */
+enum class CompareOp { EQ, NE, LT, LE, GT, GE };
+
+/**
+ * @brief 定长整数字段上的谓词.
+ *
+ * 字段是记录中从 offset 起 width (4 或 8) 个字节, 按本机字节序解释为有符号整数.
+ * 记录比 offset + width 短时不满足谓词.
+ */
+struct IntPredicate {
+  std::uint16_t offset;
+  std::uint8_t width;
+  CompareOp op;
+  std::int64_t value;
+};
+
+/**
+ * @brief 变长字段的匹配方式
+ */
+enum class MatchKind {
+  EQUALS,    ///< 字段等于 pattern
+  PREFIX,    ///< 字段以 pattern 开头
+  CONTAINS,  ///< 字段包含 pattern
+};
+
+/**
+ * @brief 变长字段上的谓词.
+ *
+ * 字段是记录中从 offset 起直到记录末尾的字节.  记录比 offset 短时不满足谓词.
+ */
+struct BytesPredicate {
+  std::uint16_t offset;
+  MatchKind kind;
+  std::string pattern;
+};
+
+/**
+ * @brief 若干谓词的合取, 直接在页内对整页的记录成批求值.
+ *
+ * 求值不复制记录: 先从插槽数组取出页中所有记录的位置, 再对每个谓词依次过滤这批
+ * 候选记录.  整数谓词在支持 AVX2 的 CPU 上一次用 gather 指令从页中取 8 个 (或 4 个)
+ * 字段值并行比较; 否则用等价的标量实现.  CONTAINS 在支持 AVX2 时先用 SIMD 比较
+ * pattern 的首尾字节筛出候选位置, 再逐个确认.  AVX2 在运行时检测,
+ * 不需要特别的编译选项.
+ *
+ * 整数谓词先于变长字段的谓词求值.  求值期间页不能被修改.
+ */
+class PredicateFilter {
+ public:
+  /**
+   * @param allow_simd  为 false 时总是使用标量实现 (用于对比和测试)
+   */
+  explicit PredicateFilter(const bool allow_simd = true);
+
+  /**
+   * 加入一个整数谓词
+   *
+   * @throws std::invalid_argument width 不是 4 或 8, 或 width 为 4 而 value 超出 32 位整数的范围时
+   */
+  PredicateFilter& where(const IntPredicate& predicate);
+
+  /**
+   * 加入一个变长字段的谓词
+   */
+  PredicateFilter& where(const BytesPredicate& predicate);
+
+  /**
+   * 对页中的所有记录求值, 把满足全部谓词的记录号按插槽号顺序追加到 selection.
+   * 空闲页 (页号为 Page::INVALID_NUMBER) 没有记录.
+   */
+  void evaluate(const Page& page, std::vector<RecordId>& selection) const;
+
+  /**
+   * 求值是否使用 AVX2
+   */
+  bool simd() const { return simd_; }
+
+ private:
+  bool simd_;
+  std::vector<IntPredicate> ints_;
+  std::vector<BytesPredicate> bytes_;
+};
+
+/**
+ * @brief 带过滤的扫描: 通过 BufMgr 引用文件中的每一页, 在页内用 PredicateFilter
+ * 求值, 返回满足条件的记录号 (选择向量), 按页号和插槽号排序.
+ *
+ * 与 ParallelScan 一样借助分配图跳过空闲页; 扫描期间不能有其他线程修改该文件.
+ * 只适用于带插槽的页: PAX 格式的页 (见 PaxPage) 没有插槽目录.
+ */
+class FilterScan {
+ public:
+  /**
+   * @param file    要扫描的文件
+   * @param mgr     通过它引用页的缓冲池
+   * @param filter  过滤条件, 扫描期间须保持有效
+   * @param strategy 读页的方式, 默认只用每个线程私有的一小圈帧 (见 AccessRing)
+   * @throws std::invalid_argument 文件的页是 PAX 格式时
+   */
+  FilterScan(File& file, BufMgr& mgr, const PredicateFilter& filter,
+             const AccessStrategy strategy = AccessStrategy::Sequential)
+      : file_(file), mgr_(mgr), filter_(filter), strategy_(strategy) {
+    if (file.layout().format == PageFormat::Pax) {
+      throw std::invalid_argument("FilterScan does not support PAX pages: " + file.filename());
+    }
+  }
+
+  /**
+   * 在调用者的线程中扫描整个文件
+   */
+  std::vector<RecordId> run();
+
+  /**
+   * 用线程池并行扫描, 页号范围按 morsel 切分 (见 ParallelScan).
+   * 结果与单线程扫描相同.
+   */
+  std::vector<RecordId> run(ThreadPool& pool,
+                            const PageId morsel_pages = ParallelScan::DEFAULT_MORSEL_PAGES);
+
+ private:
+  /**
+   * 扫描页号 [first, last) 中已分配的页
+   */
+  void scan(const std::vector<bool>& used, const PageId first, const PageId last,
+            AccessRing& ring, std::vector<RecordId>& selection);
+
+  File& file_;
+  BufMgr& mgr_;
+  const PredicateFilter& filter_;
+  const AccessStrategy strategy_;
+};
+
+}
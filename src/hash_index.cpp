@@ -0,0 +1,309 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "hash_index.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <mutex>
+#include <stdexcept>
+
+namespace badgerdb {
+
+namespace {
+
+using Key = HashIndex::Key;
+
+/**
+ * 每个目录页的目录项数 (取 2 的幂, 目录项的下标可以直接拆成页号和页内位置)
+ */
+constexpr std::uint32_t DIR_ENTRIES_PER_PAGE =
+    static_cast<std::uint32_t>(std::bit_floor(Page::DATA_SIZE / sizeof(PageId)));
+
+/**
+ * 元数据页最多记录的目录页数
+ */
+constexpr std::uint32_t MAX_DIR_PAGES = static_cast<std::uint32_t>(
+    std::bit_floor((Page::DATA_SIZE - 3 * sizeof(std::uint32_t)) / sizeof(PageId)));
+
+/**
+ * 全局深度的上限, 受元数据页能记录的目录页数限制
+ */
+constexpr std::uint32_t MAX_GLOBAL_DEPTH =
+    std::bit_width(MAX_DIR_PAGES * DIR_ENTRIES_PER_PAGE) - 1;
+
+constexpr std::uint32_t INDEX_MAGIC = 0x48534958;  // "HSIX"
+
+/**
+ * 元数据页的内容
+ */
+struct IndexMeta {
+  std::uint32_t magic;
+  std::uint32_t global_depth;
+  std::uint32_t num_dir_pages;
+  PageId dir_pages[MAX_DIR_PAGES];
+};
+
+/**
+ * 目录页的内容
+ */
+struct DirectoryPage {
+  PageId buckets[DIR_ENTRIES_PER_PAGE];
+};
+
+struct BucketEntry {
+  Key key;
+  RecordId rid;
+};
+
+constexpr std::uint32_t BUCKET_CAPACITY = static_cast<std::uint32_t>(
+    (Page::DATA_SIZE - 2 * sizeof(std::uint32_t)) / sizeof(BucketEntry));
+
+/**
+ * 桶页的内容: 桶中的键的散列值的低 local_depth 位都相同
+ */
+struct BucketPage {
+  std::uint32_t local_depth;
+  std::uint32_t num_entries;
+  BucketEntry entries[BUCKET_CAPACITY];
+};
+
+static_assert(sizeof(IndexMeta) <= Page::DATA_SIZE);
+static_assert(sizeof(DirectoryPage) <= Page::DATA_SIZE);
+static_assert(sizeof(BucketPage) <= Page::DATA_SIZE);
+
+IndexMeta* asMeta(Page& page) { return reinterpret_cast<IndexMeta*>(page.rawData()); }
+const IndexMeta* asMeta(const Page& page) { return reinterpret_cast<const IndexMeta*>(page.rawData()); }
+DirectoryPage* asDirectory(Page& page) { return reinterpret_cast<DirectoryPage*>(page.rawData()); }
+const DirectoryPage* asDirectory(const Page& page) { return reinterpret_cast<const DirectoryPage*>(page.rawData()); }
+BucketPage* asBucket(Page& page) { return reinterpret_cast<BucketPage*>(page.rawData()); }
+const BucketPage* asBucket(const Page& page) { return reinterpret_cast<const BucketPage*>(page.rawData()); }
+
+/**
+ * 键的散列值.  目录用它的低位, 所以低位必须混合了键的所有位.
+ */
+std::uint64_t hashKey(const Key key) {
+  std::uint64_t x = static_cast<std::uint64_t>(key);
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+/**
+ * 键在桶中的位置, 不存在时为 -1
+ */
+int findEntry(const BucketPage* bucket, const Key key) {
+  for (std::uint32_t i = 0; i < bucket->num_entries; ++i) {
+    if (bucket->entries[i].key == key) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+/**
+ * 把键加到桶的末尾, 调用者须确认桶中还有空位
+ */
+void appendEntry(BucketPage* bucket, const Key key, const RecordId& rid) {
+  bucket->entries[bucket->num_entries++] = {key, rid};
+}
+
+}
+
+HashIndex::HashIndex(File& file, BufMgr& mgr)
+    : file_(file), mgr_(mgr) {
+  if (file_.numPages() <= META_PAGE) {
+    PageId meta_page;
+    PageId dir_page;
+    PageId bucket_page;
+    MutablePageView meta = mgr_.allocPage(file_, meta_page);
+    MutablePageView dir = mgr_.allocPage(file_, dir_page);
+    MutablePageView bucket = mgr_.allocPage(file_, bucket_page);
+    assert(meta_page == META_PAGE);
+    asBucket(*bucket)->local_depth = 0;
+    asBucket(*bucket)->num_entries = 0;
+    asDirectory(*dir)->buckets[0] = bucket_page;
+    global_depth_ = 0;
+    dir_pages_.push_back(dir_page);
+    IndexMeta* content = asMeta(*meta);
+    content->magic = INDEX_MAGIC;
+    content->global_depth = global_depth_;
+    content->num_dir_pages = 1;
+    content->dir_pages[0] = dir_page;
+    return;
+  }
+  PageView meta = mgr_.readPage(file_, META_PAGE);
+  const IndexMeta* content = asMeta(*meta);
+  if (content->magic != INDEX_MAGIC) {
+    throw std::invalid_argument("not a hash index file: " + file_.filename());
+  }
+  global_depth_ = content->global_depth;
+  dir_pages_.assign(content->dir_pages, content->dir_pages + content->num_dir_pages);
+}
+
+std::uint32_t HashIndex::globalDepth() const {
+  std::shared_lock<std::shared_mutex> lock(dir_latch_);
+  return global_depth_;
+}
+
+PageId HashIndex::bucketOf(const std::uint64_t hash) {
+  const std::uint32_t index =
+      static_cast<std::uint32_t>(hash & ((std::uint64_t{1} << global_depth_) - 1));
+  PageView dir = mgr_.readPage(file_, dir_pages_[index / DIR_ENTRIES_PER_PAGE]);
+  return asDirectory(*dir)->buckets[index % DIR_ENTRIES_PER_PAGE];
+}
+
+void HashIndex::setDirectoryEntry(const std::uint32_t index, const PageId bucket) {
+  MutablePageView dir =
+      mgr_.readPage<MutablePageView>(file_, dir_pages_[index / DIR_ENTRIES_PER_PAGE]);
+  asDirectory(*dir)->buckets[index % DIR_ENTRIES_PER_PAGE] = bucket;
+}
+
+std::optional<RecordId> HashIndex::lookup(const Key key) {
+  const std::uint64_t hash = hashKey(key);
+  std::shared_lock<std::shared_mutex> dir_lock(dir_latch_);
+  PageView view = mgr_.readPage(file_, bucketOf(hash));
+  std::shared_lock<std::shared_mutex> lock(view.latch());
+  const BucketPage* bucket = asBucket(*view);
+  const int pos = findEntry(bucket, key);
+  if (pos < 0) {
+    return std::nullopt;
+  }
+  return bucket->entries[pos].rid;
+}
+
+bool HashIndex::insert(const Key key, const RecordId& rid) {
+  const std::uint64_t hash = hashKey(key);
+  {
+    // 先以只读视图引用桶, 确实要写入时才换成可变视图: 可变视图使页变脏,
+    // 并使桶上的乐观读失败, 键已存在或桶已满时都不需要.
+    std::shared_lock<std::shared_mutex> dir_lock(dir_latch_);
+    PageView view = mgr_.readPage(file_, bucketOf(hash));
+    std::unique_lock<std::shared_mutex> lock(view.latch());
+    const BucketPage* bucket = asBucket(*view);
+    if (findEntry(bucket, key) >= 0) {
+      return false;
+    }
+    if (bucket->num_entries < BUCKET_CAPACITY) {
+      // view 仍引用着这一页, 重新引用一定成功
+      MutablePageView writable = *mgr_.repin<MutablePageView>(view.handle());
+      appendEntry(asBucket(*writable), key, rid);
+      return true;
+    }
+  }
+
+  // 桶满了: 排他地持有目录锁, 分裂直到键所在的桶有空位.
+  // 放开共享锁之后别的线程可能已经分裂过这个桶, 所以每一轮都重新查找.
+  std::unique_lock<std::shared_mutex> dir_lock(dir_latch_);
+  for (;;) {
+    {
+      PageView view = mgr_.readPage(file_, bucketOf(hash));
+      const BucketPage* bucket = asBucket(*view);
+      if (findEntry(bucket, key) >= 0) {
+        return false;
+      }
+      if (bucket->num_entries < BUCKET_CAPACITY) {
+        MutablePageView writable = *mgr_.repin<MutablePageView>(view.handle());
+        appendEntry(asBucket(*writable), key, rid);
+        return true;
+      }
+      if (bucket->local_depth == global_depth_) {
+        if (global_depth_ == MAX_GLOBAL_DEPTH) {
+          throw std::length_error("hash index directory is full: " + file_.filename());
+        }
+        doubleDirectory();
+      }
+    }
+    splitBucket(hash);
+  }
+}
+
+bool HashIndex::remove(const Key key) {
+  const std::uint64_t hash = hashKey(key);
+  std::shared_lock<std::shared_mutex> dir_lock(dir_latch_);
+  // 与 insert() 一样, 找到键之后才换成可变视图
+  PageView view = mgr_.readPage(file_, bucketOf(hash));
+  std::unique_lock<std::shared_mutex> lock(view.latch());
+  const int pos = findEntry(asBucket(*view), key);
+  if (pos < 0) {
+    return false;
+  }
+  MutablePageView writable = *mgr_.repin<MutablePageView>(view.handle());
+  BucketPage* bucket = asBucket(*writable);
+  bucket->entries[pos] = bucket->entries[--bucket->num_entries];
+  return true;
+}
+
+void HashIndex::doubleDirectory() {
+  const std::uint32_t size = std::uint32_t{1} << global_depth_;
+  if (size < DIR_ENTRIES_PER_PAGE) {
+    // 目录还在第一页中: 在页内把前一半复制到后一半.
+    MutablePageView dir = mgr_.readPage<MutablePageView>(file_, dir_pages_[0]);
+    PageId* buckets = asDirectory(*dir)->buckets;
+    std::copy(buckets, buckets + size, buckets + size);
+  } else {
+    // 目录占满了若干整页: 新的后一半是这些页的副本.
+    const std::size_t num_pages = dir_pages_.size();
+    for (std::size_t i = 0; i < num_pages; ++i) {
+      PageView src = mgr_.readPage(file_, dir_pages_[i]);
+      PageId page_number;
+      MutablePageView dst = mgr_.allocPage(file_, page_number);
+      *asDirectory(*dst) = *asDirectory(*src);
+      dir_pages_.push_back(page_number);
+    }
+  }
+  global_depth_++;
+  writeMeta();
+}
+
+void HashIndex::splitBucket(const std::uint64_t hash) {
+  MutablePageView old_view = mgr_.readPage<MutablePageView>(file_, bucketOf(hash));
+  BucketPage* old_bucket = asBucket(*old_view);
+  const std::uint32_t depth = old_bucket->local_depth;
+  assert(depth < global_depth_);
+
+  PageId new_page;
+  MutablePageView new_view = mgr_.allocPage(file_, new_page);
+  BucketPage* new_bucket = asBucket(*new_view);
+  new_bucket->local_depth = depth + 1;
+  new_bucket->num_entries = 0;
+  old_bucket->local_depth = depth + 1;
+
+  // 按散列值的第 depth 位重新分配: 为 1 的移到新桶.
+  std::uint32_t kept = 0;
+  for (std::uint32_t i = 0; i < old_bucket->num_entries; ++i) {
+    const BucketEntry& entry = old_bucket->entries[i];
+    if ((hashKey(entry.key) >> depth) & 1) {
+      new_bucket->entries[new_bucket->num_entries++] = entry;
+    } else {
+      old_bucket->entries[kept++] = entry;
+    }
+  }
+  old_bucket->num_entries = kept;
+
+  // 指向旧桶的目录项是低 depth 位与 hash 相同的那些, 其中第 depth 位为 1 的改指新桶.
+  const std::uint32_t low = static_cast<std::uint32_t>(hash & ((std::uint64_t{1} << depth) - 1));
+  const std::uint32_t size = std::uint32_t{1} << global_depth_;
+  for (std::uint32_t i = low | (std::uint32_t{1} << depth); i < size;
+       i += std::uint32_t{1} << (depth + 1)) {
+    setDirectoryEntry(i, new_page);
+  }
+}
+
+void HashIndex::writeMeta() {
+  MutablePageView meta = mgr_.readPage<MutablePageView>(file_, META_PAGE);
+  IndexMeta* content = asMeta(*meta);
+  content->global_depth = global_depth_;
+  content->num_dir_pages = static_cast<std::uint32_t>(dir_pages_.size());
+  std::copy(dir_pages_.begin(), dir_pages_.end(), content->dir_pages);
+}
+
+}
@@ -0,0 +1,135 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 存放在磁盘上的可扩展散列 (extendible hashing) 索引, 只支持等值查找.
+ *
+ * 索引文件由三种页组成:
+ * - 元数据页 (第一页): 全局深度和目录页的页号;
+ * - 目录页: 2^全局深度 个桶页号, 按键的散列值的低位下标;
+ * - 桶页: 局部深度和至多一页的 (键, 记录) 对.
+ * 目录页的页号在内存中有一份, 所以一次查找只引用一个目录页和一个桶页,
+ * 目录页通常常驻缓冲池.
+ *
+ * 桶满时只分裂这一个桶 (局部深度加一, 按散列值的下一位重新分配), 局部深度
+ * 等于全局深度时先把目录加倍 (复制目录项, 不移动任何记录), 所以从不重新散列
+ * 整个索引.  删除不合并桶, 目录也不会收缩.
+ *
+ * 并发控制: 目录由索引级的读写锁保护, 桶由其所在帧的读写锁保护.  查找和
+ * 不需要分裂的插入/删除共享地持有目录锁, 分裂和目录加倍排他地持有它
+ * (此时没有其他线程在访问任何桶).
+ */
+class HashIndex {
+ public:
+  /**
+   * 键的类型
+   */
+  using Key = std::int64_t;
+
+  /**
+   * 打开一个索引.  如果文件中还没有页, 就在其中建立一个只有一个桶的空索引.
+   *
+   * @param file  索引文件, 在索引的整个生命期内必须保持打开
+   * @param mgr   通过它引用索引页的缓冲池
+   */
+  HashIndex(File& file, BufMgr& mgr);
+
+  /**
+   * 等值查找
+   *
+   * @param key 键
+   * @return 键对应的记录, 键不存在时为空
+   */
+  std::optional<RecordId> lookup(const Key key);
+
+  /**
+   * 插入一个键
+   *
+   * @param key 键
+   * @param rid 键对应的记录
+   * @return 是否插入了; 键已经存在时返回 false, 索引不变
+   * @throws std::length_error 目录已经达到最大深度而桶仍然放不下时
+   */
+  bool insert(const Key key, const RecordId& rid);
+
+  /**
+   * 删除一个键
+   *
+   * @param key 键
+   * @return 是否删除了; 键不存在时返回 false
+   */
+  bool remove(const Key key);
+
+  /**
+   * 全局深度: 目录有 2^globalDepth() 项
+   */
+  std::uint32_t globalDepth() const;
+
+ private:
+  /**
+   * 元数据页的页号
+   */
+  static constexpr PageId META_PAGE = 1;
+
+  /**
+   * 散列值 hash 所在的桶的页号.  调用者须持有 dir_latch_.
+   */
+  PageId bucketOf(const std::uint64_t hash);
+
+  /**
+   * 修改一个目录项.  调用者须排他地持有 dir_latch_.
+   */
+  void setDirectoryEntry(const std::uint32_t index, const PageId bucket);
+
+  /**
+   * 目录加倍.  调用者须排他地持有 dir_latch_.
+   */
+  void doubleDirectory();
+
+  /**
+   * 把散列值 hash 所在的桶一分为二.  调用者须排他地持有 dir_latch_.
+   */
+  void splitBucket(const std::uint64_t hash);
+
+  /**
+   * 把全局深度和目录页写入元数据页.  调用者须排他地持有 dir_latch_.
+   */
+  void writeMeta();
+
+  File& file_;
+  BufMgr& mgr_;
+
+  /**
+   * 保护目录 (目录页的内容, global_depth_ 和 dir_pages_)
+   */
+  mutable std::shared_mutex dir_latch_;
+
+  /**
+   * 全局深度
+   */
+  std::uint32_t global_depth_;
+
+  /**
+   * 目录页的页号, 与元数据页中的一致
+   */
+  std::vector<PageId> dir_pages_;
+};
+
+}
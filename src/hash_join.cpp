@@ -0,0 +1,255 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "hash_join.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+#include "bulk_loader.h"
+#include "page_iterator.h"
+#include "temp_file.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * 连接键的散列值.  分区用高位, 基数划分和桶用低位, 所以各位都要充分混合.
+ */
+std::uint64_t hashKey(std::uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+/**
+ * 散列表中的一项: 记录本身留在页里
+ */
+struct Tuple {
+  std::uint64_t hash;
+  std::uint64_t key;
+  std::string_view record;
+};
+
+/**
+ * 收集 pages[0, count) 中的所有记录, 跳过空闲页
+ */
+void collect(const Page* pages, const PageId count, const HashJoin::KeyOf& key_of,
+             std::vector<Tuple>& out) {
+  for (PageId i = 0; i < count; ++i) {
+    const Page& page = pages[i];
+    if (page.page_number() == Page::INVALID_NUMBER) {
+      continue;
+    }
+    for (PageIterator iter = page.begin(); iter != page.end(); ++iter) {
+      const std::string_view record = page.getRecordView(iter.record_id());
+      const std::uint64_t key = key_of(record);
+      out.push_back({hashKey(key), key, record});
+    }
+  }
+}
+
+/**
+ * 按散列值的低 bits 位对 in 做计数排序.  begin[c] 是第 c 个簇在 out 中的起点,
+ * 共 2^bits + 1 项.
+ */
+void radixCluster(const std::vector<Tuple>& in, const unsigned bits, std::vector<Tuple>& out,
+                  std::vector<std::uint32_t>& begin) {
+  const std::size_t clusters = std::size_t{1} << bits;
+  const std::uint64_t mask = clusters - 1;
+  begin.assign(clusters + 1, 0);
+  for (const Tuple& tuple : in) {
+    begin[(tuple.hash & mask) + 1]++;
+  }
+  for (std::size_t c = 0; c < clusters; ++c) {
+    begin[c + 1] += begin[c];
+  }
+  std::vector<std::uint32_t> position(begin.begin(), begin.end() - 1);
+  out.resize(in.size());
+  for (const Tuple& tuple : in) {
+    out[position[tuple.hash & mask]++] = tuple;
+  }
+}
+
+/**
+ * 按基数划分的散列表: 每个簇有自己的桶数组 (链地址法), 一个簇的全部数据
+ * 不超过 HashJoin::CACHE_BYTES.
+ */
+class RadixHashTable {
+ public:
+  void build(const std::vector<Tuple>& tuples) {
+    constexpr std::size_t bytes_per_tuple = sizeof(Tuple) + 2 * sizeof(std::uint32_t);
+    const std::size_t clusters_needed =
+        (tuples.size() * bytes_per_tuple + HashJoin::CACHE_BYTES - 1) / HashJoin::CACHE_BYTES;
+    bits_ = std::bit_width(std::bit_ceil(std::max<std::size_t>(1, clusters_needed))) - 1;
+    radixCluster(tuples, bits_, tuples_, cluster_begin_);
+
+    const std::size_t clusters = std::size_t{1} << bits_;
+    bucket_begin_.assign(clusters + 1, 0);
+    for (std::size_t c = 0; c < clusters; ++c) {
+      const std::uint32_t size = cluster_begin_[c + 1] - cluster_begin_[c];
+      bucket_begin_[c + 1] = bucket_begin_[c] + std::bit_ceil(std::max<std::uint32_t>(1, size));
+    }
+    heads_.assign(bucket_begin_[clusters], NONE);
+    next_.assign(tuples_.size(), NONE);
+    for (std::size_t c = 0; c < clusters; ++c) {
+      for (std::uint32_t i = cluster_begin_[c]; i < cluster_begin_[c + 1]; ++i) {
+        const std::uint32_t bucket = bucketOf(c, tuples_[i].hash);
+        next_[i] = heads_[bucket];
+        heads_[bucket] = i;
+      }
+    }
+  }
+
+  /**
+   * 探测: probes 先按同样的位分簇, 再逐簇探测, 每个簇只访问自己的桶数组.
+   */
+  void probe(const std::vector<Tuple>& probes, const HashJoin::Emit& emit) {
+    radixCluster(probes, bits_, clustered_probes_, probe_begin_);
+    const std::size_t clusters = std::size_t{1} << bits_;
+    for (std::size_t c = 0; c < clusters; ++c) {
+      for (std::uint32_t j = probe_begin_[c]; j < probe_begin_[c + 1]; ++j) {
+        const Tuple& probe = clustered_probes_[j];
+        for (std::uint32_t i = heads_[bucketOf(c, probe.hash)]; i != NONE; i = next_[i]) {
+          if (tuples_[i].key == probe.key) {
+            emit(tuples_[i].record, probe.record);
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr std::uint32_t NONE = UINT32_MAX;
+
+  /**
+   * 簇 c 中散列值为 hash 的项所在的桶.  簇号用了低 bits_ 位, 桶用它之上的位.
+   */
+  std::uint32_t bucketOf(const std::size_t c, const std::uint64_t hash) const {
+    const std::uint32_t buckets = bucket_begin_[c + 1] - bucket_begin_[c];
+    return bucket_begin_[c] + static_cast<std::uint32_t>((hash >> bits_) & (buckets - 1));
+  }
+
+  unsigned bits_ = 0;
+  std::vector<Tuple> tuples_;
+  std::vector<std::uint32_t> cluster_begin_;
+  std::vector<std::uint32_t> bucket_begin_;
+  std::vector<std::uint32_t> heads_;
+  std::vector<std::uint32_t> next_;
+  std::vector<Tuple> clustered_probes_;
+  std::vector<std::uint32_t> probe_begin_;
+};
+
+}
+
+HashJoin::HashJoin(BufMgr& mgr, const std::uint32_t budget, KeyOf build_key, KeyOf probe_key)
+    : mgr_(mgr),
+      budget_(budget),
+      build_frames_(budget - std::max<std::uint32_t>(1, budget / 8)),
+      build_key_(std::move(build_key)),
+      probe_key_(std::move(probe_key)) {
+  if (budget_ < 2) {
+    throw std::invalid_argument("join budget must be at least 2 frames");
+  }
+}
+
+void HashJoin::join(File& build, File& probe, const Emit& emit) {
+  FrameReservation reservation = mgr_.reserveFrames(budget_);
+  Page* frames = reservation.pages();
+
+  const PageId build_pages = build.numPages() - 1;
+  if (build_pages <= build_frames_) {
+    joinInMemory(build, probe, frames, emit);
+    return;
+  }
+
+  // 分区数取 2 的幂, 让每个构建侧分区平均只占一半的构建帧, 给分布不均留出余地.
+  const std::size_t wanted = (2 * std::size_t{build_pages} + build_frames_ - 1) / build_frames_;
+  const unsigned bits = std::min<unsigned>(
+      MAX_PARTITION_BITS, std::bit_width(std::bit_ceil(wanted)) - 1);
+  const std::vector<std::unique_ptr<TempFile>> build_parts =
+      partition(build, build_key_, bits, frames, build.filename());
+  const std::vector<std::unique_ptr<TempFile>> probe_parts =
+      partition(probe, probe_key_, bits, frames, build.filename());
+  for (std::size_t p = 0; p < build_parts.size(); ++p) {
+    joinInMemory(build_parts[p]->file(), probe_parts[p]->file(), frames, emit);
+  }
+}
+
+std::vector<std::unique_ptr<TempFile>> HashJoin::partition(File& input, const KeyOf& key_of,
+                                                           const unsigned bits, Page* frames,
+                                                           const std::string& prefix) {
+  assert(bits > 0);
+  const std::size_t num_parts = std::size_t{1} << bits;
+  std::vector<std::unique_ptr<TempFile>> parts;
+  std::vector<std::unique_ptr<BulkLoader>> writers;
+  for (std::size_t p = 0; p < num_parts; ++p) {
+    parts.push_back(std::make_unique<TempFile>(prefix, "join", input.ioMode()));
+    writers.push_back(std::make_unique<BulkLoader>(parts.back()->file(), PARTITION_WRITE_PAGES));
+  }
+
+  // 整个预留区都用作读缓冲, 成段读入输入.
+  const PageId num_pages = input.numPages();
+  for (PageId first = 1; first < num_pages; first += budget_) {
+    const PageId count = std::min<PageId>(budget_, num_pages - first);
+    input.readPages(first, count, frames);
+    for (PageId i = 0; i < count; ++i) {
+      const Page& page = frames[i];
+      if (page.page_number() == Page::INVALID_NUMBER) {
+        continue;
+      }
+      for (PageIterator iter = page.begin(); iter != page.end(); ++iter) {
+        const std::string_view record = page.getRecordView(iter.record_id());
+        writers[hashKey(key_of(record)) >> (64 - bits)]->insertRecord(record);
+      }
+    }
+  }
+  for (const std::unique_ptr<BulkLoader>& writer : writers) {
+    writer->finish();
+  }
+  return parts;
+}
+
+void HashJoin::joinInMemory(File& build, File& probe, Page* frames, const Emit& emit) {
+  Page* build_pages = frames;
+  Page* probe_pages = frames + build_frames_;
+  const PageId probe_frames = budget_ - build_frames_;
+  const PageId build_end = build.numPages();
+  const PageId probe_end = probe.numPages();
+
+  std::vector<Tuple> tuples;
+  std::vector<Tuple> probes;
+  RadixHashTable table;
+  // 构建侧一次放不下时分段构建, 每段把探测侧完整地探测一遍.
+  for (PageId build_first = 1; build_first < build_end; build_first += build_frames_) {
+    const PageId build_count = std::min<PageId>(build_frames_, build_end - build_first);
+    build.readPages(build_first, build_count, build_pages);
+    tuples.clear();
+    collect(build_pages, build_count, build_key_, tuples);
+    if (tuples.empty()) {
+      continue;
+    }
+    table.build(tuples);
+
+    for (PageId probe_first = 1; probe_first < probe_end; probe_first += probe_frames) {
+      const PageId probe_count = std::min<PageId>(probe_frames, probe_end - probe_first);
+      probe.readPages(probe_first, probe_count, probe_pages);
+      probes.clear();
+      collect(probe_pages, probe_count, probe_key_, probes);
+      table.probe(probes, emit);
+    }
+  }
+}
+
+}
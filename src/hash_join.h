@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class TempFile;
+
+/**
+ * @brief 两个堆文件的等值散列连接, 内存不够时退化为 Grace 散列连接.
+ *
+ * 工作内存是从 BufMgr 预留的 budget 个连续的帧 (见 BufMgr::reserveFrames()).
+ * 其中约八分之七存放构建侧的页, 其余作为探测侧的读缓冲.
+ *
+ * - 构建侧放得下时: 整段读入构建侧的页, 记录留在页里, 对它们建散列表;
+ *   然后成段读入探测侧的页逐条探测.  每个输入只读一遍.
+ * - 放不下时: 按键的散列值的高位把两个输入都分成 2^k 个分区, 写到临时文件
+ *   ("<构建侧文件名>.join<n>"), 再逐对连接分区.
+ *   个别分区仍然放不下时 (例如键严重倾斜), 该分区分成几段构建, 每段探测一遍.
+ *
+ * 内存中的散列表按散列值的低位做基数划分 (radix partitioning): 每个簇的散列表
+ * 不超过 CACHE_BYTES, 探测的记录也先按同样的位分簇, 再逐簇探测,
+ * 这样探测时的随机访问都落在缓存里.
+ *
+ * 连接直接从磁盘读输入文件, 不经过缓冲池: 输入文件在缓冲池中的脏页须先写回.
+ * 记录本身留在预留的帧中; 每条记录另有一项 (约 32 字节) 的散列表目录,
+ * 分区的每个写者另有 PARTITION_WRITE_PAGES 页的写缓冲, 它们不计入 budget.
+ */
+class HashJoin {
+ public:
+  /**
+   * 从记录中取出连接键
+   */
+  using KeyOf = std::function<std::uint64_t(std::string_view)>;
+
+  /**
+   * 输出一对键相等的记录 (构建侧, 探测侧).  记录视图只在调用期间有效.
+   */
+  using Emit = std::function<void(std::string_view, std::string_view)>;
+
+  /**
+   * 基数划分时每个簇的散列表的目标大小, 取典型的 L2 缓存大小
+   */
+  static constexpr std::size_t CACHE_BYTES = 256 * 1024;
+
+  /**
+   * 每个分区的写者一次写出的页数
+   */
+  static constexpr PageId PARTITION_WRITE_PAGES = 8;
+
+  /**
+   * 分区数的上限为 2^MAX_PARTITION_BITS
+   */
+  static constexpr unsigned MAX_PARTITION_BITS = 8;
+
+  /**
+   * @param mgr        从中预留工作内存的缓冲池
+   * @param budget     工作内存的帧数, 至少为 2
+   * @param build_key  构建侧记录的连接键
+   * @param probe_key  探测侧记录的连接键
+   * @throws std::invalid_argument budget 太小时
+   */
+  HashJoin(BufMgr& mgr, const std::uint32_t budget, KeyOf build_key, KeyOf probe_key);
+
+  /**
+   * 执行连接, 对每一对键相等的记录调用一次 emit, 顺序不确定.
+   *
+   * @param build  构建侧, 应是较小的输入
+   * @param probe  探测侧
+   * @param emit   输出函数
+   * @throws BufferExceededException 缓冲池中找不到 budget 个连续的空闲帧时
+   */
+  void join(File& build, File& probe, const Emit& emit);
+
+ private:
+  /**
+   * 在内存中连接两个 (已经足够小的) 输入
+   */
+  void joinInMemory(File& build, File& probe, Page* frames, const Emit& emit);
+
+  /**
+   * 按散列值的高 bits 位把 input 分成 2^bits 个分区, 写到临时文件
+   */
+  std::vector<std::unique_ptr<TempFile>> partition(File& input, const KeyOf& key_of,
+                                                   const unsigned bits, Page* frames,
+                                                   const std::string& prefix);
+
+  BufMgr& mgr_;
+  const std::uint32_t budget_;
+
+  /**
+   * 存放构建侧的帧数, 其余的帧是探测侧的读缓冲
+   */
+  const PageId build_frames_;
+  KeyOf build_key_;
+  KeyOf probe_key_;
+};
+
+}
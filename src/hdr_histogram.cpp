@@ -0,0 +1,63 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "hdr_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace badgerdb {
+
+std::uint64_t HdrHistogram::highestValueOf(const unsigned bucket) {
+  constexpr unsigned linear = 2u << SUB_BUCKET_BITS;
+  if (bucket < linear) {
+    return bucket;
+  }
+  const unsigned shift = (bucket - linear) / (1u << SUB_BUCKET_BITS) + 1;
+  const std::uint64_t sub = (bucket - linear) % (1u << SUB_BUCKET_BITS);
+  const std::uint64_t lowest = ((std::uint64_t{1} << SUB_BUCKET_BITS) + sub) << shift;
+  return lowest + (std::uint64_t{1} << shift) - 1;
+}
+
+double HdrHistogram::mean() const {
+  const std::uint64_t n = count();
+  return n == 0 ? 0 : static_cast<double>(sum()) / static_cast<double>(n);
+}
+
+std::uint64_t HdrHistogram::percentile(const double percent) const {
+  std::uint64_t counts[NUM_BUCKETS];
+  std::uint64_t total = 0;
+  for (unsigned b = 0; b < NUM_BUCKETS; ++b) {
+    counts[b] = buckets_[b].load(std::memory_order_relaxed);
+    total += counts[b];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const double clamped = percent < 0 ? 0 : (percent > 100 ? 100 : percent);
+  const auto rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::ceil(clamped / 100 * static_cast<double>(total))));
+  std::uint64_t seen = 0;
+  for (unsigned b = 0; b < NUM_BUCKETS; ++b) {
+    seen += counts[b];
+    if (seen >= rank) {
+      return std::min(highestValueOf(b), max());
+    }
+  }
+  return max();
+}
+
+void HdrHistogram::clear() {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,97 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief 对数-线性分桶的直方图 (HDR 风格), 用于延迟等跨越多个数量级的值.
+ *
+ * 小于 64 的值各占一个桶; 更大的值按 2 的幂分段, 每段再均分为 32 个桶,
+ * 所以任何值的相对误差不超过 1/32.  最大可区分的值为 2^37 - 1
+ * (以纳秒计约 137 秒), 更大的值计入最后一个桶.
+ *
+ * 计数是 relaxed 原子加, 多个线程可以同时记录, 也可以在记录的同时查询
+ * (查询结果是各个桶在某一时刻的值).
+ */
+class HdrHistogram {
+ public:
+  /// 每个 2 的幂分段中的桶数的对数
+  static constexpr unsigned SUB_BUCKET_BITS = 5;
+  /// 可区分的最大值的位数
+  static constexpr unsigned MAX_VALUE_BITS = 37;
+  static constexpr std::uint64_t MAX_VALUE = (std::uint64_t{1} << MAX_VALUE_BITS) - 1;
+  static constexpr unsigned NUM_BUCKETS =
+      (2u << SUB_BUCKET_BITS) + (MAX_VALUE_BITS - SUB_BUCKET_BITS - 1) * (1u << SUB_BUCKET_BITS);
+
+  HdrHistogram() = default;
+  HdrHistogram(const HdrHistogram&) = delete;
+  HdrHistogram& operator=(const HdrHistogram&) = delete;
+
+  void record(std::uint64_t value) {
+    if (value > MAX_VALUE) {
+      value = MAX_VALUE;
+    }
+    buckets_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    std::uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+  /// 记录的值之和
+  std::uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+  /// 记录过的最大值, 没有记录时为 0
+  std::uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+  /// 平均值, 没有记录时为 0
+  double mean() const;
+
+  /**
+   * 百分位数: 不小于 percent% 的记录值的最小的值 (所在桶的上界), 没有记录时为 0
+   *
+   * @param percent 0 到 100
+   */
+  std::uint64_t percentile(const double percent) const;
+
+  void clear();
+
+  /**
+   * 值所在的桶
+   */
+  static unsigned bucketOf(const std::uint64_t value) {
+    constexpr std::uint64_t linear = std::uint64_t{2} << SUB_BUCKET_BITS;
+    if (value < linear) {
+      return static_cast<unsigned>(value);
+    }
+    const unsigned shift = static_cast<unsigned>(std::bit_width(value)) - SUB_BUCKET_BITS - 1;
+    const unsigned sub = static_cast<unsigned>(value >> shift) - (1u << SUB_BUCKET_BITS);
+    return static_cast<unsigned>(linear) + (shift - 1) * (1u << SUB_BUCKET_BITS) + sub;
+  }
+
+  /**
+   * 桶中的最大值
+   */
+  static std::uint64_t highestValueOf(const unsigned bucket);
+
+ private:
+  std::atomic<std::uint64_t> buckets_[NUM_BUCKETS] = {};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> sum_{0};
+  std::atomic<std::uint64_t> max_{0};
+};
+
+}
@@ -95,6 +95,13 @@
  *  badgerdb::File existing_file = badgerdb::File::open("filename.db");
  * @endcode
  *
+ * 创建或打开文件时可以选择 I/O 方式. 使用直接 I/O 时页面不会再被内核页缓存
+ * 缓存一份,缓冲池成为唯一的缓存:
+ * @code
+ *  badgerdb::File::sptr direct_file =
+ *      badgerdb::File::create("filename.db", badgerdb::IoMode::Direct);
+ * @endcode
+ *
  * Multiple File objects share the same stream to the underlying file.  The
  * stream will be automatically closed when the last File object is out of
  * scope; no explicit close command is necessary.
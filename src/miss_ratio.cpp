@@ -0,0 +1,160 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "miss_ratio.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace badgerdb {
+
+MissRatioEstimator::MissRatioEstimator(const std::uint64_t max_distance,
+                                       const double sample_rate,
+                                       const std::uint32_t max_samples)
+    : max_distance_(max_distance),
+      initial_threshold_(static_cast<std::uint32_t>(std::ceil(sample_rate * MODULUS))),
+      max_samples_(max_samples),
+      bucket_width_(std::max(1.0, static_cast<double>(max_distance) / NUM_BUCKETS)),
+      threshold_(initial_threshold_),
+      fenwick_(2 * static_cast<std::size_t>(max_samples) + 1),
+      histogram_(NUM_BUCKETS) {
+  if (max_distance == 0 || max_samples == 0 || !(sample_rate > 0 && sample_rate <= 1)) {
+    throw std::invalid_argument("invalid miss ratio estimator parameters");
+  }
+  samples_.reserve(max_samples + 1);
+}
+
+void MissRatioEstimator::sample(const std::uint64_t key, const std::uint32_t hash) {
+  if (next_slot_ + 1 == fenwick_.size()) {
+    compact();
+  }
+  const double rate = sampleRate();
+  auto it = samples_.find(key);
+  if (it != samples_.end()) {
+    const std::uint32_t slot = it->second.slot;
+    // 上次访问之后又访问过的其他样本页数
+    const std::uint32_t distinct = fenwickPrefix(next_slot_) - fenwickPrefix(slot + 1);
+    record(distinct / rate, 1);
+    fenwickAdd(slot, -1);
+    it->second.slot = next_slot_;
+  } else {
+    cold_ += 1;
+    samples_.emplace(key, Sample{hash, next_slot_});
+    by_hash_.emplace(hash, key);
+  }
+  fenwickAdd(next_slot_, 1);
+  ++next_slot_;
+
+  if (samples_.size() > max_samples_) {
+    // 去掉散列值最大的页, 阈值降到它的散列值, 它和更大的散列值以后都不再抽样
+    const auto largest = std::prev(by_hash_.end());
+    const std::uint32_t new_threshold = largest->first;
+    const auto evicted = samples_.find(largest->second);
+    fenwickAdd(evicted->second.slot, -1);
+    samples_.erase(evicted);
+    by_hash_.erase(largest);
+
+    const double scale = static_cast<double>(new_threshold) / threshold_;
+    for (double& count : histogram_) {
+      count *= scale;
+    }
+    far_ *= scale;
+    cold_ *= scale;
+    threshold_ = new_threshold;
+  }
+}
+
+void MissRatioEstimator::record(const double distance, const double weight) {
+  if (distance >= static_cast<double>(max_distance_)) {
+    far_ += weight;
+    return;
+  }
+  const auto bucket = std::min<std::size_t>(static_cast<std::size_t>(distance / bucket_width_),
+                                            NUM_BUCKETS - 1);
+  histogram_[bucket] += weight;
+}
+
+void MissRatioEstimator::compact() {
+  std::vector<std::pair<std::uint32_t, std::uint64_t>> live;
+  live.reserve(samples_.size());
+  for (const auto& [key, s] : samples_) {
+    live.emplace_back(s.slot, key);
+  }
+  std::sort(live.begin(), live.end());
+  std::fill(fenwick_.begin(), fenwick_.end(), 0);
+  next_slot_ = 0;
+  for (const auto& [slot, key] : live) {
+    samples_[key].slot = next_slot_;
+    fenwickAdd(next_slot_, 1);
+    ++next_slot_;
+  }
+}
+
+void MissRatioEstimator::fenwickAdd(std::uint32_t slot, const int delta) {
+  for (++slot; slot < fenwick_.size(); slot += slot & (~slot + 1)) {
+    fenwick_[slot] += delta;
+  }
+}
+
+std::uint32_t MissRatioEstimator::fenwickPrefix(std::uint32_t slot) const {
+  std::int64_t sum = 0;
+  for (; slot > 0; slot -= slot & (~slot + 1)) {
+    sum += fenwick_[slot];
+  }
+  return static_cast<std::uint32_t>(sum);
+}
+
+double MissRatioEstimator::hitRatio(const std::uint64_t cache_pages) const {
+  double sampled = far_ + cold_;
+  double hits = 0;
+  const double size = static_cast<double>(cache_pages);
+  for (std::size_t b = 0; b < NUM_BUCKETS; ++b) {
+    sampled += histogram_[b];
+    // 距离小于缓存大小的访问命中; 跨过缓存大小的桶按比例计入
+    const double low = static_cast<double>(b) * bucket_width_;
+    const double covered = std::clamp((size - low) / bucket_width_, 0.0, 1.0);
+    hits += histogram_[b] * covered;
+  }
+  if (sampled == 0 || cache_pages == 0) {
+    return 0;
+  }
+  // SHARDS 的修正: 样本访问数与期望之差计为距离 0 的访问 (命中)
+  const double expected = static_cast<double>(accesses_) * sampleRate();
+  hits += expected - sampled;
+  return std::clamp(hits / expected, 0.0, 1.0);
+}
+
+void MissRatioEstimator::rescale(const std::uint64_t max_distance) {
+  if (max_distance == 0) {
+    throw std::invalid_argument("invalid miss ratio estimator parameters");
+  }
+  const double old_width = bucket_width_;
+  std::vector<double> old(NUM_BUCKETS, 0);
+  old.swap(histogram_);
+  max_distance_ = max_distance;
+  bucket_width_ = std::max(1.0, static_cast<double>(max_distance) / NUM_BUCKETS);
+  for (std::size_t b = 0; b < NUM_BUCKETS; ++b) {
+    if (old[b] != 0) {
+      record((static_cast<double>(b) + 0.5) * old_width, old[b]);
+    }
+  }
+}
+
+void MissRatioEstimator::clear() {
+  threshold_ = initial_threshold_;
+  samples_.clear();
+  by_hash_.clear();
+  std::fill(fenwick_.begin(), fenwick_.end(), 0);
+  next_slot_ = 0;
+  std::fill(histogram_.begin(), histogram_.end(), 0);
+  far_ = 0;
+  cold_ = 0;
+  accesses_ = 0;
+}
+
+}
@@ -0,0 +1,158 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 缺失率曲线上的一点: 缓冲池有 num_bufs 个帧时预计的命中率
+ */
+struct MissRatioPoint {
+  std::uint64_t num_bufs;
+  double hit_ratio;
+};
+
+/**
+ * @brief 用抽样的重用距离在线估计缺失率曲线 (SHARDS), 内存占用有上界.
+ *
+ * 一页的重用距离是它两次访问之间访问过的其他不同页数; 在 LRU 缓存中,
+ * 重用距离小于缓存大小的访问命中.  只跟踪页号散列值小于阈值 T 的页
+ * (抽样率 R = T / MODULUS), 在样本中算出的距离除以 R 就是整体距离的估计.
+ * 同一页总是被同时抽中或不抽中, 所以样本中的距离是无偏的.
+ *
+ * 样本最多 max_samples 页: 超过时去掉散列值最大的页, 并把阈值降到它的散列值,
+ * 已有的直方图按新旧抽样率之比缩小.  距离用树状数组在 O(log max_samples) 内算出.
+ *
+ * 少数很热的页是否被抽中对结果影响很大, 所以按 SHARDS 的修正, 把期望的样本访问数
+ * (总访问数乘以抽样率) 与实际样本访问数之差计为距离 0 的访问.
+ *
+ * 缓冲池用 CLOCK 替换, 它近似于 LRU, 所以估计的是近似值.
+ * 本类不加锁, 由调用者 (BufMgr) 串行化.
+ */
+class MissRatioEstimator {
+ public:
+  /**
+   * 散列值的取值范围
+   */
+  static constexpr std::uint32_t MODULUS = 1u << 24;
+
+  /**
+   * 直方图的桶数
+   */
+  static constexpr std::uint32_t NUM_BUCKETS = 1024;
+
+  /**
+   * @param max_distance  关心的最大缓存大小 (页数), 更远的重用都算作缺失
+   * @param sample_rate   初始抽样率, (0, 1]
+   * @param max_samples   最多跟踪的页数
+   * @throws std::invalid_argument 参数不合法时
+   */
+  MissRatioEstimator(const std::uint64_t max_distance, const double sample_rate = 0.01,
+                     const std::uint32_t max_samples = 8192);
+
+  /**
+   * 记录一次对 (file, page) 的访问
+   */
+  void access(const FileId file, const PageId page) {
+    const std::uint64_t key = (static_cast<std::uint64_t>(file) << 32) | page;
+    const std::uint32_t hash = hashOf(key);
+    ++accesses_;
+    if (hash < threshold_) {
+      sample(key, hash);
+    }
+  }
+
+  /**
+   * 缓存有 cache_pages 页时预计的命中率; 还没有样本时为 0
+   */
+  double hitRatio(const std::uint64_t cache_pages) const;
+
+  /**
+   * 当前的抽样率
+   */
+  double sampleRate() const { return static_cast<double>(threshold_) / MODULUS; }
+
+  /**
+   * 清空样本和直方图, 抽样率回到初始值
+   */
+  void clear();
+
+  /**
+   * 把关心的最大缓存大小改为 max_distance (缓冲池改变大小时), 保留已有的样本:
+   * 直方图按桶的中点重新分桶, 超出新范围的计入缺失.  扩大时原来超出范围的
+   * 访问无法还原距离, 仍算作缺失, 新的访问积累起来之后估计随之修正.
+   *
+   * @throws std::invalid_argument max_distance 为 0 时
+   */
+  void rescale(const std::uint64_t max_distance);
+
+ private:
+  static std::uint32_t hashOf(std::uint64_t key) {
+    // splitmix64 的混合函数, 取高 24 位
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return static_cast<std::uint32_t>(key >> 40);
+  }
+
+  struct Sample {
+    std::uint32_t hash;
+    std::uint32_t slot;
+  };
+
+  void sample(const std::uint64_t key, const std::uint32_t hash);
+
+  /**
+   * 把距离 (已按抽样率放大) 计入直方图
+   */
+  void record(const double distance, const double weight);
+
+  /**
+   * 时间槽用完时把存活的样本按访问先后重新编号为 0, 1, ...
+   */
+  void compact();
+
+  void fenwickAdd(std::uint32_t slot, const int delta);
+  /// 槽 [0, slot) 中存活的样本数
+  std::uint32_t fenwickPrefix(std::uint32_t slot) const;
+
+  std::uint64_t max_distance_;
+  const std::uint32_t initial_threshold_;
+  const std::uint32_t max_samples_;
+  double bucket_width_;
+
+  std::uint32_t threshold_;
+  /// 样本页 -> 散列值和最后一次访问的时间槽
+  std::unordered_map<std::uint64_t, Sample> samples_;
+  /// 按散列值排序的样本, 用于去掉散列值最大的页
+  std::set<std::pair<std::uint32_t, std::uint64_t>> by_hash_;
+  /// 每个存活样本的最后一次访问占一个时间槽, 树状数组统计槽中的样本数
+  std::vector<std::int32_t> fenwick_;
+  std::uint32_t next_slot_ = 0;
+
+  /// 按重用距离分桶的 (加权) 访问数
+  std::vector<double> histogram_;
+  /// 重用距离超过 max_distance 的访问数
+  double far_ = 0;
+  /// 第一次访问 (冷缺失) 数
+  double cold_ = 0;
+  /// 所有访问数, 包括没有抽中的
+  std::uint64_t accesses_ = 0;
+};
+
+}
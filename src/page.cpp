@@ -6,6 +6,8 @@
  */
 
 #include <cassert>
+#include <cstring>
+#include <stdexcept>
 
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
@@ -16,6 +18,21 @@
 
 namespace badgerdb {
 
+PageLayout PageLayout::pax(std::initializer_list<std::uint16_t> widths) {
+  if (widths.size() == 0 || widths.size() > MAX_COLUMNS) {
+    throw std::invalid_argument("PAX layout needs 1 to MAX_COLUMNS columns");
+  }
+  PageLayout layout;
+  layout.format = PageFormat::Pax;
+  for (const std::uint16_t width : widths) {
+    if (width == 0) {
+      throw std::invalid_argument("PAX column width must be positive");
+    }
+    layout.widths[layout.num_columns++] = width;
+  }
+  return layout;
+}
+
 Page::Page() {
   initialize();
 }
@@ -27,10 +44,10 @@ void Page::initialize() {
   header_.num_free_slots = 0;
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
-  data_.assign(DATA_SIZE, char());
+  data_.fill(char());
 }
 
-RecordId Page::insertRecord(const std::string& record_data) {
+RecordId Page::insertRecord(std::string_view record_data) {
   if (!hasSpaceForRecord(record_data)) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), getFreeSpace());
@@ -43,7 +60,13 @@ RecordId Page::insertRecord(const std::string& record_data) {
 std::string Page::getRecord(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-  return data_.substr(slot.item_offset, slot.item_length);
+  return std::string(data_.data() + slot.item_offset, slot.item_length);
+}
+
+std::string_view Page::getRecordView(const RecordId& record_id) const {
+  validateRecordId(record_id);
+  const PageSlot& slot = getSlot(record_id.slot_number);
+  return std::string_view(data_.data() + slot.item_offset, slot.item_length);
 }
 
 void Page::updateRecord(const RecordId& record_id,
@@ -71,7 +94,7 @@ void Page::deleteRecord(const RecordId& record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
   PageSlot* slot = getSlot(record_id.slot_number);
-  data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
+  std::memset(data_.data() + slot->item_offset, '\0', slot->item_length);
 
   // Compact the data by removing the hole left by this record (if necessary).
   std::uint16_t move_offset = slot->item_offset; 
@@ -90,8 +113,8 @@ void Page::deleteRecord(const RecordId& record_id,
   }
   // If we have data to move, shift it to the right.
   if (move_bytes > 0) {
-    const std::string& data_to_move = data_.substr(move_offset, move_bytes);
-    data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+    std::memmove(data_.data() + move_offset + slot->item_length,
+                 data_.data() + move_offset, move_bytes);
   }
   header_.free_space_upper_bound += slot->item_length;
 
@@ -122,7 +145,7 @@ void Page::deleteRecord(const RecordId& record_id,
   }
 }
 
-bool Page::hasSpaceForRecord(const std::string& record_data) const {
+bool Page::hasSpaceForRecord(std::string_view record_data) const {
   std::size_t record_size = record_data.length();
   if (header_.num_free_slots == 0) {
     record_size += sizeof(PageSlot);
@@ -165,7 +188,7 @@ SlotId Page::getAvailableSlot() {
 }
 
 void Page::insertRecordInSlot(const SlotId slot_number,
-                              const std::string& record_data) {
+                              std::string_view record_data) {
   if (slot_number > header_.num_slots ||
       slot_number == INVALID_SLOT) {
     throw InvalidSlotException(page_number(), slot_number);
@@ -180,7 +203,8 @@ void Page::insertRecordInSlot(const SlotId slot_number,
   slot->item_offset = header_.free_space_upper_bound - record_length;
   header_.free_space_upper_bound = slot->item_offset;
   --header_.num_free_slots;
-  data_.replace(slot->item_offset, slot->item_length, record_data);
+  std::memcpy(data_.data() + slot->item_offset, record_data.data(),
+              slot->item_length);
 }
 
 void Page::validateRecordId(const RecordId& record_id) const {
@@ -193,11 +217,11 @@ void Page::validateRecordId(const RecordId& record_id) const {
   }
 }
 
-PageIterator Page::begin() {
+PageIterator Page::begin() const {
   return PageIterator(this);
 }
 
-PageIterator Page::end() {
+PageIterator Page::end() const {
   const RecordId& end_record_id = {page_number(), Page::INVALID_SLOT};
   return PageIterator(this, end_record_id);
 }
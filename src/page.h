@@ -7,10 +7,13 @@
 
 #pragma once
 
+#include <array>
 #include <cstddef>
+#include <initializer_list>
 #include <stdint.h>
 #include <memory>
 #include <string>
+#include <string_view>
 
 #include "types.h"
 
@@ -89,8 +92,53 @@ struct PageSlot {
   std::uint16_t item_length;
 };
 
+/**
+ * @brief 页的格式, 在创建文件时逐个文件选择, 记录在文件头中.
+ */
+enum class PageFormat : std::uint16_t {
+  ///
+  /// 行式的插槽页 (Page 自身的格式): 记录是任意长度的字节串.
+  Slotted = 0,
+  ///
+  /// PAX (Partition Attributes Across): 每一列在页内有自己的 minipage,
+  /// 只读部分列的扫描只接触这些列的字节.  见 PaxPage.
+  Pax = 1,
+};
+
+/**
+ * @brief 文件中页的格式.  PAX 格式的页还需要各列的宽度 (字节数), 记录是各列
+ * 按顺序拼接而成的定长字节串.
+ */
+struct PageLayout {
+  /**
+   * PAX 格式的最大列数
+   */
+  static constexpr std::size_t MAX_COLUMNS = 32;
+
+  PageFormat format = PageFormat::Slotted;
+  std::uint16_t num_columns = 0;
+  std::array<std::uint16_t, MAX_COLUMNS> widths = {};
+
+  /**
+   * 各列宽度为 widths 的 PAX 格式
+   *
+   * @throws std::invalid_argument 没有列、列数超过 MAX_COLUMNS 或有宽度为 0 的列时
+   */
+  static PageLayout pax(std::initializer_list<std::uint16_t> widths);
+
+  bool operator==(const PageLayout& rhs) const = default;
+};
+
 class PageIterator;
 
+/**
+ * @brief 直接 I/O (O_DIRECT) 要求的缓冲区/偏移/长度对齐字节数.
+ *
+ * Page 按此对齐,因此任何 Page 对象(包括缓冲池里的帧)都可以直接作为
+ * O_DIRECT 读写的目标缓冲区.
+ */
+constexpr std::size_t PAGE_IO_ALIGNMENT = 4096;
+
 /**
  * @brief Class which represents a fixed-size database page containing records.
  *
@@ -101,7 +149,7 @@ class PageIterator;
  *
  * @warning This class is not threadsafe.
  */
-class Page {
+class alignas(PAGE_IO_ALIGNMENT) Page {
  public:
   /**
    * Page size in bytes.  If this is changed, database files created with a
@@ -134,7 +182,7 @@ class Page {
    * @param record_data  组成该记录的字节
    * @return  新插入记录的ID 
    */
-  RecordId insertRecord(const std::string& record_data);
+  RecordId insertRecord(std::string_view record_data);
 
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
@@ -146,6 +194,15 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * 与 getRecord 相同, 但不复制数据: 返回指向页内记录的视图.
+   * 视图只在页不被修改且 (对缓冲池中的页) 页仍被引用期间有效.
+   *
+   * @param record_id  ID of the record to return.
+   * @return  The record, in place.
+   */
+  std::string_view getRecordView(const RecordId& record_id) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
@@ -171,7 +228,7 @@ class Page {
    * @param record_data Bytes that compose the record.
    * @return  Whether the page can hold the data.
    */
-  bool hasSpaceForRecord(const std::string& record_data) const;
+  bool hasSpaceForRecord(std::string_view record_data) const;
 
   /**
    * Returns this page's free space in bytes.
@@ -195,12 +252,21 @@ class Page {
    */
   PageId next_page_number() const { return header_.next_page_number; }
 
+  /**
+   * 返回页的数据区 (DATA_SIZE 字节) 的起始地址.  供不使用插槽格式、
+   * 自行组织页内数据的页 (如索引节点) 使用; 对这样的页不能再调用记录相关的方法.
+   *
+   * @return  Start of the page's data area.
+   */
+  char* rawData() { return data_.data(); }
+  const char* rawData() const { return data_.data(); }
+
   /**
    * Returns an iterator at the first record in the page.
    *
    * @return  Iterator at first record of page.
    */
-  PageIterator begin();
+  PageIterator begin() const;
 
   /**
    * Returns an iterator representing the record after the last record in the
@@ -208,7 +274,7 @@ class Page {
    *
    * @return  Iterator representing record after the last record in the page.
    */
-  PageIterator end();
+  PageIterator end() const;
 
  private:
   /**
@@ -297,7 +363,7 @@ class Page {
    * @throws  SlotInUseException  Thrown when given slot is in use.
    */
   void insertRecordInSlot(const SlotId slot_number,
-                          const std::string& record_data);
+                          std::string_view record_data);
 
   /**
    * Throws an exception if the given record ID is not valid for this page
@@ -324,11 +390,16 @@ class Page {
   /**
    * Data stored on the page.  Includes bookkeeping information about slots as
    * well as actual content.
+   *
+   * 与 header_ 一起恰好占满 SIZE 字节,这样整页在内存中的映像与磁盘上的映像一致,
+   * 可以一次读写整页.
    */
-
-  std::string data_;
+  std::array<char, DATA_SIZE> data_;
 
   friend class File;
+  friend class BulkLoader;
+  friend class BufMgr;
+  friend class PredicateFilter;
   friend class PageIterator;
   friend class PageTest;
   friend class BufferTest;
@@ -338,5 +409,9 @@ static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert(sizeof(Page) == Page::SIZE,
+              "In-memory page image must match the on-disk page image.");
+static_assert(Page::SIZE % PAGE_IO_ALIGNMENT == 0,
+              "Page size must be a multiple of the direct I/O alignment.");
 
 }
@@ -36,7 +36,7 @@ class PageIterator {
    *
    * @param page  Page to iterate over.
    */
-  PageIterator(Page* page)
+  PageIterator(const Page* page)
       : page_(page)  {
     assert(page_ != NULL);
     const SlotId used_slot = getNextUsedSlot(Page::INVALID_SLOT /* start */);
@@ -50,7 +50,7 @@ class PageIterator {
    * @param page        Page to iterate over.
    * @param record_id   ID of record to start iterator at.
    */
-  PageIterator(Page* page, const RecordId& record_id)
+  PageIterator(const Page* page, const RecordId& record_id)
       : page_(page),
         current_record_(record_id) {
   }
@@ -101,6 +101,13 @@ class PageIterator {
 		return page_->getRecord(current_record_); 
 	}
 
+  /**
+   * Returns the ID of the record the iterator is currently pointing to.
+   *
+   * @return  ID of the current record.
+   */
+  const RecordId& record_id() const { return current_record_; }
+
   /**
    * Returns the next used slot in the page after the given slot or
    * Page::INVALID_SLOT if no slots are used after the given slot.
@@ -111,8 +118,8 @@ class PageIterator {
   SlotId getNextUsedSlot(const SlotId start) const {
     SlotId slot_number = Page::INVALID_SLOT;
     for (SlotId i = start + 1; i <= page_->header_.num_slots; ++i) {
-      const PageSlot* slot = page_->getSlot(i);
-      if (slot->used) {
+      const PageSlot& slot = page_->getSlot(i);
+      if (slot.used) {
         slot_number = i;
         break;
       }
@@ -124,7 +131,7 @@ class PageIterator {
   /**
    * Page we're iterating over.
    */
-  Page* page_;
+  const Page* page_;
 
   /**
    * ID of record iterator is currently pointing to.
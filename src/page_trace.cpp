@@ -0,0 +1,92 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_trace.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace badgerdb {
+
+namespace {
+
+constexpr char MAGIC[8] = {'B', 'D', 'B', 'T', 'R', 'A', 'C', 'E'};
+constexpr std::uint32_t VERSION = 1;
+constexpr std::size_t HEADER_BYTES = 16;
+constexpr std::size_t EVENT_BYTES = 10;
+constexpr std::uint8_t DIRTY_FLAG = 1;
+
+}
+
+TraceWriter::TraceWriter(const std::string& path)
+    : out_(path, std::ios::binary | std::ios::trunc) {
+  if (!out_) {
+    throw std::runtime_error("cannot open trace file " + path);
+  }
+  char header[HEADER_BYTES] = {};
+  std::memcpy(header, MAGIC, sizeof(MAGIC));
+  std::memcpy(header + sizeof(MAGIC), &VERSION, sizeof(VERSION));
+  out_.write(header, HEADER_BYTES);
+  buffer_.reserve(BUFFER_EVENTS * EVENT_BYTES);
+}
+
+TraceWriter::~TraceWriter() {
+  flush();
+}
+
+void TraceWriter::record(const TraceEvent& event) {
+  char bytes[EVENT_BYTES];
+  std::memcpy(bytes, &event.file, 4);
+  std::memcpy(bytes + 4, &event.page, 4);
+  bytes[8] = static_cast<char>(event.kind);
+  bytes[9] = static_cast<char>(event.dirty ? DIRTY_FLAG : 0);
+  buffer_.insert(buffer_.end(), bytes, bytes + EVENT_BYTES);
+  ++count_;
+  if (buffer_.size() >= BUFFER_EVENTS * EVENT_BYTES) {
+    flush();
+  }
+}
+
+void TraceWriter::flush() {
+  out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+  out_.flush();
+  buffer_.clear();
+}
+
+TraceReader::TraceReader(const std::string& path) : in_(path, std::ios::binary) {
+  char header[HEADER_BYTES];
+  std::uint32_t version = 0;
+  if (in_.read(header, HEADER_BYTES)) {
+    std::memcpy(&version, header + sizeof(MAGIC), sizeof(version));
+  }
+  if (!in_ || std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0 || version != VERSION) {
+    throw std::runtime_error("not a page trace: " + path);
+  }
+}
+
+bool TraceReader::next(TraceEvent& event) {
+  char bytes[EVENT_BYTES];
+  if (!in_.read(bytes, EVENT_BYTES)) {
+    return false;
+  }
+  std::memcpy(&event.file, bytes, 4);
+  std::memcpy(&event.page, bytes + 4, 4);
+  event.kind = static_cast<TraceEventKind>(bytes[8]);
+  event.dirty = (bytes[9] & DIRTY_FLAG) != 0;
+  return true;
+}
+
+std::vector<TraceEvent> TraceReader::readAll() {
+  std::vector<TraceEvent> events;
+  TraceEvent event;
+  while (next(event)) {
+    events.push_back(event);
+  }
+  return events;
+}
+
+}
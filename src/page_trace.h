@@ -0,0 +1,115 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 缓冲池中的一类页访问事件
+ */
+enum class TraceEventKind : std::uint8_t {
+  Pin = 0,      ///< readPage(): 引用一页
+  Unpin = 1,    ///< 放开一页, dirty 表示是否写过
+  Alloc = 2,    ///< allocPage(): 分配并引用一个新页
+  Dispose = 3,  ///< disposePage(): 删除一页
+  Flush = 4,    ///< flushFile(): 写回并换出一个文件的所有页, page 为 0
+  Reserve = 5,  ///< reserveFrames(): 预留帧, file 为第一个帧号, page 为帧数
+  Release = 6,  ///< 归还预留的帧, file 为第一个帧号, page 为帧数
+  Discard = 7,  ///< discardFile()/dropFile(): 不写回地丢弃一个文件的所有页, page 为 0
+  Close = 8,    ///< 文件关闭: 它的页被写回并移出, 之后它的编号可能属于另一个文件, page 为 0
+};
+
+/**
+ * @brief 一个页访问事件.  file 是记录时的 FileId, 只用来区分同一条踪迹中的不同文件.
+ */
+struct TraceEvent {
+  FileId file;
+  PageId page;
+  TraceEventKind kind;
+  bool dirty;
+};
+
+/**
+ * @brief 把页访问事件写成紧凑的二进制踪迹文件.
+ *
+ * 格式: 16 字节的文件头 ("BDBTRACE", 32 位版本号, 32 位保留),
+ * 之后每个事件 10 字节: 32 位文件编号, 32 位页号, 8 位事件类型, 8 位标志
+ * (第 0 位为 dirty).  整数按本机字节序.
+ *
+ * 事件先在内存中攒 BUFFER_EVENTS 个再一次写出.  本类不加锁, 由调用者 (BufMgr) 串行化.
+ */
+class TraceWriter {
+ public:
+  /**
+   * 内存中攒的事件数
+   */
+  static constexpr std::size_t BUFFER_EVENTS = 64 * 1024;
+
+  /**
+   * @param path  踪迹文件, 已存在时覆盖
+   * @throws std::runtime_error 文件无法打开时
+   */
+  explicit TraceWriter(const std::string& path);
+
+  /**
+   * 写出剩余的事件
+   */
+  ~TraceWriter();
+
+  void record(const TraceEvent& event);
+
+  /**
+   * 写出内存中的事件
+   */
+  void flush();
+
+  /**
+   * 已经记录的事件数
+   */
+  std::uint64_t size() const { return count_; }
+
+ private:
+  std::ofstream out_;
+  std::vector<char> buffer_;
+  std::uint64_t count_ = 0;
+};
+
+/**
+ * @brief 读取 TraceWriter 写的踪迹文件
+ */
+class TraceReader {
+ public:
+  /**
+   * @throws std::runtime_error 文件无法打开或不是踪迹文件时
+   */
+  explicit TraceReader(const std::string& path);
+
+  /**
+   * 读取下一个事件
+   *
+   * @return 是否读到了事件; 文件结束时为 false
+   */
+  bool next(TraceEvent& event);
+
+  /**
+   * 读取所有 (剩余的) 事件
+   */
+  std::vector<TraceEvent> readAll();
+
+ private:
+  std::ifstream in_;
+};
+
+}
@@ -0,0 +1,128 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "page_iterator.h"
+#include "thread_pool.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 记录的消费者: 每个工作线程有自己的一个, 以 (记录号, 页内记录视图) 调用.
+ * 视图只在调用期间有效.
+ */
+template<typename T>
+concept record_consumer = requires(T& consumer, const RecordId& rid, std::string_view record) {
+  consumer(rid, record);
+};
+
+/**
+ * @brief 文件中连续的一段页号 [first, last), 是并行扫描的工作单位.
+ */
+struct Morsel {
+  PageId first;
+  PageId last;
+};
+
+/**
+ * @brief 用多个线程扫描一个文件中所有记录的并行扫描.
+ *
+ * 文件的页号范围被切成每段 morsel_pages 页的 morsel, 交给工作窃取的 ThreadPool.
+ * 工作线程通过 BufMgr 引用每一页 (缓冲池未命中的读盘在 BufMgr 的锁外进行,
+ * 多个线程可以同时读盘), 把页中的记录原地交给本线程的消费者, 不复制记录.
+ * 空闲页借助文件的分配图跳过, 不会被读取.  默认每个工作线程带着自己的
+ * AccessRing 读页, 扫描不会把缓冲池中的其他页挤出去.
+ *
+ * 扫描期间不能有其他线程在该文件中分配或删除页.  记录按插槽目录取出,
+ * 所以只适用于带插槽的页, 不适用于 PAX 格式的文件.
+ */
+class ParallelScan {
+ public:
+  /**
+   * 每个 morsel 的默认页数
+   */
+  static constexpr PageId DEFAULT_MORSEL_PAGES = 64;
+
+  /**
+   * @param file          要扫描的文件
+   * @param mgr           通过它引用页的缓冲池
+   * @param pool          执行扫描的线程池
+   * @param morsel_pages  每个 morsel 的页数
+   * @param strategy      读页的方式, 默认每个工作线程只用私有的一小圈帧 (见 AccessRing)
+   * @throws std::invalid_argument 文件的页是 PAX 格式时
+   */
+  ParallelScan(File& file, BufMgr& mgr, ThreadPool& pool,
+               const PageId morsel_pages = DEFAULT_MORSEL_PAGES,
+               const AccessStrategy strategy = AccessStrategy::Sequential)
+      : file_(file), mgr_(mgr), pool_(pool),
+        morsel_pages_(std::max<PageId>(1, morsel_pages)), strategy_(strategy) {
+    if (file.layout().format == PageFormat::Pax) {
+      throw std::invalid_argument("ParallelScan does not support PAX pages: " + file.filename());
+    }
+  }
+
+  /**
+   * 把文件的页号范围切成 morsel.
+   */
+  std::vector<Morsel> morsels() {
+    std::vector<Morsel> result;
+    const PageId num_pages = file_.numPages();
+    for (PageId first = 1; first < num_pages; first += morsel_pages_) {
+      result.push_back({first, std::min<PageId>(first + morsel_pages_, num_pages)});
+    }
+    return result;
+  }
+
+  /**
+   * 执行扫描, 阻塞直到所有记录都被消费.
+   * 工作线程 w 只调用 consumers[w], 所以消费者不需要同步.
+   *
+   * @param consumers 每个工作线程一个消费者, 个数不少于 pool.size()
+   * @throws std::invalid_argument 消费者不够时
+   */
+  template<record_consumer Consumer>
+  void run(std::vector<Consumer>& consumers) {
+    if (consumers.size() < pool_.size()) {
+      throw std::invalid_argument("ParallelScan needs one consumer per worker");
+    }
+    const std::vector<bool>& used = file_.allocationMap();
+    const std::vector<Morsel> work = morsels();
+    std::vector<AccessRing> rings(pool_.size(), AccessRing(strategy_));
+    pool_.parallelFor(work.size(), [&](unsigned worker, std::size_t task) {
+      Consumer& consumer = consumers[worker];
+      const Morsel& morsel = work[task];
+      for (PageId page_number = morsel.first; page_number < morsel.last; ++page_number) {
+        if (page_number >= used.size() || !used[page_number]) {
+          continue;
+        }
+        PageView view = mgr_.readPage(file_, page_number, rings[worker]);
+        for (PageIterator iter = view->begin(); iter != view->end(); ++iter) {
+          consumer(iter.record_id(), view->getRecordView(iter.record_id()));
+        }
+      }
+    });
+  }
+
+ private:
+  File& file_;
+  BufMgr& mgr_;
+  ThreadPool& pool_;
+  const PageId morsel_pages_;
+  const AccessStrategy strategy_;
+};
+
+}
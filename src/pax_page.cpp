@@ -0,0 +1,151 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "pax_page.h"
+
+#include <cstring>
+
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_record_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+constexpr std::size_t alignUp(const std::size_t n) {
+  return (n + 7) / 8 * 8;
+}
+
+}
+
+PaxFormat::PaxFormat(const PageLayout& layout)
+    : num_columns_(layout.num_columns), row_width_(0), capacity_(0),
+      widths_(layout.widths), field_offsets_(), column_offsets_() {
+  if (layout.format != PageFormat::Pax || num_columns_ == 0 ||
+      num_columns_ > PageLayout::MAX_COLUMNS) {
+    throw std::invalid_argument("not a PAX page layout");
+  }
+  std::size_t row_width = 0;
+  for (std::size_t c = 0; c < num_columns_; ++c) {
+    field_offsets_[c] = static_cast<std::uint16_t>(row_width);
+    row_width += widths_[c];
+  }
+  if (row_width == 0 || row_width > Page::DATA_SIZE) {
+    throw std::invalid_argument("PAX row does not fit in a page");
+  }
+  row_width_ = static_cast<std::uint16_t>(row_width);
+
+  // n 条记录需要的字节数随 n 单调增加: 从不计对齐时的上界往下找第一个放得下的 n.
+  const auto bytes_for = [&](const std::size_t n) {
+    std::size_t bytes = PaxPageView::HEADER_BYTES + alignUp((n + 7) / 8);
+    for (std::size_t c = 0; c < num_columns_; ++c) {
+      bytes += alignUp(n * widths_[c]);
+    }
+    return bytes;
+  };
+  std::size_t n = (Page::DATA_SIZE - PaxPageView::HEADER_BYTES) * 8 / (8 * row_width + 1);
+  while (n > 0 && bytes_for(n) > Page::DATA_SIZE) {
+    --n;
+  }
+  if (n == 0) {
+    throw std::invalid_argument("PAX row does not fit in a page");
+  }
+  capacity_ = static_cast<SlotId>(n);
+
+  std::size_t offset = PaxPageView::HEADER_BYTES + alignUp((n + 7) / 8);
+  for (std::size_t c = 0; c < num_columns_; ++c) {
+    column_offsets_[c] = static_cast<std::uint16_t>(offset);
+    offset += alignUp(n * widths_[c]);
+  }
+}
+
+void PaxPageView::validateRecordId(const RecordId& record_id) const {
+  if (record_id.page_number != page_number_ || !present(record_id.slot_number)) {
+    throw InvalidRecordException(record_id, page_number_);
+  }
+}
+
+std::string PaxPageView::getRecord(const RecordId& record_id) const {
+  validateRecordId(record_id);
+  const std::size_t i = record_id.slot_number - 1u;
+  std::string row(format_.rowWidth(), '\0');
+  for (std::size_t c = 0; c < format_.numColumns(); ++c) {
+    const std::size_t width = format_.width(c);
+    std::memcpy(row.data() + format_.fieldOffset(c),
+                data_ + format_.columnOffset(c) + i * width, width);
+  }
+  return row;
+}
+
+std::string_view PaxPageView::getField(const RecordId& record_id, const std::size_t c) const {
+  validateRecordId(record_id);
+  const std::size_t width = format_.width(c);
+  return {data_ + format_.columnOffset(c) + (record_id.slot_number - 1u) * width, width};
+}
+
+RecordId PaxPage::insertRecord(std::string_view row) {
+  if (row.size() != format_.rowWidth()) {
+    throw std::invalid_argument("PAX record length does not match the row width");
+  }
+  if (!hasSpace()) {
+    throw InsufficientSpaceException(page_number_, row.size(), 0);
+  }
+  PaxHeader& h = header();
+  std::uint8_t* bits = presence();
+  // 有被删除的插槽时复用第一个, 否则用 end 之后的插槽.
+  std::size_t i = h.end;
+  if (h.num_records < h.end) {
+    std::size_t byte = 0;
+    while (bits[byte] == 0xFF) {
+      ++byte;
+    }
+    i = byte * 8;
+    while (bits[byte] >> (i % 8) & 1) {
+      ++i;
+    }
+  }
+  bits[i / 8] |= static_cast<std::uint8_t>(1u << (i % 8));
+  for (std::size_t c = 0; c < format_.numColumns(); ++c) {
+    const std::size_t width = format_.width(c);
+    std::memcpy(mutable_data_ + format_.columnOffset(c) + i * width,
+                row.data() + format_.fieldOffset(c), width);
+  }
+  ++h.num_records;
+  if (i + 1 > h.end) {
+    h.end = static_cast<SlotId>(i + 1);
+  }
+  return {page_number_, static_cast<SlotId>(i + 1)};
+}
+
+void PaxPage::updateField(const RecordId& record_id, const std::size_t c,
+                          std::string_view value) {
+  validateRecordId(record_id);
+  const std::size_t width = format_.width(c);
+  if (value.size() != width) {
+    throw std::invalid_argument("PAX field length does not match the column width");
+  }
+  std::memcpy(mutable_data_ + format_.columnOffset(c) + (record_id.slot_number - 1u) * width,
+              value.data(), width);
+}
+
+void PaxPage::deleteRecord(const RecordId& record_id) {
+  validateRecordId(record_id);
+  const std::size_t i = record_id.slot_number - 1u;
+  presence()[i / 8] &= static_cast<std::uint8_t>(~(1u << (i % 8)));
+  for (std::size_t c = 0; c < format_.numColumns(); ++c) {
+    const std::size_t width = format_.width(c);
+    std::memset(mutable_data_ + format_.columnOffset(c) + i * width, 0, width);
+  }
+  PaxHeader& h = header();
+  --h.num_records;
+  // 与插槽页的插槽数组一样, 末尾空出的插槽收回, 让扫描少看几项.
+  while (h.end > 0 && !present(h.end)) {
+    --h.end;
+  }
+}
+
+}
@@ -0,0 +1,226 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 由 PAX 格式的 PageLayout 算出的页内布局, 对同一个文件的所有页相同.
+ *
+ * 页的数据区 (Page::rawData()) 依次是:
+ * - 8 字节的页头: 记录数, 以及用过的最大插槽号;
+ * - 存在位图: 每个插槽一位, 为 1 表示该插槽中有记录;
+ * - 每一列一个 minipage: 第 i 个插槽的该列值在 minipage 中的第 i - 1 项.
+ *
+ * 位图和每个 minipage 都从 8 字节对齐的位置开始, 宽度为 4 或 8 的列可以
+ * 直接当作整数数组用 SIMD 处理.  capacity() 是满足以上布局的最大插槽数.
+ */
+class PaxFormat {
+ public:
+  /**
+   * @throws std::invalid_argument layout 不是 PAX 格式, 或一行宽到一页放不下时
+   */
+  explicit PaxFormat(const PageLayout& layout);
+
+  std::uint16_t numColumns() const { return num_columns_; }
+
+  /**
+   * 第 c 列的宽度
+   */
+  std::uint16_t width(const std::size_t c) const { return widths_[c]; }
+
+  /**
+   * 第 c 列在行式记录中的偏移
+   */
+  std::uint16_t fieldOffset(const std::size_t c) const { return field_offsets_[c]; }
+
+  /**
+   * 第 c 列的 minipage 在数据区中的偏移
+   */
+  std::uint16_t columnOffset(const std::size_t c) const { return column_offsets_[c]; }
+
+  /**
+   * 一行 (所有列) 的宽度
+   */
+  std::uint16_t rowWidth() const { return row_width_; }
+
+  /**
+   * 每页最多的记录数
+   */
+  SlotId capacity() const { return capacity_; }
+
+ private:
+  std::uint16_t num_columns_;
+  std::uint16_t row_width_;
+  SlotId capacity_;
+  std::array<std::uint16_t, PageLayout::MAX_COLUMNS> widths_;
+  std::array<std::uint16_t, PageLayout::MAX_COLUMNS> field_offsets_;
+  std::array<std::uint16_t, PageLayout::MAX_COLUMNS> column_offsets_;
+};
+
+/**
+ * @brief PAX 格式的页的只读视图.
+ *
+ * 记录号的插槽号从 1 开始; [1, end()] 中 present() 为真的插槽中有记录.
+ * 全 0 的数据区 (File 新分配的页) 就是一个空的 PAX 页, 不需要另外初始化.
+ * 不能对 PAX 格式的页调用 Page 自身的记录方法.
+ */
+class PaxPageView {
+ public:
+  PaxPageView(const Page& page, const PaxFormat& format)
+      : format_(format), data_(page.rawData()), page_number_(page.page_number()) {}
+
+  /**
+   * 页中的记录数
+   */
+  SlotId numRecords() const { return header().num_records; }
+
+  /**
+   * 用过的最大插槽号, 各列的 minipage 中有效的项数
+   */
+  SlotId end() const { return header().end; }
+
+  /**
+   * 插槽中是否有记录
+   */
+  bool present(const SlotId slot_number) const {
+    const std::size_t i = slot_number - 1u;
+    return slot_number != Page::INVALID_SLOT && slot_number <= end() &&
+           (presence()[i / 8] >> (i % 8) & 1) != 0;
+  }
+
+  /**
+   * 存在位图: 插槽 s 对应第 (s - 1) / 8 字节的第 (s - 1) % 8 位
+   */
+  const std::uint8_t* presence() const {
+    return reinterpret_cast<const std::uint8_t*>(data_ + HEADER_BYTES);
+  }
+
+  /**
+   * 把记录的各列拼接成行式记录返回
+   *
+   * @throws InvalidRecordException 记录号不属于本页或插槽中没有记录时
+   */
+  std::string getRecord(const RecordId& record_id) const;
+
+  /**
+   * 记录的第 c 列, 指向页内的 minipage
+   *
+   * @throws InvalidRecordException 记录号不属于本页或插槽中没有记录时
+   */
+  std::string_view getField(const RecordId& record_id, const std::size_t c) const;
+
+  /**
+   * 第 c 列的 minipage 中前 end() 项的字节, 包括已删除的插槽 (值为 0)
+   */
+  std::span<const char> column(const std::size_t c) const {
+    return {data_ + format_.columnOffset(c),
+            static_cast<std::size_t>(end()) * format_.width(c)};
+  }
+
+  /**
+   * 以 T 的数组访问第 c 列, 供扫描直接向量化处理
+   *
+   * @throws std::invalid_argument 列宽不等于 sizeof(T) 时
+   */
+  template<typename T>
+  std::span<const T> column(const std::size_t c) const {
+    static_assert(alignof(T) <= 8, "minipages are only 8-byte aligned");
+    if (format_.width(c) != sizeof(T)) {
+      throw std::invalid_argument("column width does not match the element type");
+    }
+    return {reinterpret_cast<const T*>(data_ + format_.columnOffset(c)), end()};
+  }
+
+ protected:
+  /**
+   * 数据区开头的页头
+   */
+  struct PaxHeader {
+    SlotId num_records;
+    SlotId end;
+    std::uint32_t reserved;
+  };
+
+  static constexpr std::size_t HEADER_BYTES = 8;
+  static_assert(sizeof(PaxHeader) == HEADER_BYTES);
+
+  const PaxHeader& header() const { return *reinterpret_cast<const PaxHeader*>(data_); }
+
+  /**
+   * @throws InvalidRecordException 记录号不属于本页或插槽中没有记录时
+   */
+  void validateRecordId(const RecordId& record_id) const;
+
+  const PaxFormat& format_;
+  const char* data_;
+  PageId page_number_;
+
+  friend class PaxFormat;
+};
+
+/**
+ * @brief PAX 格式的页的可写视图.
+ */
+class PaxPage : public PaxPageView {
+ public:
+  PaxPage(Page& page, const PaxFormat& format)
+      : PaxPageView(page, format), mutable_data_(page.rawData()) {}
+
+  /**
+   * 页中是否还能再放一条记录
+   */
+  bool hasSpace() const { return numRecords() < format_.capacity(); }
+
+  /**
+   * 插入一条行式记录: 各列按 PaxFormat::fieldOffset() 拆开写到各自的 minipage.
+   * 优先复用已删除记录的插槽.
+   *
+   * @param row  长度为 PaxFormat::rowWidth() 的记录
+   * @return  新记录的记录号
+   * @throws std::invalid_argument 记录长度不对时
+   * @throws InsufficientSpaceException 页已满时
+   */
+  RecordId insertRecord(std::string_view row);
+
+  /**
+   * 改写记录的第 c 列
+   *
+   * @throws std::invalid_argument value 的长度不等于列宽时
+   * @throws InvalidRecordException 记录号不属于本页或插槽中没有记录时
+   */
+  void updateField(const RecordId& record_id, const std::size_t c, std::string_view value);
+
+  /**
+   * 删除一条记录, 各列的值清为 0.  删除的是最后的插槽时 end() 随之减小.
+   *
+   * @throws InvalidRecordException 记录号不属于本页或插槽中没有记录时
+   */
+  void deleteRecord(const RecordId& record_id);
+
+ private:
+  PaxHeader& header() { return *reinterpret_cast<PaxHeader*>(mutable_data_); }
+
+  std::uint8_t* presence() {
+    return reinterpret_cast<std::uint8_t*>(mutable_data_ + HEADER_BYTES);
+  }
+
+  char* mutable_data_;
+};
+
+}
@@ -0,0 +1,321 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 定长字符串字段: 恰好占 N 字节, 不足部分以 '\0' 填充.
+ */
+template<std::size_t N>
+struct FixedString {};
+
+/**
+ * @brief 变长字符串字段: 字节放在记录的定长部分之后.
+ */
+struct VarString {};
+
+/**
+ * @brief 字段类型的编码方式.  每个字段在记录的定长部分中占 WIDTH 字节:
+ * 定长字段就是它的值, 变长字段是它在记录中的结束偏移 (16 位).
+ */
+template<typename T>
+struct FieldTraits;
+
+/**
+ * 整数, 浮点数和枚举: 按本机字节序存放, 不对齐 (用 memcpy 读写, 编译为一次访存)
+ */
+template<typename T>
+  requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+struct FieldTraits<T> {
+  static constexpr bool FIXED = true;
+  static constexpr std::size_t WIDTH = sizeof(T);
+  using value_type = T;
+
+  static T load(const char* field) {
+    T value;
+    std::memcpy(&value, field, sizeof(T));
+    return value;
+  }
+
+  static void store(char* field, const T value) { std::memcpy(field, &value, sizeof(T)); }
+};
+
+template<std::size_t N>
+struct FieldTraits<FixedString<N>> {
+  static constexpr bool FIXED = true;
+  static constexpr std::size_t WIDTH = N;
+  using value_type = std::string_view;
+
+  /**
+   * 去掉末尾填充的 '\0'
+   */
+  static std::string_view load(const char* field) {
+    const void* end = std::memchr(field, '\0', N);
+    return {field, end == nullptr ? N : static_cast<std::size_t>(static_cast<const char*>(end) - field)};
+  }
+
+  /**
+   * @throws std::length_error value 超过 N 字节时
+   */
+  static void store(char* field, const std::string_view value) {
+    if (value.size() > N) {
+      throw std::length_error("value is longer than the FixedString field");
+    }
+    std::memcpy(field, value.data(), value.size());
+    std::memset(field + value.size(), 0, N - value.size());
+  }
+};
+
+template<>
+struct FieldTraits<VarString> {
+  static constexpr bool FIXED = false;
+  static constexpr std::size_t WIDTH = sizeof(std::uint16_t);
+  using value_type = std::string_view;
+};
+
+/**
+ * 各字段在记录定长部分中的偏移, 在编译期算出
+ */
+template<typename... Fields>
+constexpr std::array<std::size_t, sizeof...(Fields)> schemaOffsets() {
+  constexpr std::size_t widths[] = {FieldTraits<Fields>::WIDTH...};
+  std::array<std::size_t, sizeof...(Fields)> offsets = {};
+  std::size_t offset = 0;
+  for (std::size_t i = 0; i < sizeof...(Fields); ++i) {
+    offsets[i] = offset;
+    offset += widths[i];
+  }
+  return offsets;
+}
+
+/**
+ * 各字段之前最近的变长字段的下标, 没有时为 sizeof...(Fields)
+ */
+template<typename... Fields>
+constexpr std::array<std::size_t, sizeof...(Fields)> schemaPreviousVar() {
+  constexpr bool fixed[] = {FieldTraits<Fields>::FIXED...};
+  std::array<std::size_t, sizeof...(Fields)> previous = {};
+  std::size_t last = sizeof...(Fields);
+  for (std::size_t i = 0; i < sizeof...(Fields); ++i) {
+    previous[i] = last;
+    if (!fixed[i]) {
+      last = i;
+    }
+  }
+  return previous;
+}
+
+/**
+ * @brief 编译期确定的记录格式.  定义一次字段类型的列表, 之后读字段不需要解析.
+ *
+ * 记录的编码: 先是定长部分, 各字段按声明顺序紧密排列, 偏移 OFFSETS 在编译期算出;
+ * 变长字段 (VarString) 在定长部分中只占 16 位, 存放它在记录中的结束偏移,
+ * 字节按声明顺序接在定长部分之后.  所以任何字段都可以 O(1) 取得:
+ * 定长字段是一次 (不对齐的) 读, 变长字段再多读一个偏移.
+ *
+ * get() 直接作用于记录视图 (如 Page::getRecordView() 返回的页内记录),
+ * 不复制记录, 也不分配内存.  定长字段的偏移 offset<I> 也可以直接用作
+ * IntPredicate 的偏移; 全是定长字段时 paxLayout() 给出对应的 PAX 格式.
+ *
+ * @code
+ * using Person = RecordSchema<std::int32_t, FixedString<16>, VarString>;
+ * const std::string record = Person::encode(42, "alice", "likes databases");
+ * std::int32_t id = Person::get<0>(view->getRecordView(rid));
+ * @endcode
+ */
+template<typename... Fields>
+class RecordSchema {
+  static_assert(sizeof...(Fields) > 0, "a schema needs at least one field");
+
+  template<typename T>
+  using value_type_of = typename FieldTraits<T>::value_type;
+
+ public:
+  static constexpr std::size_t NUM_FIELDS = sizeof...(Fields);
+
+  /**
+   * 第 I 个字段的声明类型
+   */
+  template<std::size_t I>
+  using field_type = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+  /**
+   * get<I>() 返回的类型: 算术类型本身, 或指向记录内部的 std::string_view
+   */
+  template<std::size_t I>
+  using value_type = typename FieldTraits<field_type<I>>::value_type;
+
+  /**
+   * 各字段在定长部分中的偏移
+   */
+  static constexpr std::array<std::size_t, NUM_FIELDS> OFFSETS = schemaOffsets<Fields...>();
+
+  /**
+   * 定长部分的字节数, 也是记录的最短长度
+   */
+  static constexpr std::size_t FIXED_SIZE = (FieldTraits<Fields>::WIDTH + ...);
+
+  /**
+   * 是否所有字段都是定长的 (记录长度总是 FIXED_SIZE)
+   */
+  static constexpr bool ALL_FIXED = (FieldTraits<Fields>::FIXED && ...);
+
+  template<std::size_t I>
+  static constexpr std::size_t offset = OFFSETS[I];
+
+  /**
+   * 把各字段的值编码成一条记录
+   *
+   * @throws std::length_error FixedString 的值太长, 或记录超过 16 位偏移能表示的长度时
+   */
+  static std::string encode(const value_type_of<Fields>&... values) {
+    return encodeFields(std::index_sequence_for<Fields...>{}, values...);
+  }
+
+  /**
+   * 取记录的第 I 个字段.  记录须是本格式编码的 (见 valid()), 这里不检查.
+   * 返回的 std::string_view 指向记录内部.
+   */
+  template<std::size_t I>
+  static value_type<I> get(const std::string_view record) {
+    using Traits = FieldTraits<field_type<I>>;
+    if constexpr (Traits::FIXED) {
+      return Traits::load(record.data() + OFFSETS[I]);
+    } else {
+      const std::size_t end = loadEnd(record, I);
+      const std::size_t begin =
+          PREVIOUS_VAR[I] == NUM_FIELDS ? FIXED_SIZE : loadEnd(record, PREVIOUS_VAR[I]);
+      return record.substr(begin, end - begin);
+    }
+  }
+
+  /**
+   * 取出所有字段
+   */
+  static std::tuple<value_type_of<Fields>...> decode(const std::string_view record) {
+    return decodeFields(record, std::index_sequence_for<Fields...>{});
+  }
+
+  /**
+   * 记录是否是本格式的合法编码: 不短于定长部分, 变长字段的结束偏移单调且不越界.
+   */
+  static bool valid(const std::string_view record) {
+    if (record.size() < FIXED_SIZE) {
+      return false;
+    }
+    if constexpr (ALL_FIXED) {
+      return record.size() == FIXED_SIZE;
+    } else {
+      std::size_t end = FIXED_SIZE;
+      for (std::size_t i = 0; i < NUM_FIELDS; ++i) {
+        if (!FIXED[i]) {
+          const std::size_t next = loadEnd(record, i);
+          if (next < end || next > record.size()) {
+            return false;
+          }
+          end = next;
+        }
+      }
+      return end == record.size();
+    }
+  }
+
+  /**
+   * 与本格式对应的 PAX 页格式, 每个字段一列
+   */
+  static PageLayout paxLayout()
+    requires ALL_FIXED
+  {
+    return PageLayout::pax({static_cast<std::uint16_t>(FieldTraits<Fields>::WIDTH)...});
+  }
+
+  /**
+   * @brief 一条记录的视图, 以成员函数的形式读字段
+   */
+  class View {
+   public:
+    explicit View(const std::string_view record) : record_(record) {}
+
+    template<std::size_t I>
+    value_type<I> get() const { return RecordSchema::get<I>(record_); }
+
+    std::string_view record() const { return record_; }
+
+   private:
+    std::string_view record_;
+  };
+
+ private:
+  static constexpr bool FIXED[] = {FieldTraits<Fields>::FIXED...};
+  static constexpr std::array<std::size_t, NUM_FIELDS> PREVIOUS_VAR =
+      schemaPreviousVar<Fields...>();
+
+  /**
+   * 第 i 个 (变长) 字段的结束偏移
+   */
+  static std::size_t loadEnd(const std::string_view record, const std::size_t i) {
+    return FieldTraits<std::uint16_t>::load(record.data() + OFFSETS[i]);
+  }
+
+  template<std::size_t... Is>
+  static std::string encodeFields(std::index_sequence<Is...>,
+                                  const value_type_of<Fields>&... values) {
+    std::size_t size = FIXED_SIZE;
+    ((size += FieldTraits<Fields>::FIXED ? 0 : varSize(values)), ...);
+    if (size > UINT16_MAX) {
+      throw std::length_error("record is too long for 16-bit field offsets");
+    }
+    std::string record(size, '\0');
+    std::size_t end = FIXED_SIZE;
+    (storeField<Is>(record, end, values), ...);
+    return record;
+  }
+
+  template<typename T>
+  static std::size_t varSize(const T& value) {
+    if constexpr (std::is_same_v<T, std::string_view>) {
+      return value.size();
+    } else {
+      return 0;
+    }
+  }
+
+  template<std::size_t I>
+  static void storeField(std::string& record, std::size_t& end, const value_type<I>& value) {
+    using Traits = FieldTraits<field_type<I>>;
+    if constexpr (Traits::FIXED) {
+      Traits::store(record.data() + OFFSETS[I], value);
+    } else {
+      std::memcpy(record.data() + end, value.data(), value.size());
+      end += value.size();
+      FieldTraits<std::uint16_t>::store(record.data() + OFFSETS[I],
+                                        static_cast<std::uint16_t>(end));
+    }
+  }
+
+  template<std::size_t... Is>
+  static std::tuple<value_type_of<Fields>...> decodeFields(const std::string_view record,
+                                                           std::index_sequence<Is...>) {
+    return {get<Is>(record)...};
+  }
+};
+
+}
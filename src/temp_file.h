@@ -0,0 +1,58 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#include "exceptions/file_exists_exception.h"
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 算子 (外部排序, 散列连接) 溢出到磁盘用的临时文件, 析构时关闭并删除.
+ *
+ * 文件名为 "<prefix>.<tag><n>", n 取第一个还没有被使用的编号.  同一前缀上并发的
+ * 算子各自得到不同的文件: 直接尝试创建, 文件已存在时换下一个编号.
+ */
+class TempFile {
+ public:
+  /**
+   * @param prefix  文件名前缀, 通常是算子输出文件的文件名
+   * @param tag     区分不同算子的标记
+   * @param mode    文件的 I/O 方式
+   */
+  TempFile(const std::string& prefix, const std::string& tag, const IoMode mode) {
+    for (unsigned n = 0;; ++n) {
+      name_ = prefix + "." + tag + std::to_string(n);
+      try {
+        file_ = File::create(name_, mode);
+        return;
+      } catch (const FileExistsException&) {
+      }
+    }
+  }
+
+  ~TempFile() {
+    file_.reset();
+    // 不用 File::remove(): 它在文件不存在或仍被打开时抛出, 析构函数不能抛出
+    std::remove(name_.c_str());
+  }
+
+  TempFile(const TempFile&) = delete;
+  TempFile& operator=(const TempFile&) = delete;
+
+  File& file() { return *file_; }
+
+ private:
+  std::string name_;
+  File::sptr file_;
+};
+
+}
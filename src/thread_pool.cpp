@@ -0,0 +1,137 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+ThreadPool::ThreadPool(unsigned num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  queues_.reset(new WorkerQueue[num_threads]);
+  threads_.reserve(num_threads);
+  for (unsigned i = 0; i < num_threads; ++i) {
+    threads_.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::parallelFor(const std::size_t num_tasks, const Task& fn) {
+  if (num_tasks == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> run_guard(run_mutex_);
+  const std::size_t n = threads_.size();
+  // Hand out contiguous ranges so that neighbouring tasks start on the same
+  // worker; stealing takes from the far end of a victim's range.
+  for (std::size_t w = 0; w < n; ++w) {
+    std::lock_guard<std::mutex> guard(queues_[w].mutex);
+    queues_[w].tasks.clear();
+    for (std::size_t t = num_tasks * w / n; t < num_tasks * (w + 1) / n; ++t) {
+      queues_[w].tasks.push_back(t);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    job_ = &fn;
+    error_ = nullptr;
+    active_ = static_cast<unsigned>(n);
+    ++generation_;
+  }
+  wake_.notify_all();
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return active_ == 0; });
+    job_ = nullptr;
+    error = error_;
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void ThreadPool::workerLoop(const unsigned worker) {
+  std::uint64_t seen = 0;
+  for (;;) {
+    const Task* job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+      if (stopping_) {
+        return;
+      }
+      seen = generation_;
+      job = job_;
+    }
+
+    std::size_t task;
+    while (popOrSteal(worker, task)) {
+      try {
+        (*job)(worker, task);
+      } catch (...) {
+        {
+          std::lock_guard<std::mutex> guard(mutex_);
+          if (!error_) {
+            error_ = std::current_exception();
+          }
+        }
+        // Abandon the tasks nobody has started yet.
+        for (std::size_t w = 0; w < threads_.size(); ++w) {
+          std::lock_guard<std::mutex> guard(queues_[w].mutex);
+          queues_[w].tasks.clear();
+        }
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (--active_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+}
+
+bool ThreadPool::popOrSteal(const unsigned worker, std::size_t& task) {
+  {
+    WorkerQueue& own = queues_[worker];
+    std::lock_guard<std::mutex> guard(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.front();
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+  const std::size_t n = threads_.size();
+  for (std::size_t i = 1; i < n; ++i) {
+    WorkerQueue& victim = queues_[(worker + i) % n];
+    std::lock_guard<std::mutex> guard(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+}
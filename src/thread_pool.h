@@ -0,0 +1,110 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief 常驻工作线程组成的工作窃取线程池.
+ *
+ * 每个工作线程有自己的任务队列.  parallelFor() 把编号连续的任务成段地分给各个
+ * 线程(相邻的任务通常访问相邻的数据), 线程先从自己队列的头部取任务,
+ * 队列空了再从其他线程队列的尾部窃取, 因此任务耗时不均时各线程仍能同时结束.
+ *
+ * 同一时刻只有一个 parallelFor() 在执行, 其余调用者排队等待.
+ */
+class ThreadPool {
+ public:
+  /**
+   * 任务函数: 参数为执行它的工作线程编号 (0 到 size()-1) 和任务编号.
+   */
+  using Task = std::function<void(unsigned worker, std::size_t task)>;
+
+  /**
+   * 启动工作线程
+   *
+   * @param num_threads 线程数, 为 0 时取硬件并发数
+   */
+  explicit ThreadPool(unsigned num_threads = 0);
+
+  /**
+   * 通知所有线程退出并等待它们结束
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * 工作线程数
+   */
+  unsigned size() const { return static_cast<unsigned>(threads_.size()); }
+
+  /**
+   * 用所有工作线程执行编号为 [0, num_tasks) 的任务, 阻塞直到全部完成.
+   * 如果有任务抛出异常, 剩下还没开始的任务被丢弃, 第一个异常在这里重新抛出.
+   *
+   * @param num_tasks 任务数
+   * @param fn        任务函数
+   */
+  void parallelFor(const std::size_t num_tasks, const Task& fn);
+
+ private:
+  /**
+   * 一个工作线程的任务队列, 独占缓存行以免线程之间伪共享.
+   */
+  struct alignas(64) WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::size_t> tasks;
+  };
+
+  /**
+   * 工作线程的主循环
+   */
+  void workerLoop(const unsigned worker);
+
+  /**
+   * 从自己的队列头部取一个任务, 没有的话从别的队列尾部窃取.
+   *
+   * @return 是否取到了任务
+   */
+  bool popOrSteal(const unsigned worker, std::size_t& task);
+
+  std::vector<std::thread> threads_;
+  std::unique_ptr<WorkerQueue[]> queues_;
+
+  /**
+   * 保证同一时刻只有一个 parallelFor()
+   */
+  std::mutex run_mutex_;
+
+  /**
+   * 保护下面的状态
+   */
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const Task* job_ = nullptr;
+  std::uint64_t generation_ = 0;
+  unsigned active_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr error_;
+};
+
+}
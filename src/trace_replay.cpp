@@ -0,0 +1,240 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "trace_replay.h"
+
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "buffer.h"
+#include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/page_pinned_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * 一次装载到临时文件的页数
+ */
+constexpr PageId APPEND_BATCH = 256;
+
+std::uint64_t pageKey(const FileId file, const PageId page) {
+  return (static_cast<std::uint64_t>(file) << 32) | page;
+}
+
+bool isPin(const TraceEventKind kind) {
+  return kind == TraceEventKind::Pin || kind == TraceEventKind::Alloc;
+}
+
+/**
+ * 事件的 file 是否是文件编号 (预留和归还帧的事件中是帧号)
+ */
+bool hasFile(const TraceEventKind kind) {
+  return kind != TraceEventKind::Reserve && kind != TraceEventKind::Release;
+}
+
+/**
+ * 重放中某一页上尚未放开的引用, 按放开时是否写过分开存放
+ */
+struct Pins {
+  std::deque<PageView> clean;
+  std::deque<MutablePageView> dirty;
+};
+
+}
+
+TraceReplay::TraceReplay(const std::string& trace_path, const std::string& scratch_prefix,
+                         const IoMode mode)
+    : events_(TraceReader(trace_path).readAll()) {
+  splitReusedIds();
+  pairPins();
+
+  std::map<FileId, PageId> max_page;
+  std::unordered_set<std::uint64_t> pages;
+  for (const TraceEvent& event : events_) {
+    if (isPin(event.kind)) {
+      PageId& max = max_page[event.file];
+      max = std::max(max, event.page);
+      pages.insert(pageKey(event.file, event.page));
+    }
+  }
+  distinct_pages_ = pages.size();
+
+  std::unique_ptr<Page[]> batch(new Page[APPEND_BATCH]);
+  for (const auto& [id, max] : max_page) {
+    auto temp = std::make_unique<TempFile>(scratch_prefix, "replay", mode);
+    File& file = temp->file();
+    while (file.numPages() <= max) {
+      const PageId count = std::min<PageId>(APPEND_BATCH, max + 1 - file.numPages());
+      std::fill(batch.get(), batch.get() + count, Page());
+      file.appendPages(batch.get(), count);
+    }
+    files_.emplace(id, std::move(temp));
+  }
+}
+
+void TraceReplay::pairPins() {
+  std::unordered_map<std::uint64_t, std::deque<std::size_t>> outstanding;
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < events_.size(); ++i) {
+    TraceEvent event = events_[i];
+    const std::uint64_t key = pageKey(event.file, event.page);
+    if (isPin(event.kind)) {
+      event.dirty = false;
+      outstanding[key].push_back(kept);
+    } else if (event.kind == TraceEventKind::Unpin) {
+      auto it = outstanding.find(key);
+      if (it == outstanding.end() || it->second.empty()) {
+        continue;
+      }
+      events_[it->second.front()].dirty = event.dirty;
+      it->second.pop_front();
+    }
+    events_[kept++] = event;
+  }
+  events_.resize(kept);
+}
+
+void TraceReplay::splitReusedIds() {
+  std::unordered_map<FileId, FileId> current;
+  FileId next = 0;
+  for (TraceEvent& event : events_) {
+    if (!hasFile(event.kind)) {
+      continue;
+    }
+    const FileId recorded = event.file;
+    const auto [it, added] = current.try_emplace(recorded, next);
+    if (added) {
+      ++next;
+    }
+    event.file = it->second;
+    if (event.kind == TraceEventKind::Close) {
+      current.erase(recorded);
+    }
+  }
+}
+
+ReplayResult TraceReplay::run(const std::uint32_t num_bufs, const IoCost& cost) {
+  ReplayResult result;
+  result.num_bufs = num_bufs;
+
+  BufMgr mgr(num_bufs);
+  // 在 mgr 之后构造, 先于它析构
+  std::unordered_map<std::uint64_t, Pins> pins;
+  std::unordered_map<FrameId, std::deque<FrameReservation>> reservations;
+
+  try {
+    for (const TraceEvent& event : events_) {
+      switch (event.kind) {
+        case TraceEventKind::Pin:
+        case TraceEventKind::Alloc: {
+          File& file = files_.at(event.file)->file();
+          Pins& p = pins[pageKey(event.file, event.page)];
+          if (event.kind == TraceEventKind::Alloc) {
+            // 分配不读盘: 临时文件中的页已经存在, 直接作为新页放入缓冲池
+            MutablePageView page = mgr.adoptPage(file, event.page);
+            ++result.allocs;
+            if (event.dirty) {
+              p.dirty.push_back(std::move(page));
+            } else {
+              p.clean.push_back(page.to_immut());
+            }
+          } else if (event.dirty) {
+            p.dirty.push_back(mgr.readPage<MutablePageView>(file, event.page));
+          } else {
+            p.clean.push_back(mgr.readPage(file, event.page));
+          }
+          break;
+        }
+        case TraceEventKind::Unpin: {
+          Pins& p = pins[pageKey(event.file, event.page)];
+          if (event.dirty) {
+            p.dirty.pop_front();
+          } else {
+            p.clean.pop_front();
+          }
+          break;
+        }
+        case TraceEventKind::Flush:
+        case TraceEventKind::Close: {
+          const auto it = files_.find(event.file);
+          if (it == files_.end()) {
+            break;
+          }
+          try {
+            mgr.flushFile(it->second->file());
+          } catch (const PagePinnedException&) {
+            // 记录时的 flushFile() 同样失败了
+          }
+          break;
+        }
+        case TraceEventKind::Reserve:
+          reservations[event.file].push_back(mgr.reserveFrames(event.page));
+          break;
+        case TraceEventKind::Release: {
+          auto it = reservations.find(event.file);
+          if (it != reservations.end() && !it->second.empty()) {
+            it->second.pop_front();
+          }
+          break;
+        }
+        case TraceEventKind::Discard: {
+          const auto it = files_.find(event.file);
+          if (it == files_.end()) {
+            break;
+          }
+          try {
+            mgr.discardFile(it->second->file());
+          } catch (const PagePinnedException&) {
+            // 记录时的 discardFile() 同样失败了
+          }
+          break;
+        }
+        case TraceEventKind::Dispose:
+          break;
+      }
+    }
+  } catch (const BufferExceededException&) {
+    result.exceeded = true;
+  }
+
+  // 放开剩余的引用, 写回所有脏页, 使不同大小的结果都包括全部的写
+  pins.clear();
+  reservations.clear();
+  for (auto& [id, temp] : files_) {
+    mgr.flushFile(temp->file());
+  }
+
+  const BufStats stats = mgr.getBufStats();
+  result.accesses = stats.accesses;
+  // 缓冲池把分配也计入读盘次数 (见 FileStats::diskreads), 这里只算真正的读
+  result.disk_reads = stats.diskreads - result.allocs;
+  result.disk_writes = stats.diskwrites;
+  result.hit_ratio = result.accesses == 0
+                         ? 0
+                         : static_cast<double>(stats.hits) /
+                               static_cast<double>(result.accesses);
+  result.io_seconds = (static_cast<double>(result.disk_reads) * cost.read_us +
+                       static_cast<double>(result.disk_writes) * cost.write_us) / 1e6;
+  return result;
+}
+
+std::vector<ReplayResult> TraceReplay::sweep(const std::vector<std::uint32_t>& num_bufs,
+                                             const IoCost& cost) {
+  std::vector<ReplayResult> results;
+  results.reserve(num_bufs.size());
+  for (const std::uint32_t n : num_bufs) {
+    results.push_back(run(n, cost));
+  }
+  return results;
+}
+
+}
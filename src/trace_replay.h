@@ -0,0 +1,116 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "page_trace.h"
+#include "temp_file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief 模拟 I/O 时间用的每次读写的代价
+ */
+struct IoCost {
+  double read_us = 100;
+  double write_us = 200;
+};
+
+/**
+ * @brief 一次重放的结果
+ */
+struct ReplayResult {
+  std::uint32_t num_bufs = 0;
+  /// 缓冲池访问次数 (引用和分配)
+  std::uint64_t accesses = 0;
+  /// 分配新页的次数: 计入 accesses, 不命中, 但不读盘
+  std::uint64_t allocs = 0;
+  /// 从磁盘读页的次数, 不含分配
+  std::uint64_t disk_reads = 0;
+  /// 写回次数, 包括重放结束时写回所有脏页
+  std::uint64_t disk_writes = 0;
+  /// 命中的访问所占的比例
+  double hit_ratio = 0;
+  /// disk_reads * read_us + disk_writes * write_us
+  double io_seconds = 0;
+  /// 缓冲池太小, 被引用的页放不下 (BufferExceededException), 重放提前结束
+  bool exceeded = false;
+};
+
+/**
+ * @brief 在任意大小的缓冲池上重放 BufMgr::startTrace() 记录的页访问踪迹,
+ * 得出命中率, 读写次数和模拟的 I/O 时间, 用于选择缓冲池的大小.
+ *
+ * 踪迹中的每个文件对应一个临时文件, 页数足够容纳踪迹中出现的最大页号;
+ * 重放按踪迹的顺序引用和放开这些文件的页, 所以读写是真实发生的,
+ * 缓冲池的行为 (替换策略, 写回) 与记录时相同, 只有大小不同.
+ *
+ * 放开时是否写过页在构造时就与对应的引用配对 (同一页的引用按先后配对),
+ * 写过的页用 MutablePageView 引用.  删除页的事件被忽略: 临时文件中的页保留,
+ * 之后同一页号的访问照常进行.  记录期间关闭的文件的编号会被重用, 一个编号在
+ * 关闭之前和之后的事件属于不同的临时文件.
+ */
+class TraceReplay {
+ public:
+  /**
+   * 读入踪迹并创建临时文件
+   *
+   * @param trace_path      踪迹文件
+   * @param scratch_prefix  临时文件的文件名前缀
+   * @param mode            临时文件的 I/O 方式
+   * @throws std::runtime_error 踪迹文件无法读取时
+   */
+  TraceReplay(const std::string& trace_path, const std::string& scratch_prefix,
+              const IoMode mode = IoMode::Buffered);
+
+  /**
+   * 在 num_bufs 个帧的缓冲池上重放一次
+   */
+  ReplayResult run(const std::uint32_t num_bufs, const IoCost& cost = IoCost());
+
+  /**
+   * 对每个 num_bufs 各重放一次
+   */
+  std::vector<ReplayResult> sweep(const std::vector<std::uint32_t>& num_bufs,
+                                  const IoCost& cost = IoCost());
+
+  /**
+   * 踪迹中的事件数
+   */
+  std::size_t numEvents() const { return events_.size(); }
+
+  /**
+   * 踪迹中访问过的不同页数, 缓冲池达到这个大小后只有冷启动的读
+   */
+  std::uint64_t numDistinctPages() const { return distinct_pages_; }
+
+ private:
+  /**
+   * 把每个放开事件的 dirty 标志移到与它配对的引用 (或分配) 事件上,
+   * 并删去没有配对引用的放开事件 (记录开始前就引用了的页)
+   */
+  void pairPins();
+
+  /**
+   * 把事件中的文件编号换成重放的文件编号: 记录时的编号每遇到一次关闭事件,
+   * 之后的事件就换用一个新的编号
+   */
+  void splitReusedIds();
+
+  std::vector<TraceEvent> events_;
+  std::uint64_t distinct_pages_ = 0;
+  /// 重放的文件编号 (见 splitReusedIds()) -> 临时文件
+  std::map<FileId, std::unique_ptr<TempFile>> files_;
+};
+
+}
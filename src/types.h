@@ -24,6 +24,11 @@ using SlotId = uint16_t;
  */
 using FrameId = uint32_t;
 
+/**
+ * @brief 打开的文件的紧凑编号, 由 FileRegistry 分配.
+ */
+using FileId = uint32_t;
+
 /**
  * @brief 页中记录项的标识符.
  */
@@ -0,0 +1,115 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+#include "file.h"
+
+namespace badgerdb {
+namespace test {
+
+/**
+ * @brief 检查失败时抛出, 由测试的运行器捕获并报告; 一个测试在第一个失败处结束.
+ */
+class Failure : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * 抛出 Failure, 消息为 "file:line: what"
+ */
+[[noreturn]] void fail(const char* file, const int line, const std::string& what);
+
+using TestFn = std::function<void()>;
+
+/**
+ * @brief 在静态初始化时登记一个测试, 见 BADGERDB_TEST.
+ */
+struct Registrar {
+  Registrar(std::string name, TestFn fn);
+};
+
+/**
+ * @brief 测试用的数据库文件, 在当前目录下以 "badgerdb_test." 开头; 析构时关闭并删除.
+ * 同名的文件已经存在时 (上一次运行中途退出) 先删除它.
+ */
+class ScratchFile {
+ public:
+  explicit ScratchFile(const std::string& name, const IoMode mode = IoMode::Buffered,
+                       const PageLayout& layout = PageLayout());
+  ~ScratchFile();
+
+  ScratchFile(const ScratchFile&) = delete;
+  ScratchFile& operator=(const ScratchFile&) = delete;
+
+  File& operator*() const { return *file_; }
+  File* operator->() const { return file_.get(); }
+
+  /**
+   * 文件对象本身, 供需要 File::sptr 的函数 (如 BufMgr::dropFile()) 使用
+   */
+  File::sptr& ptr() { return file_; }
+
+  const std::string& name() const { return name_; }
+
+  /**
+   * 关闭文件再重新打开, 检查写入的内容确实到了磁盘上
+   */
+  void reopen();
+
+ private:
+  std::string name_;
+  IoMode mode_;
+  File::sptr file_;
+};
+
+}
+}
+
+/**
+ * 定义并登记一个测试:
+ * @code
+ * BADGERDB_TEST(directRoundTrip, "file/direct_round_trip") {
+ *   CHECK(...);
+ * }
+ * @endcode
+ */
+#define BADGERDB_TEST(function, name)                                           \
+  static void function();                                                       \
+  static const ::badgerdb::test::Registrar function##_registrar(name, function); \
+  static void function()
+
+/**
+ * 条件不成立时使当前测试失败
+ */
+#define CHECK(condition)                                       \
+  do {                                                         \
+    if (!(condition)) {                                        \
+      ::badgerdb::test::fail(__FILE__, __LINE__, #condition); \
+    }                                                          \
+  } while (0)
+
+/**
+ * 表达式没有抛出 Exception 类型的异常时使当前测试失败
+ */
+#define CHECK_THROWS(expression, Exception)                                        \
+  do {                                                                             \
+    bool thrown_ = false;                                                          \
+    try {                                                                          \
+      static_cast<void>(expression);                                               \
+    } catch (const Exception&) {                                                   \
+      thrown_ = true;                                                              \
+    }                                                                              \
+    if (!thrown_) {                                                                \
+      ::badgerdb::test::fail(__FILE__, __LINE__, #expression " did not throw " #Exception); \
+    }                                                                              \
+  } while (0)
@@ -0,0 +1,472 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buf_pools.h"
+#include "buffer.h"
+#include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/file_open_exception.h"
+#include "exceptions/page_not_pinned_exception.h"
+#include "exceptions/page_pinned_exception.h"
+#include "page_iterator.h"
+#include "test.h"
+#include "trace_replay.h"
+
+using namespace badgerdb;
+using badgerdb::test::ScratchFile;
+
+namespace {
+
+/**
+ * 在文件末尾追加 count 个各有一条记录 "page" 的页
+ */
+void appendPages(File& file, const PageId count) {
+  std::vector<Page> pages(count);
+  for (Page& page : pages) {
+    page.insertRecord("page");
+  }
+  file.appendPages(pages.data(), count);
+}
+
+/**
+ * 页中是否有内容为 record 的记录
+ */
+bool hasRecord(const Page& page, const std::string& record) {
+  for (PageIterator it = page.begin(); it != page.end(); ++it) {
+    if (*it == record) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}
+
+BADGERDB_TEST(resizeKeepsPinnedPages, "buffer/resize_keeps_pinned_pages") {
+  ScratchFile file("resize.db");
+  appendPages(*file, 200);
+  BufMgr mgr(100);
+  std::vector<MutablePageView> held;
+  for (PageId p = 1; p <= 50; ++p) {
+    held.push_back(mgr.readPage<MutablePageView>(*file, p));
+  }
+  const Page* address = &*held[10];
+  // 被引用的帧在缩小后仍然有效, 放开时才换出
+  mgr.resize(20);
+  CHECK(mgr.size() == 20);
+  CHECK(&*held[10] == address);
+  held[10]->insertRecord("while retired");
+  held.clear();
+  CHECK(mgr.residentPages(*file) <= 20);
+  mgr.resize(300);
+  CHECK(mgr.size() == 300);
+  for (PageId p = 1; p <= 200; ++p) {
+    mgr.readPage(*file, p);
+  }
+  CHECK(mgr.residentPages(*file) == 200);
+  mgr.resize(8);
+  {
+    const FrameReservation reserved = mgr.reserveFrames(8);
+    CHECK(reserved.size() == 8);
+  }
+  mgr.flushFile(*file);
+  CHECK(hasRecord(file->readPage(11), "while retired"));
+  CHECK_THROWS(mgr.resize(0), std::invalid_argument);
+}
+
+BADGERDB_TEST(resizeKeepsMissRatioSamples, "buffer/resize_keeps_miss_ratio_samples") {
+  ScratchFile file("resize_mrc.db");
+  appendPages(*file, 2000);
+  BufMgr mgr(1000);
+  // 2000 页循环访问: 重用距离都是 2000, 只有 2000 页以上的缓存能命中
+  for (int round = 0; round < 5; ++round) {
+    for (PageId p = 1; p <= 2000; ++p) {
+      mgr.readPage(*file, p);
+    }
+  }
+  CHECK(mgr.missRatioCurve().back().hit_ratio > 0.5);
+  // 改变大小不丢掉已有的样本
+  mgr.resize(1000);
+  mgr.resize(600);
+  const std::vector<MissRatioPoint> curve = mgr.missRatioCurve();
+  CHECK(curve.back().num_bufs == 2400);
+  CHECK(curve.back().hit_ratio > 0.5);
+  CHECK(curve.front().hit_ratio == 0);
+}
+
+BADGERDB_TEST(resizeUnderLoad, "buffer/resize_under_load") {
+  ScratchFile file("resize_load.db");
+  appendPages(*file, 400);
+  BufMgr mgr(64);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (PageId i = 0; i < 2000; ++i) {
+        const PageId p = 1 + (i * 7 + t * 101) % 400;
+        if (p % 4 == t) {
+          mgr.readPage<MutablePageView>(*file, p)->insertRecord("x");
+        } else {
+          mgr.readPage(*file, p);
+        }
+      }
+    });
+  }
+  for (unsigned k = 0; k < 50; ++k) {
+    mgr.resize(10 + (k * 37) % 400);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  mgr.flushFile(*file);
+  CHECK(mgr.residentPages(*file) == 0);
+}
+
+BADGERDB_TEST(ringProtectsHotSet, "buffer/ring_protects_hot_set") {
+  ScratchFile file("ring.db");
+  appendPages(*file, 1000);
+  BufMgr mgr(256);
+  for (PageId p = 1; p <= 100; ++p) {
+    mgr.readPage(*file, p);
+    mgr.readPage(*file, p);
+  }
+  {
+    AccessRing ring;
+    for (PageId p = 101; p < 1000; ++p) {
+      mgr.readPage(*file, p, ring);
+    }
+  }
+  mgr.clearBufStats();
+  for (PageId p = 1; p <= 100; ++p) {
+    mgr.readPage(*file, p);
+  }
+  CHECK(mgr.getBufStats().hits == 100);
+
+  {
+    AccessRing ring(AccessStrategy::BulkWrite);
+    for (int i = 0; i < 500; ++i) {
+      PageId page_no;
+      mgr.allocPage(*file, page_no, ring)->insertRecord("bulk");
+    }
+  }
+  mgr.clearBufStats();
+  for (PageId p = 1; p <= 100; ++p) {
+    mgr.readPage(*file, p);
+  }
+  CHECK(mgr.getBufStats().hits == 100);
+
+  // 没有环的扫描会把热页挤出去
+  for (PageId p = 101; p < 1000; ++p) {
+    mgr.readPage(*file, p);
+  }
+  mgr.clearBufStats();
+  for (PageId p = 1; p <= 100; ++p) {
+    mgr.readPage(*file, p);
+  }
+  CHECK(mgr.getBufStats().hits < 100);
+  mgr.flushFile(*file);
+}
+
+BADGERDB_TEST(fileFrameLists, "buffer/file_frame_lists") {
+  ScratchFile a("frames_a.db");
+  ScratchFile b("frames_b.db");
+  appendPages(*a, 300);
+  appendPages(*b, 5);
+  BufMgr mgr(400);
+  for (PageId p = 1; p <= 200; ++p) {
+    if (p % 2 == 1) {
+      mgr.readPage<MutablePageView>(*a, p)->insertRecord("dirty");
+    } else {
+      mgr.readPage(*a, p);
+    }
+  }
+  for (PageId p = 1; p <= 5; ++p) {
+    mgr.readPage<MutablePageView>(*b, p);
+  }
+  CHECK(mgr.residentPages(*a) == 200 && mgr.dirtyPages(*a) == 100);
+  CHECK(mgr.residentPages(*b) == 5 && mgr.dirtyPages(*b) == 5);
+  {
+    // 被引用的脏页不写回
+    const PageView pinned = mgr.readPage(*a, 3);
+    CHECK(mgr.writeBack(*a) == 99);
+    CHECK(mgr.dirtyPages(*a) == 1);
+  }
+  CHECK(mgr.writeBack(*a) == 1);
+  CHECK(mgr.dirtyPages(*a) == 0 && mgr.residentPages(*a) == 200);
+  mgr.disposePage(*b, 2);
+  CHECK(mgr.residentPages(*b) == 4 && mgr.dirtyPages(*b) == 4);
+  {
+    const PageView pinned = mgr.readPage(*a, 150);
+    CHECK_THROWS(mgr.flushFile(*a), PagePinnedException);
+  }
+  mgr.flushFile(*a);
+  mgr.flushFile(*b);
+  CHECK(mgr.residentPages(*a) == 0 && mgr.residentPages(*b) == 0);
+  CHECK(hasRecord(a->readPage(7), "dirty"));
+}
+
+BADGERDB_TEST(discardAndDropFile, "buffer/discard_and_drop_file") {
+  ScratchFile file("drop.db");
+  appendPages(*file, 100);
+  BufMgr mgr(32);
+  for (PageId p = 1; p <= 50; ++p) {
+    mgr.readPage<MutablePageView>(*file, p)->insertRecord("discarded");
+  }
+  mgr.clearBufStats();
+  {
+    const PageView pinned = mgr.readPage(*file, 40);
+    CHECK_THROWS(mgr.discardFile(*file), PagePinnedException);
+    CHECK(mgr.residentPages(*file) == 32);
+  }
+  mgr.discardFile(*file);
+  CHECK(mgr.residentPages(*file) == 0);
+  // 不在缓冲池中的页不能放开
+  CHECK_THROWS(mgr.unPinPage(*file, 40, false), PageNotPinnedException);
+  mgr.readPage(*file, 40);
+  CHECK_THROWS(mgr.unPinPage(*file, 40, false), PageNotPinnedException);
+  CHECK(!hasRecord(file->readPage(45), "discarded"));
+
+  for (PageId p = 1; p <= 10; ++p) {
+    mgr.readPage<MutablePageView>(*file, p)->insertRecord("dropped");
+  }
+  {
+    const File::sptr other = file.ptr();
+    CHECK_THROWS(mgr.dropFile(file.ptr()), FileOpenException);
+    CHECK(file.ptr() != nullptr);
+  }
+  mgr.dropFile(file.ptr());
+  CHECK(file.ptr() == nullptr);
+  CHECK(!File::exists(file.name()));
+  CHECK(mgr.getBufStats().diskwrites == 0);
+}
+
+BADGERDB_TEST(reusedFileId, "buffer/reused_file_id") {
+  ScratchFile first("reuse_first.db");
+  appendPages(*first, 20);
+  BufMgr mgr(16);
+  BufPools pools("default", 8);
+  pools.create("other", 8);
+  pools.bind(*first, "other");
+  const FileId id = first->id();
+  mgr.readPage<MutablePageView>(*first, 3)->insertRecord("first");
+  const PageHandle handle = mgr.readPage(*first, 7).handle();
+  std::optional<PageView> pinned = mgr.readPage(*first, 5);
+  // 关闭时写回脏页; 仍被引用的帧脱离文件, 编号被新文件重用
+  first.ptr().reset();
+  ScratchFile second("reuse_second.db");
+  CHECK(second->id() == id);
+  appendPages(*second, 20);
+  CHECK(mgr.residentPages(*second) == 0 && mgr.dirtyPages(*second) == 0);
+  CHECK(!mgr.repin(handle));
+  CHECK(!hasRecord(*mgr.readPage(*second, 3), "first"));
+  CHECK(&pools.poolOf(*second) == &pools.defaultPool());
+  BufStats stats = mgr.getBufStats();
+  CHECK(stats.files[id].accesses == 1 && stats.accesses == 4);
+  CHECK(hasRecord(**pinned, "page"));
+  pinned.reset();
+  mgr.readPage<MutablePageView>(*second, 5)->insertRecord("second");
+  mgr.flushFile(*second);
+  CHECK(hasRecord(second->readPage(5), "second"));
+
+  const File::sptr reopened = File::open(first.name());
+  CHECK(hasRecord(reopened->readPage(3), "first"));
+  CHECK(!hasRecord(reopened->readPage(5), "second"));
+}
+
+BADGERDB_TEST(traceAcrossReusedId, "buffer/trace_across_reused_id") {
+  const std::string path = "badgerdb_test.reuse.trace";
+  {
+    BufMgr mgr(64);
+    mgr.startTrace(path);
+    ScratchFile first("trace_first.db");
+    appendPages(*first, 10);
+    for (PageId p = 1; p <= 10; ++p) {
+      mgr.readPage(*first, p);
+    }
+    first.ptr().reset();
+    ScratchFile second("trace_second.db");
+    appendPages(*second, 10);
+    for (PageId p = 1; p <= 10; ++p) {
+      mgr.readPage(*second, p);
+    }
+    for (int i = 0; i < 5; ++i) {
+      PageId page_no;
+      mgr.allocPage(*second, page_no);
+    }
+    mgr.stopTrace();
+  }
+  // 编号相同的两个文件在重放中是不同的文件, 第二个文件的页不会命中; 分配不读盘
+  TraceReplay replay(path, "badgerdb_test.replay");
+  CHECK(replay.numDistinctPages() == 25);
+  const ReplayResult result = replay.run(64);
+  CHECK(result.accesses == 25 && result.allocs == 5);
+  CHECK(result.disk_reads == 20);
+  std::remove(path.c_str());
+}
+
+BADGERDB_TEST(repinByHandle, "buffer/repin_by_handle") {
+  ScratchFile file("repin.db");
+  appendPages(*file, 100);
+  BufMgr mgr(8);
+  PageHandle handle;
+  {
+    const MutablePageView view = mgr.readPage<MutablePageView>(*file, 5);
+    handle = view.handle();
+    const PageView immutable = view.to_immut();
+    CHECK(immutable.handle().frame == handle.frame);
+  }
+  CHECK(mgr.dirtyPages(*file) == 1);
+  {
+    const std::optional<PageView> view = mgr.repin(handle);
+    CHECK(view && (*view)->page_number() == 5);
+  }
+  CHECK(mgr.repin<MutablePageView>(handle).has_value());
+  // 页被换出后句柄失效
+  for (PageId p = 10; p < 40; ++p) {
+    mgr.readPage(*file, p);
+  }
+  CHECK(!mgr.repin(handle));
+  handle = mgr.readPage(*file, 5).handle();
+  mgr.flushFile(*file);
+  CHECK(!mgr.repin(handle));
+}
+
+BADGERDB_TEST(optimisticReads, "buffer/optimistic_reads") {
+  ScratchFile file("optimistic.db");
+  appendPages(*file, 64);
+  BufMgr mgr(32);
+  const auto ignore = [](const Page&) {};
+  PageHandle handle;
+  {
+    MutablePageView view = mgr.readPage<MutablePageView>(*file, 1);
+    std::memset(view->rawData(), 0, 64);
+    handle = view.handle();
+    // 有可变视图时乐观读失败
+    CHECK(!mgr.tryReadOptimistic(handle, ignore));
+  }
+  CHECK(mgr.tryReadOptimistic(handle, ignore));
+  {
+    const PageView view = mgr.readPage(*file, 1);
+    CHECK(mgr.tryReadOptimistic(handle, ignore));
+  }
+
+  // 写者让页中的 8 个整数保持相等; 验证成功的读不应看到不一致的内容
+  std::atomic<bool> stop{false};
+  std::atomic<long> torn{0};
+  std::thread writer([&] {
+    for (std::uint64_t i = 1; i < 20000; ++i) {
+      MutablePageView view = mgr.readPage<MutablePageView>(*file, 1);
+      // readOptimistic() 失败时加共享锁读, 写者要加排他锁
+      const std::unique_lock<std::shared_mutex> lock(view.latch());
+      auto* words = reinterpret_cast<std::uint64_t*>(view->rawData());
+      for (int k = 0; k < 8; ++k) {
+        words[k] = i;
+      }
+    }
+    stop = true;
+  });
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; ++t) {
+    readers.emplace_back([&] {
+      PageHandle hint = handle;
+      while (!stop) {
+        const auto words = mgr.readOptimistic(*file, 1, hint, [](const Page& page) {
+          std::array<std::uint64_t, 8> copy;
+          std::memcpy(copy.data(), page.rawData(), sizeof(copy));
+          return copy;
+        });
+        for (int k = 1; k < 8; ++k) {
+          if (words[k] != words[0]) {
+            ++torn;
+          }
+        }
+      }
+    });
+  }
+  writer.join();
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  CHECK(torn == 0);
+  CHECK(mgr.getBufStats().optimistic_reads > 0);
+
+  // 换出使句柄失效
+  handle = mgr.readPage(*file, 2).handle();
+  mgr.flushFile(*file);
+  CHECK(!mgr.tryReadOptimistic(handle, ignore));
+}
+
+BADGERDB_TEST(staleHandleAfterShrinkAndGrow, "buffer/stale_handle_after_shrink_and_grow") {
+  ScratchFile file("stale_handle.db");
+  appendPages(*file, 300);
+  const auto ignore = [](const Page&) {};
+  for (const std::uint32_t large : {64u, 8u}) {
+    BufMgr mgr(4);
+    mgr.resize(large);
+    // 填满扩大的帧, 取最后一个帧中的页的句柄
+    PageHandle handle;
+    for (PageId p = 1; p <= large; ++p) {
+      const PageView view = mgr.readPage(*file, p);
+      if (view.handle().frame == large - 1) {
+        handle = view.handle();
+      }
+    }
+    CHECK(handle.frame == large - 1);
+    CHECK(mgr.tryReadOptimistic(handle, ignore));
+    mgr.resize(4);
+    mgr.resize(large);
+    // 重新启用的帧缓存别的页, 句柄不应读到它们
+    for (PageId p = 100; p < 100 + 2 * large; ++p) {
+      mgr.readPage(*file, p);
+    }
+    CHECK(!mgr.tryReadOptimistic(handle, ignore));
+    CHECK(!mgr.repin(handle));
+    mgr.flushFile(*file);
+  }
+}
+
+BADGERDB_TEST(bufPoolsRouting, "buffer/buf_pools_routing") {
+  ScratchFile heap("pools_heap.db");
+  ScratchFile index("pools_index.db");
+  appendPages(*heap, 200);
+  appendPages(*index, 10);
+  BufPools pools("heap", 16);
+  pools.create("index", 10);
+  CHECK_THROWS(pools.create("index", 3), std::invalid_argument);
+  pools.readPage<MutablePageView>(*index, 3)->insertRecord("before bind");
+  pools.bind(*index, "index");
+  CHECK(&pools.poolOf(*index) == &pools.pool("index"));
+  CHECK(&pools.poolOf(*heap) == &pools.defaultPool());
+  for (PageId p = 1; p <= 10; ++p) {
+    pools.readPage(*index, p);
+  }
+  pools.clearBufStats();
+  for (PageId p = 1; p <= 200; ++p) {
+    pools.readPage(*heap, p);
+  }
+  for (PageId p = 1; p <= 10; ++p) {
+    pools.readPage(*index, p);
+  }
+  // 扫描堆文件不影响索引池
+  const BufStats index_stats = pools.pool("index").getBufStats();
+  CHECK(index_stats.hits == 10 && index_stats.misses == 0);
+  BufStats all = pools.getBufStats();
+  CHECK(all.accesses == 210 && all.files[index->id()].hits == 10);
+  CHECK(hasRecord(index->readPage(3), "before bind"));
+  pools.unbind(*index);
+  pools.unbind(*heap);
+  CHECK(&pools.poolOf(*index) == &pools.defaultPool());
+}
@@ -0,0 +1,41 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "event_trace.h"
+#include "test.h"
+
+using namespace badgerdb;
+
+BADGERDB_TEST(threadsReuseRings, "event_trace/threads_reuse_rings") {
+  EventTracer::start();
+  // 先后结束的线程重用同一个环, 而不是每个线程留下一个
+  for (int i = 0; i < 16; ++i) {
+    std::thread([] {
+      const std::uint64_t begin = EventTracer::now();
+      EventTracer::record("worker", begin, begin + 1);
+    }).join();
+  }
+  EventTracer::stop();
+  std::ostringstream out;
+  EventTracer::writeChromeTrace(out);
+  const std::string json = out.str();
+  std::set<std::string> tids;
+  std::size_t events = 0;
+  for (std::size_t pos = json.find("\"worker\""); pos != std::string::npos;
+       pos = json.find("\"worker\"", pos + 1)) {
+    const std::size_t tid = json.find("\"tid\":", pos) + 6;
+    tids.insert(json.substr(tid, json.find(',', tid) - tid));
+    ++events;
+  }
+  CHECK(events == 16);
+  CHECK(tids.size() == 1);
+}
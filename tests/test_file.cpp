@@ -0,0 +1,118 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <csignal>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "buffer.h"
+#include "exceptions/invalid_page_exception.h"
+#include "file.h"
+#include "file_iterator.h"
+#include "test.h"
+
+using namespace badgerdb;
+using badgerdb::test::ScratchFile;
+
+BADGERDB_TEST(directRoundTrip, "file/direct_round_trip") {
+  for (const IoMode mode : {IoMode::Buffered, IoMode::Direct}) {
+    ScratchFile file("direct.db", mode);
+    for (int i = 0; i < 50; ++i) {
+      Page page = file->allocatePage();
+      page.insertRecord("page " + std::to_string(page.page_number()));
+      file->writePage(page);
+    }
+    file.reopen();
+    for (PageId p = 1; p <= 50; ++p) {
+      CHECK(file->readPage(p).getRecord({p, 1}) == "page " + std::to_string(p));
+    }
+    // 直接读进调用者的页, 如缓冲池的帧
+    Page frame;
+    file->readPage(7, frame);
+    CHECK(frame.page_number() == 7 && frame.getRecord({7, 1}) == "page 7");
+  }
+}
+
+BADGERDB_TEST(writeErrorsThrow, "file/write_errors_throw") {
+  // 忽略 SIGXFSZ 时, 超出 RLIMIT_FSIZE 的写入失败 (EFBIG)
+  rlimit old_limit;
+  getrlimit(RLIMIT_FSIZE, &old_limit);
+  const auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+  for (const IoMode mode : {IoMode::Buffered, IoMode::Direct}) {
+    ScratchFile file("write_error.db", mode);
+    rlimit limit = old_limit;
+    limit.rlim_cur = Page::SIZE;  // 只容得下文件头
+    setrlimit(RLIMIT_FSIZE, &limit);
+    CHECK_THROWS(file->allocatePage(), std::runtime_error);
+    setrlimit(RLIMIT_FSIZE, &old_limit);
+  }
+  std::signal(SIGXFSZ, old_handler);
+}
+
+BADGERDB_TEST(openChecksFormat, "file/open_checks_format") {
+  ScratchFile file("format.db");
+  file->writePage(file->allocatePage());
+  file.reopen();
+  CHECK(file->numPages() == 2);
+
+  // 之前格式的文件以页数开头, 后面紧接着第 1 页
+  const auto overwriteHeader = [&](const std::uint32_t first, const std::uint32_t second) {
+    std::fstream stream(file.name(), std::ios::in | std::ios::out | std::ios::binary);
+    stream.write(reinterpret_cast<const char*>(&first), sizeof(first));
+    stream.write(reinterpret_cast<const char*>(&second), sizeof(second));
+  };
+  file.ptr().reset();
+  overwriteHeader(2, 1);
+  CHECK_THROWS(file.reopen(), std::invalid_argument);
+  overwriteHeader(FileHeader::MAGIC, FileHeader::VERSION + 1);
+  CHECK_THROWS(file.reopen(), std::invalid_argument);
+  overwriteHeader(FileHeader::MAGIC, FileHeader::VERSION);
+  file.reopen();
+  CHECK(file->numPages() == 2);
+}
+
+BADGERDB_TEST(poolIoSkipsHeaders, "file/pool_io_skips_headers") {
+  ScratchFile file("headers.db");
+  std::vector<Page> pages(40);
+  file->appendPages(pages.data(), 40);
+  file.reopen();
+  CHECK(file->numPages() == 41);
+  BufMgr mgr(8);
+  file->ioStats().clear();
+  // 未命中和写回都不读写文件头和页头
+  for (PageId p = 1; p <= 40; ++p) {
+    mgr.readPage<MutablePageView>(*file, p)->insertRecord("x");
+  }
+  mgr.flushFile(*file);
+  CHECK(file->ioStats().bytes(IoOp::HeaderRead) == 0);
+  CHECK(file->ioStats().bytes(IoOp::HeaderWrite) == 0);
+
+  // 页在缓冲池中时删除它的后继又分配新页: 写回不能用读入时的后继页号覆盖链表
+  {
+    const MutablePageView held = mgr.readPage<MutablePageView>(*file, 10);
+    file->deletePage(11);
+    file->deletePage(12);
+    file->allocatePage();
+  }
+  mgr.flushFile(*file);
+  PageId used = 0;
+  PageId previous = 0;
+  bool sorted = true;
+  for (FileIterator it = file->begin(); it != file->end(); ++it) {
+    sorted &= (*it).page_number() > previous;
+    previous = (*it).page_number();
+    ++used;
+  }
+  CHECK(sorted && used == 39);
+  CHECK_THROWS(file->readPage(11), InvalidPageException);
+  CHECK(file->readPage(12).page_number() == 12);
+}
@@ -0,0 +1,193 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "btree_index.h"
+#include "hash_index.h"
+#include "test.h"
+
+using namespace badgerdb;
+using badgerdb::test::ScratchFile;
+
+namespace {
+
+RecordId ridOf(const std::int64_t key) {
+  return RecordId{static_cast<PageId>(key % 100000 + 1), static_cast<SlotId>(key % 7 + 1)};
+}
+
+bool sameRecord(const std::optional<RecordId>& got, const RecordId& expected) {
+  return got && got->page_number == expected.page_number && got->slot_number == expected.slot_number;
+}
+
+}
+
+BADGERDB_TEST(btreeRoundTrip, "index/btree_round_trip") {
+  ScratchFile file("btree.idx");
+  std::map<BTreeIndex::Key, RecordId> expected;
+  {
+    BufMgr mgr(64);
+    BTreeIndex index(*file, mgr);
+    constexpr unsigned THREADS = 4;
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < THREADS; ++t) {
+      threads.emplace_back([&, t] {
+        std::mt19937 rng(t);
+        for (int i = 0; i < 5000; ++i) {
+          // 各线程的键互不相同 (模 THREADS 余 t)
+          const BTreeIndex::Key key = static_cast<BTreeIndex::Key>(rng() % 1000000) * THREADS + t;
+          index.insert(key, ridOf(key));
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    for (unsigned t = 0; t < THREADS; ++t) {
+      std::mt19937 rng(t);
+      for (int i = 0; i < 5000; ++i) {
+        const BTreeIndex::Key key = static_cast<BTreeIndex::Key>(rng() % 1000000) * THREADS + t;
+        expected.emplace(key, ridOf(key));
+      }
+    }
+    CHECK(index.height() > 1);
+    CHECK(!index.insert(expected.begin()->first, RecordId{1, 1}));
+
+    {
+      BTreeScan scan = index.scan(INT64_MIN, INT64_MAX);
+      BTreeIndex::Key key;
+      RecordId rid;
+      auto it = expected.begin();
+      while (scan.next(key, rid)) {
+        CHECK(it != expected.end() && key == it->first);
+        ++it;
+      }
+      CHECK(it == expected.end());
+    }
+
+    // 删除一半的键
+    std::size_t i = 0;
+    for (auto entry = expected.begin(); entry != expected.end(); ++i) {
+      if (i % 2 == 0) {
+        CHECK(index.remove(entry->first));
+        entry = expected.erase(entry);
+      } else {
+        ++entry;
+      }
+    }
+    CHECK(!index.remove(-1));
+    mgr.flushFile(*file);
+    // 键已存在的插入和找不到键的删除不改动叶子, 不留下脏页
+    CHECK(!index.insert(expected.begin()->first, RecordId{1, 1}));
+    CHECK(!index.remove(-1));
+    CHECK(mgr.dirtyPages(*file) == 0);
+  }
+
+  file.reopen();
+  BufMgr mgr(16);
+  BTreeIndex index(*file, mgr);
+  for (const auto& [key, rid] : expected) {
+    CHECK(sameRecord(index.lookup(key), rid));
+  }
+  CHECK(!index.lookup(-1));
+  mgr.flushFile(*file);
+}
+
+BADGERDB_TEST(btreeBulkLoad, "index/btree_bulk_load") {
+  ScratchFile file("btree_bulk.idx");
+  std::vector<BTreeIndex::Entry> entries;
+  for (BTreeIndex::Key key = 0; key < 100000; key += 2) {
+    entries.push_back({key, ridOf(key)});
+  }
+  BTreeIndex::bulkLoad(*file, entries, 0.8);
+  BufMgr mgr(64);
+  BTreeIndex index(*file, mgr);
+  for (const auto& [key, rid] : entries) {
+    CHECK(sameRecord(index.lookup(key), rid));
+    CHECK(!index.lookup(key + 1));
+  }
+  CHECK(index.insert(1, ridOf(1)));
+  CHECK(sameRecord(index.lookup(1), ridOf(1)));
+  mgr.flushFile(*file);
+
+  ScratchFile unsorted("btree_unsorted.idx");
+  const std::vector<BTreeIndex::Entry> bad = {{2, RecordId{}}, {1, RecordId{}}};
+  CHECK_THROWS(BTreeIndex::bulkLoad(*unsorted, bad), std::invalid_argument);
+}
+
+BADGERDB_TEST(btreeSplitDirtyPages, "index/btree_split_dirty_pages") {
+  // 填满的叶子和未满的内部节点, 至少三层: 叶子的父节点不是根
+  ScratchFile file("btree_split.idx");
+  std::vector<BTreeIndex::Entry> entries;
+  for (BTreeIndex::Key key = 0; key < 800000; key += 2) {
+    entries.push_back({key, ridOf(key)});
+  }
+  BTreeIndex::bulkLoad(*file, entries, 1.0);
+  BufMgr mgr(64);
+  BTreeIndex index(*file, mgr);
+  const std::uint32_t height = index.height();
+  CHECK(height >= 3);
+
+  // 在最后一个叶子末尾插入, 直到它分裂: 之前每次只改动叶子,
+  // 分裂时只改动叶子, 新的叶子和父节点, 根和其它祖先保持干净
+  std::uint32_t dirty = 1;
+  for (BTreeIndex::Key key = 800000; dirty == 1; ++key) {
+    mgr.flushFile(*file);
+    CHECK(index.insert(key, ridOf(key)));
+    dirty = mgr.dirtyPages(*file);
+  }
+  CHECK(dirty == 3);
+  CHECK(index.height() == height);
+  mgr.flushFile(*file);
+}
+
+BADGERDB_TEST(hashIndexRoundTrip, "index/hash_index_round_trip") {
+  ScratchFile file("hash.idx");
+  constexpr std::int64_t KEYS = 40000;
+  {
+    BufMgr mgr(64);
+    HashIndex index(*file, mgr);
+    std::vector<std::thread> threads;
+    for (std::int64_t t = 0; t < 4; ++t) {
+      threads.emplace_back([&, t] {
+        for (std::int64_t i = t; i < KEYS; i += 4) {
+          index.insert(i * 7, ridOf(i));
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    CHECK(index.globalDepth() > 0);
+    CHECK(!index.insert(7, RecordId{}));
+    for (std::int64_t i = 0; i < KEYS; i += 2) {
+      CHECK(index.remove(i * 7));
+    }
+    CHECK(!index.remove(0));
+    mgr.flushFile(*file);
+    // 键已存在的插入和找不到键的删除不改动桶, 不留下脏页
+    CHECK(!index.insert(7, RecordId{}));
+    CHECK(!index.remove(0));
+    CHECK(mgr.dirtyPages(*file) == 0);
+  }
+
+  file.reopen();
+  BufMgr mgr(16);
+  HashIndex index(*file, mgr);
+  for (std::int64_t i = 0; i < KEYS; ++i) {
+    if (i % 2 == 1) {
+      CHECK(sameRecord(index.lookup(i * 7), ridOf(i)));
+    } else {
+      CHECK(!index.lookup(i * 7));
+    }
+    CHECK(!index.lookup(i * 7 + 3));
+  }
+  mgr.flushFile(*file);
+}
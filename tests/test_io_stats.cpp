@@ -0,0 +1,121 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <latch>
+#include <thread>
+#include <vector>
+
+#include "file_io_stats.h"
+#include "hdr_histogram.h"
+#include "test.h"
+
+using namespace badgerdb;
+using badgerdb::test::ScratchFile;
+
+BADGERDB_TEST(histogramBuckets, "io_stats/histogram_buckets") {
+  CHECK(HdrHistogram::bucketOf(63) == 63);
+  CHECK(HdrHistogram::bucketOf(64) == 64 && HdrHistogram::bucketOf(65) == 64);
+  CHECK(HdrHistogram::bucketOf(66) == 65);
+  CHECK(HdrHistogram::highestValueOf(63) == 63 && HdrHistogram::highestValueOf(64) == 65);
+  // 每个桶的上界落在这个桶里, 再加 1 落在下一个桶里
+  for (unsigned b = 0; b + 1 < HdrHistogram::NUM_BUCKETS; ++b) {
+    CHECK(HdrHistogram::bucketOf(HdrHistogram::highestValueOf(b)) == b);
+    CHECK(HdrHistogram::bucketOf(HdrHistogram::highestValueOf(b) + 1) == b + 1);
+  }
+  CHECK(HdrHistogram::bucketOf(HdrHistogram::MAX_VALUE) == HdrHistogram::NUM_BUCKETS - 1);
+  CHECK(HdrHistogram::highestValueOf(HdrHistogram::NUM_BUCKETS - 1) == HdrHistogram::MAX_VALUE);
+
+  // 超出范围的值计入最后一个桶
+  HdrHistogram histogram;
+  histogram.record(HdrHistogram::MAX_VALUE + 1000);
+  CHECK(histogram.max() == HdrHistogram::MAX_VALUE);
+  CHECK(histogram.percentile(100) == HdrHistogram::MAX_VALUE);
+}
+
+BADGERDB_TEST(histogramPercentiles, "io_stats/histogram_percentiles") {
+  HdrHistogram histogram;
+  CHECK(histogram.percentile(50) == 0 && histogram.mean() == 0);
+  for (std::uint64_t v = 1; v <= 1000; ++v) {
+    histogram.record(v);
+  }
+  CHECK(histogram.count() == 1000 && histogram.sum() == 500500 && histogram.max() == 1000);
+  CHECK(histogram.mean() == 500.5);
+  // 结果是所在桶的上界: 500 在 [496, 503] 中, 990 在 [976, 991] 中
+  CHECK(histogram.percentile(0) == 1);
+  CHECK(histogram.percentile(50) == 503);
+  CHECK(histogram.percentile(99) == 991);
+  CHECK(histogram.percentile(100) == 1000);
+  histogram.clear();
+  CHECK(histogram.count() == 0 && histogram.percentile(50) == 0);
+}
+
+BADGERDB_TEST(queueDepth, "io_stats/queue_depth") {
+  FileIoStats stats;
+  {
+    const FileIoStats::Timer outer(stats, IoOp::Read, 100);
+    const FileIoStats::Timer inner(stats, IoOp::Read, 100);
+  }
+  CHECK(stats.queueDepth().count() == 2 && stats.queueDepth().max() == 2);
+  CHECK(stats.latency(IoOp::Read).count() == 2 && stats.bytes(IoOp::Read) == 200);
+
+  // 所有线程的计时器都开始之后才结束: 最后开始的一个看到的深度是线程数
+  constexpr unsigned THREADS = 4;
+  stats.clear();
+  std::latch started(THREADS);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&] {
+      const FileIoStats::Timer timer(stats, IoOp::Read, Page::SIZE);
+      started.arrive_and_wait();
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  CHECK(stats.queueDepth().count() == THREADS && stats.queueDepth().max() == THREADS);
+  CHECK(stats.queueDepth().percentile(0) == 1);
+
+  // 文件上并发的读者: 每次读都计入, 结束后没有进行中的操作
+  ScratchFile file("io_stats.db");
+  for (int i = 0; i < 64; ++i) {
+    file->allocatePage();
+  }
+  file->ioStats().clear();
+  threads.clear();
+  for (unsigned t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&, t] {
+      for (PageId p = 1; p <= 64; ++p) {
+        file->readPage(1 + (p + t * 16) % 64);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const FileIoStats& io = file->ioStats();
+  CHECK(io.latency(IoOp::Read).count() == THREADS * 64);
+  CHECK(io.bytes(IoOp::Read) == THREADS * 64 * Page::SIZE);
+  CHECK(io.queueDepth().max() >= 1 && io.queueDepth().max() <= THREADS);
+  file->ioStats().clear();
+  file->readPage(1);
+  CHECK(io.queueDepth().max() == 1);
+}
+
+BADGERDB_TEST(writeAndSync, "io_stats/write_and_sync") {
+  for (const IoMode mode : {IoMode::Buffered, IoMode::Direct}) {
+    ScratchFile file("io_sync.db", mode);
+    Page page = file->allocatePage();
+    file->ioStats().clear();
+    // 流的冲刷计入写, 只有 sync() 计入 Sync
+    file->writePage(page);
+    const FileIoStats& io = file->ioStats();
+    CHECK(io.latency(IoOp::Write).count() == 1 && io.bytes(IoOp::Write) == Page::SIZE);
+    CHECK(io.latency(IoOp::Sync).count() == 0);
+    file->sync();
+    CHECK(io.latency(IoOp::Sync).count() == 1 && io.bytes(IoOp::Sync) == 0);
+  }
+}
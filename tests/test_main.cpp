@@ -0,0 +1,101 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace badgerdb {
+namespace test {
+
+namespace {
+
+struct Test {
+  std::string name;
+  TestFn fn;
+};
+
+std::vector<Test>& registry() {
+  static std::vector<Test> tests;
+  return tests;
+}
+
+}
+
+void fail(const char* file, const int line, const std::string& what) {
+  throw Failure(std::string(file) + ":" + std::to_string(line) + ": " + what);
+}
+
+Registrar::Registrar(std::string name, TestFn fn) {
+  registry().push_back({std::move(name), std::move(fn)});
+}
+
+ScratchFile::ScratchFile(const std::string& name, const IoMode mode, const PageLayout& layout)
+    : name_("badgerdb_test." + name), mode_(mode) {
+  if (File::exists(name_)) {
+    File::remove(name_);
+  }
+  file_ = File::create(name_, mode, layout);
+}
+
+ScratchFile::~ScratchFile() {
+  file_.reset();
+  if (File::exists(name_) && !File::isOpen(name_)) {
+    File::remove(name_);
+  }
+}
+
+void ScratchFile::reopen() {
+  file_.reset();
+  file_ = File::open(name_, mode_);
+}
+
+}
+}
+
+int main(int argc, char** argv) {
+  using namespace badgerdb::test;
+  std::string_view filter;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg.starts_with("--filter=")) {
+      filter = arg.substr(9);
+    } else {
+      std::fprintf(stderr, "usage: %s [--filter=<substring>]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  // 按名字运行, 同一目录 (如 buffer/) 下的测试排在一起
+  std::stable_sort(registry().begin(), registry().end(),
+                   [](const Test& a, const Test& b) { return a.name < b.name; });
+  int run = 0;
+  int failed = 0;
+  for (const Test& test : registry()) {
+    if (test.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    ++run;
+    try {
+      test.fn();
+      std::printf("ok    %s\n", test.name.c_str());
+    } catch (const Failure& failure) {
+      ++failed;
+      std::printf("FAIL  %s\n      %s\n", test.name.c_str(), failure.what());
+    } catch (const std::exception& e) {
+      ++failed;
+      std::printf("FAIL  %s\n      unexpected exception: %s\n", test.name.c_str(), e.what());
+    }
+  }
+  std::printf("%d tests, %d failed\n", run, failed);
+  return failed == 0 ? 0 : 1;
+}
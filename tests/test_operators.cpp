@@ -0,0 +1,305 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "bulk_loader.h"
+#include "external_sort.h"
+#include "file_iterator.h"
+#include "filter_scan.h"
+#include "hash_join.h"
+#include "page_iterator.h"
+#include "parallel_scan.h"
+#include "temp_file.h"
+#include "test.h"
+#include "thread_pool.h"
+
+using namespace badgerdb;
+using badgerdb::test::ScratchFile;
+
+namespace {
+
+/**
+ * 记录的前 8 个字节是它的键
+ */
+std::uint64_t keyOf(std::string_view record) {
+  std::uint64_t key;
+  std::memcpy(&key, record.data(), sizeof(key));
+  return key;
+}
+
+std::string recordOf(const std::uint64_t key, const std::string& tail) {
+  std::string record(sizeof(key), '\0');
+  std::memcpy(record.data(), &key, sizeof(key));
+  return record + tail;
+}
+
+/**
+ * 文件中所有记录, 按页号和插槽号的顺序
+ */
+std::vector<std::string> recordsOf(File& file) {
+  std::vector<std::string> records;
+  for (FileIterator it = file.begin(); it != file.end(); ++it) {
+    const Page page = *it;
+    for (PageIterator record = page.begin(); record != page.end(); ++record) {
+      records.push_back(*record);
+    }
+  }
+  return records;
+}
+
+}
+
+BADGERDB_TEST(bulkLoaderRoundTrip, "operators/bulk_loader_round_trip") {
+  for (const IoMode mode : {IoMode::Buffered, IoMode::Direct}) {
+    ScratchFile file("bulk.db", mode);
+    file->allocatePage();
+    std::vector<RecordId> rids;
+    {
+      BulkLoader loader(*file, 16);
+      for (int i = 0; i < 20000; ++i) {
+        rids.push_back(loader.insertRecord("record-" + std::to_string(i)));
+      }
+      loader.finish();
+    }
+    file.reopen();
+    const std::vector<std::string> records = recordsOf(*file);
+    CHECK(records.size() == rids.size());
+    for (std::size_t i = 0; i < rids.size(); i += 997) {
+      CHECK(file->readPage(rids[i].page_number).getRecord(rids[i]) == "record-" + std::to_string(i));
+    }
+    // 装载之后照常分配页
+    const Page page = file->allocatePage();
+    CHECK(page.page_number() == file->numPages() - 1);
+  }
+
+  // 装载期间别人分配了页: 这批页不写出, 别人的页不被覆盖
+  ScratchFile file("bulk_conflict.db");
+  BulkLoader loader(*file);
+  loader.insertRecord("loaded");
+  Page page = file->allocatePage();
+  page.insertRecord("allocated");
+  file->writePage(page);
+  CHECK_THROWS(loader.finish(), std::logic_error);
+  CHECK(file->numPages() == 2);
+  CHECK(file->readPage(1).getRecord({1, 1}) == "allocated");
+}
+
+BADGERDB_TEST(externalSortRoundTrip, "operators/external_sort_round_trip") {
+  ScratchFile input("sort_in.db");
+  ScratchFile output("sort_out.db");
+  std::mt19937_64 rng(42);
+  std::vector<std::uint64_t> keys;
+  {
+    BulkLoader loader(*input);
+    for (int i = 0; i < 30000; ++i) {
+      const std::uint64_t key = rng() % 100000;
+      keys.push_back(key);
+      loader.insertRecord(recordOf(key, std::string(key % 24, 'x')));
+    }
+  }
+  BufMgr mgr(24);
+  ThreadPool pool(4);
+  ExternalSort sorter(mgr, pool, 16, [](std::string_view a, std::string_view b) {
+    return keyOf(a) < keyOf(b);
+  });
+  sorter.sort(*input, *output);
+  std::sort(keys.begin(), keys.end());
+  const std::vector<std::string> records = recordsOf(*output);
+  CHECK(records.size() == keys.size());
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    CHECK(keyOf(records[i]) == keys[i]);
+    CHECK(records[i].size() == sizeof(std::uint64_t) + keys[i] % 24);
+  }
+}
+
+BADGERDB_TEST(tempFileNames, "operators/temp_file_names") {
+  // 同一前缀上并发创建的临时文件各不相同, 已经存在的文件被跳过
+  ScratchFile taken("temp.sort0");
+  const std::string prefix = "badgerdb_test.temp";
+  constexpr unsigned THREADS = 4;
+  constexpr unsigned PER_THREAD = 8;
+  std::vector<std::vector<std::unique_ptr<TempFile>>> temps(THREADS);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&, t] {
+      for (unsigned i = 0; i < PER_THREAD; ++i) {
+        temps[t].push_back(std::make_unique<TempFile>(prefix, "sort", IoMode::Buffered));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  std::set<std::string> names;
+  for (const auto& list : temps) {
+    for (const auto& temp : list) {
+      names.insert(temp->file().filename());
+    }
+  }
+  CHECK(names.size() == THREADS * PER_THREAD && !names.count(taken.name()));
+  temps.clear();
+  for (const std::string& name : names) {
+    CHECK(!File::exists(name));
+  }
+
+  // 文件已经被删除时析构也不抛出
+  {
+    TempFile temp(prefix, "sort", IoMode::Direct);
+    std::remove(temp.file().filename().c_str());
+  }
+}
+
+BADGERDB_TEST(hashJoinRoundTrip, "operators/hash_join_round_trip") {
+  // budget 足够时在内存中连接, 不够时退化为 Grace 散列连接
+  for (const std::uint32_t budget : {64u, 4u}) {
+    ScratchFile build("join_build.db");
+    ScratchFile probe("join_probe.db");
+    std::mt19937_64 rng(7);
+    std::map<std::uint64_t, long> build_counts;
+    std::map<std::uint64_t, long> probe_counts;
+    {
+      BulkLoader loader(*build);
+      for (int i = 0; i < 3000; ++i) {
+        const std::uint64_t key = rng() % 2000;
+        ++build_counts[key];
+        loader.insertRecord(recordOf(key, "build"));
+      }
+    }
+    {
+      BulkLoader loader(*probe);
+      for (int i = 0; i < 10000; ++i) {
+        const std::uint64_t key = rng() % 2000;
+        ++probe_counts[key];
+        loader.insertRecord(recordOf(key, "probe"));
+      }
+    }
+    long expected = 0;
+    for (const auto& [key, count] : build_counts) {
+      expected += count * probe_counts[key];
+    }
+    BufMgr mgr(budget + 4);
+    HashJoin join(mgr, budget, keyOf, keyOf);
+    long matches = 0;
+    bool consistent = true;
+    join.join(*build, *probe, [&](std::string_view b, std::string_view p) {
+      consistent &= keyOf(b) == keyOf(p) && b.substr(8) == "build" && p.substr(8) == "probe";
+      ++matches;
+    });
+    CHECK(consistent);
+    CHECK(matches == expected);
+  }
+}
+
+BADGERDB_TEST(filterScanMatchesReference, "operators/filter_scan_matches_reference") {
+  ScratchFile file("filter.db");
+  std::mt19937_64 rng(7);
+  {
+    BulkLoader loader(*file, 16);
+    for (int i = 0; i < 20000; ++i) {
+      std::string record(4, '\0');
+      const std::int32_t value = static_cast<std::int32_t>(rng() % 2000) - 1000;
+      std::memcpy(record.data(), &value, sizeof(value));
+      record += rng() % 5 == 0 ? "needle" : "hay";
+      loader.insertRecord(record);
+    }
+  }
+  file->deletePage(3);
+  BufMgr mgr(64);
+  PredicateFilter filter;
+  filter.where(IntPredicate{0, 4, CompareOp::LT, 17}).where(BytesPredicate{4, MatchKind::EQUALS, "needle"});
+
+  std::vector<RecordId> expected;
+  for (FileIterator it = file->begin(); it != file->end(); ++it) {
+    const Page page = *it;
+    for (PageIterator record = page.begin(); record != page.end(); ++record) {
+      const std::string_view view = page.getRecordView(record.record_id());
+      std::int32_t value;
+      std::memcpy(&value, view.data(), sizeof(value));
+      if (value < 17 && view.substr(4) == "needle") {
+        expected.push_back(record.record_id());
+      }
+    }
+  }
+  CHECK(!expected.empty());
+  const auto same = [&](const std::vector<RecordId>& got) {
+    if (got.size() != expected.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < got.size(); ++i) {
+      if (got[i].page_number != expected[i].page_number || got[i].slot_number != expected[i].slot_number) {
+        return false;
+      }
+    }
+    return true;
+  };
+  CHECK(same(FilterScan(*file, mgr, filter).run()));
+  ThreadPool pool(4);
+  CHECK(same(FilterScan(*file, mgr, filter).run(pool, 7)));
+  CHECK(same(FilterScan(*file, mgr, filter, AccessStrategy::Normal).run(pool)));
+
+  // PAX 格式的页没有插槽目录
+  ScratchFile pax("filter_pax.db", IoMode::Buffered, PageLayout::pax({4, 8}));
+  CHECK_THROWS(FilterScan(*pax, mgr, filter), std::invalid_argument);
+}
+
+namespace {
+
+struct Counter {
+  std::size_t records = 0;
+  std::size_t bytes = 0;
+  void operator()(const RecordId&, std::string_view record) {
+    ++records;
+    bytes += record.size();
+  }
+};
+
+}
+
+BADGERDB_TEST(parallelScanCountsRecords, "operators/parallel_scan_counts_records") {
+  ScratchFile file("parallel.db");
+  BufMgr mgr(64);
+  std::size_t expected = 0;
+  for (int i = 0; i < 500; ++i) {
+    PageId page_no;
+    MutablePageView view = mgr.allocPage(*file, page_no);
+    for (int k = 0; k < 20; ++k) {
+      view->insertRecord("record " + std::to_string(i) + "/" + std::to_string(k));
+      ++expected;
+    }
+  }
+  for (PageId p = 3; p < 500; p += 7) {
+    mgr.disposePage(*file, p);
+    expected -= 20;
+  }
+  mgr.flushFile(*file);
+  ThreadPool pool(4);
+  ParallelScan scan(*file, mgr, pool, 16);
+  for (int round = 0; round < 2; ++round) {
+    std::vector<Counter> counters(pool.size());
+    scan.run(counters);
+    std::size_t records = 0;
+    for (const Counter& counter : counters) {
+      records += counter.records;
+    }
+    CHECK(records == expected);
+  }
+  std::vector<Counter> too_few;
+  CHECK_THROWS(scan.run(too_few), std::invalid_argument);
+
+  ScratchFile pax("parallel_pax.db", IoMode::Buffered, PageLayout::pax({4, 8}));
+  CHECK_THROWS(ParallelScan(*pax, mgr, pool), std::invalid_argument);
+}
@@ -0,0 +1,83 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+
+#include "buffer.h"
+#include "pax_page.h"
+#include "test.h"
+
+using namespace badgerdb;
+using badgerdb::test::ScratchFile;
+
+BADGERDB_TEST(paxRoundTrip, "pax/round_trip") {
+  const PageLayout layout = PageLayout::pax({4, 8, 16});
+  ScratchFile file("pax.db", IoMode::Buffered, layout);
+  std::map<std::pair<PageId, SlotId>, std::string> expected;
+  {
+    const PaxFormat format(file->layout());
+    CHECK(format.rowWidth() == 28);
+    BufMgr mgr(16);
+    std::mt19937 rng(3);
+    PageId current = 0;
+    for (std::int32_t i = 0; i < 3000; ++i) {
+      std::string row(format.rowWidth(), '\0');
+      const std::int64_t b = rng();
+      std::memcpy(row.data(), &i, 4);
+      std::memcpy(row.data() + 4, &b, 8);
+      for (std::size_t k = 12; k < row.size(); ++k) {
+        row[k] = static_cast<char>('a' + rng() % 26);
+      }
+      if (current == 0 || !PaxPage(*mgr.readPage<MutablePageView>(*file, current), format).hasSpace()) {
+        mgr.allocPage(*file, current);
+      }
+      MutablePageView view = mgr.readPage<MutablePageView>(*file, current);
+      PaxPage page(*view, format);
+      const RecordId rid = page.insertRecord(row);
+      expected[{rid.page_number, rid.slot_number}] = row;
+      if (i % 4 == 0) {
+        page.deleteRecord(rid);
+        expected.erase({rid.page_number, rid.slot_number});
+      }
+    }
+    CHECK_THROWS(PaxPage(*mgr.readPage<MutablePageView>(*file, current), format).insertRecord("short"),
+                 std::invalid_argument);
+    mgr.flushFile(*file);
+  }
+
+  file.reopen();
+  CHECK(file->layout() == layout);
+  const PaxFormat format(file->layout());
+  BufMgr mgr(16);
+  std::size_t records = 0;
+  for (PageId p = 1; p < file->numPages(); ++p) {
+    const PageView view = mgr.readPage(*file, p);
+    const PaxPageView page(*view, format);
+    const auto first = page.column<std::int32_t>(0);
+    for (SlotId s = 1; s <= page.end(); ++s) {
+      if (!page.present(s)) {
+        continue;
+      }
+      ++records;
+      const auto it = expected.find({p, s});
+      CHECK(it != expected.end());
+      CHECK(page.getRecord({p, s}) == it->second);
+      CHECK(page.getField({p, s}, 2) == std::string_view(it->second).substr(12));
+      std::int32_t value;
+      std::memcpy(&value, it->second.data(), 4);
+      CHECK(first[s - 1] == value);
+    }
+  }
+  CHECK(records == expected.size());
+  mgr.flushFile(*file);
+
+  CHECK_THROWS(PaxFormat(PageLayout()), std::invalid_argument);
+  CHECK_THROWS(PageLayout::pax({4, 0}), std::invalid_argument);
+}
@@ -0,0 +1,94 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "bulk_loader.h"
+#include "filter_scan.h"
+#include "record_schema.h"
+#include "test.h"
+
+using namespace badgerdb;
+using badgerdb::test::ScratchFile;
+
+namespace {
+
+using Person = RecordSchema<std::int32_t, FixedString<8>, VarString, double, VarString>;
+
+static_assert(Person::OFFSETS == std::array<std::size_t, 5>{0, 4, 12, 14, 22});
+static_assert(Person::FIXED_SIZE == 24 && !Person::ALL_FIXED);
+
+}
+
+BADGERDB_TEST(schemaRoundTrip, "schema/round_trip") {
+  const std::string record = Person::encode(42, "alice", "likes databases", 1.5, "");
+  CHECK(record.size() == Person::FIXED_SIZE + 15);
+  CHECK(Person::valid(record));
+  CHECK(Person::get<0>(record) == 42);
+  CHECK(Person::get<1>(record) == "alice");
+  CHECK(Person::get<2>(record) == "likes databases");
+  CHECK(Person::get<3>(record) == 1.5);
+  CHECK(Person::get<4>(record).empty());
+  CHECK(Person::decode(record) == std::make_tuple(42, "alice", "likes databases", 1.5, ""));
+  const Person::View view(record);
+  CHECK(view.get<2>().data() == record.data() + Person::FIXED_SIZE);
+
+  // 恰好占满的定长字符串没有结尾的 '\0'
+  const std::string full = Person::encode(-1, "12345678", "", -0.25, "tail");
+  CHECK(Person::valid(full));
+  CHECK(Person::get<1>(full) == "12345678");
+  CHECK(Person::get<2>(full).empty() && Person::get<4>(full) == "tail");
+
+  CHECK(!Person::valid(full.substr(0, Person::FIXED_SIZE - 1)));
+  CHECK(!Person::valid(full.substr(0, full.size() - 1)));
+  CHECK(!Person::valid(full + "x"));
+  std::string bad = full;
+  bad[Person::offset<4>] = 1;  // 结束偏移小于上一个变长字段的
+  CHECK(!Person::valid(bad));
+
+  CHECK_THROWS(Person::encode(0, "123456789", "", 0, ""), std::length_error);
+  CHECK_THROWS(Person::encode(0, "", std::string(UINT16_MAX, 'x'), 0, ""), std::length_error);
+}
+
+BADGERDB_TEST(schemaPaxLayout, "schema/pax_layout") {
+  using Point = RecordSchema<std::int32_t, std::int64_t, FixedString<12>>;
+  static_assert(Point::ALL_FIXED && Point::FIXED_SIZE == 24);
+  CHECK(Point::paxLayout() == PageLayout::pax({4, 8, 12}));
+  const std::string record = Point::encode(7, -3, "xyz");
+  CHECK(Point::valid(record) && !Point::valid(record + '\0'));
+  CHECK(Point::decode(record) == std::make_tuple(7, std::int64_t{-3}, "xyz"));
+}
+
+BADGERDB_TEST(schemaFilterByOffset, "schema/filter_by_offset") {
+  using Row = RecordSchema<std::int32_t, std::int64_t, VarString>;
+  ScratchFile file("schema.db");
+  {
+    BulkLoader loader(*file);
+    for (std::int32_t i = 0; i < 5000; ++i) {
+      loader.insertRecord(Row::encode(i, i % 1000, i % 3 == 0 ? "blue" : "green"));
+    }
+  }
+  BufMgr mgr(16);
+  PredicateFilter filter;
+  filter.where(IntPredicate{Row::offset<1>, 8, CompareOp::GE, 990})
+      .where(BytesPredicate{Row::FIXED_SIZE, MatchKind::EQUALS, "blue"});
+  const std::vector<RecordId> rids = FilterScan(*file, mgr, filter).run();
+  std::size_t expected = 0;
+  for (std::int32_t i = 0; i < 5000; ++i) {
+    expected += i % 1000 >= 990 && i % 3 == 0;
+  }
+  CHECK(rids.size() == expected);
+  for (const RecordId& rid : rids) {
+    const PageView view = mgr.readPage(*file, rid.page_number);
+    const std::string_view record = view->getRecordView(rid);
+    CHECK(Row::get<1>(record) >= 990 && Row::get<2>(record) == "blue");
+  }
+}
@@ -0,0 +1,113 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// 在一组缓冲池大小上重放 BufMgr::startTrace() 记录的页访问踪迹:
+//   badgerdb_trace_replay <trace> [--bufs=64,128,256] [--read-us=100] [--write-us=200]
+//                         [--scratch=<临时文件前缀>]
+// 不给 --bufs 时取 8, 16, 32, ... 直到不小于踪迹访问过的不同页数.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "trace_replay.h"
+
+namespace {
+
+struct Options {
+  std::string trace;
+  std::string scratch = "trace_replay";
+  std::vector<std::uint32_t> bufs;
+  badgerdb::IoCost cost;
+};
+
+std::vector<std::uint32_t> parseList(const std::string_view list) {
+  std::vector<std::uint32_t> values;
+  std::size_t start = 0;
+  while (start <= list.size()) {
+    const std::size_t end = std::min(list.find(',', start), list.size());
+    const long value = std::atol(std::string(list.substr(start, end - start)).c_str());
+    if (value > 0) {
+      values.push_back(static_cast<std::uint32_t>(value));
+    }
+    start = end + 1;
+  }
+  return values;
+}
+
+bool parseOptions(const int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    const auto value_of = [&](std::string_view prefix, std::string_view& value) {
+      if (arg.substr(0, prefix.size()) != prefix) {
+        return false;
+      }
+      value = arg.substr(prefix.size());
+      return true;
+    };
+    std::string_view value;
+    if (value_of("--bufs=", value)) {
+      options.bufs = parseList(value);
+    } else if (value_of("--read-us=", value)) {
+      options.cost.read_us = std::atof(std::string(value).c_str());
+    } else if (value_of("--write-us=", value)) {
+      options.cost.write_us = std::atof(std::string(value).c_str());
+    } else if (value_of("--scratch=", value)) {
+      options.scratch = value;
+    } else if (options.trace.empty() && arg.substr(0, 2) != "--") {
+      options.trace = arg;
+    } else {
+      return false;
+    }
+  }
+  return !options.trace.empty();
+}
+
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s <trace> [--bufs=<n>,<n>,...] [--read-us=<us>] [--write-us=<us>]\n"
+                 "          [--scratch=<prefix>]\n",
+                 argv[0]);
+    return 2;
+  }
+
+  try {
+    badgerdb::TraceReplay replay(options.trace, options.scratch);
+    if (options.bufs.empty()) {
+      std::uint32_t n = 8;
+      do {
+        options.bufs.push_back(n);
+        n *= 2;
+      } while (options.bufs.back() < replay.numDistinctPages());
+    }
+    std::printf("events: %zu, distinct pages: %llu\n", replay.numEvents(),
+                static_cast<unsigned long long>(replay.numDistinctPages()));
+    std::printf("%10s %12s %12s %12s %12s %10s %12s\n", "num_bufs", "accesses", "allocs",
+                "disk_reads", "disk_writes", "hit_ratio", "io_seconds");
+    for (const std::uint32_t n : options.bufs) {
+      const badgerdb::ReplayResult r = replay.run(n, options.cost);
+      std::printf("%10u %12llu %12llu %12llu %12llu %10.4f %12.3f%s\n", r.num_bufs,
+                  static_cast<unsigned long long>(r.accesses),
+                  static_cast<unsigned long long>(r.allocs),
+                  static_cast<unsigned long long>(r.disk_reads),
+                  static_cast<unsigned long long>(r.disk_writes), r.hit_ratio, r.io_seconds,
+                  r.exceeded ? "  (buffer exceeded)" : "");
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
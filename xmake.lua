@@ -3,6 +3,19 @@ add_languages("c++20")
 
 
 
+-- xmake f --tracing=y: 编译进事件追踪 (见 src/event_trace.h)
+option("tracing")
+	set_default(false)
+	set_showmenu(true)
+	set_description("Record hot-path events for Chrome trace export")
+	add_defines("BADGERDB_TRACING")
+option_end()
+add_options("tracing")
+
+if is_plat("linux") then
+	add_syslinks("pthread") -- 并行扫描等使用 std::thread
+end
+
 if is_os("windows") and is_plat("mingw") then
 	add_cxflags("-fexec-charset=gbk") -- windows下设置编码
 end
@@ -11,4 +24,26 @@ target("badgerdb_main")
 	add_files("./src/**.cpp")
 	after_build(function(target)
 		os.cp(target:targetfile(),"./")
-	end)
\ No newline at end of file
+	end)
+
+-- 微基准: xmake build badgerdb_bench && xmake run badgerdb_bench [--format=text]
+target("badgerdb_bench")
+	set_default(false)
+	set_optimize("fastest")
+	add_defines("NDEBUG")
+	add_includedirs("./bench")
+	add_files("./bench/*.cpp")
+	add_files("./src/**.cpp|main.cpp")
+
+-- 踪迹重放: xmake run badgerdb_trace_replay <trace> [--bufs=64,128,256]
+target("badgerdb_trace_replay")
+	set_default(false)
+	set_optimize("fastest")
+	add_files("./tools/trace_replay.cpp")
+	add_files("./src/**.cpp|main.cpp")
+
+-- 单元测试: xmake build badgerdb_tests && xmake run badgerdb_tests [--filter=file/]
+target("badgerdb_tests")
+	set_default(false)
+	add_files("./tests/*.cpp")
+	add_files("./src/**.cpp|main.cpp")